@@ -10,6 +10,6 @@ OPT_ENABLE:=fs png wm_x11
 # LDPOST must agree with OPT_ENABLE, ensuring it is up to you.
 CC:=gcc -c -MMD -O3 -Isrc -Werror -Wimplicit $(foreach U,$(OPT_ENABLE),-DUSE_$U=1)
 LD:=gcc -z noexecstack
-LDPOST:=-lX11 -lz
+LDPOST:=-lX11 -lz -lpthread
 AR:=ar
 EXESFX:=
@@ -0,0 +1,157 @@
+/* Generated by mkfont. Do not edit. */
+#include "lib/gui/gui_internal.h"
+static const unsigned char mkfont_a1_0[1792]={
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,16,40,0,16,0,64,16,8,32,0,0,0,0,0,2,
+0,16,40,0,124,32,160,16,16,16,84,0,0,0,0,4,0,16,0,0,146,82,160,0,16,16,56,0,0,0,0,4,
+0,16,0,40,144,36,160,0,32,8,124,16,0,0,0,8,0,16,0,124,144,8,160,0,32,8,56,16,0,0,0,8,
+0,16,0,40,124,16,64,0,32,8,84,124,0,124,0,16,0,16,0,124,18,32,160,0,32,8,0,16,0,0,0,32,
+0,16,0,40,18,72,144,0,32,8,0,16,0,0,0,32,0,0,0,0,146,148,138,0,16,16,0,0,0,0,0,64,
+0,0,0,0,124,8,132,0,16,16,0,0,0,0,0,64,0,16,0,0,16,0,122,0,8,32,0,0,48,0,16,128,
+0,0,0,0,0,0,0,0,0,0,0,0,16,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,56,16,120,120,130,254,56,254,124,126,0,0,0,0,0,56,
+68,48,132,132,130,128,64,2,130,130,0,0,4,0,64,68,130,80,2,2,130,128,128,2,130,130,0,0,8,0,32,130,
+134,144,2,2,130,128,128,4,130,130,16,0,16,0,16,2,138,16,4,4,130,128,128,4,130,130,0,0,32,124,8,2,
+146,16,56,24,254,248,248,8,124,126,0,16,64,0,4,28,162,16,64,4,2,4,132,8,130,2,0,0,32,124,8,16,
+194,16,128,2,2,2,130,16,130,2,16,0,16,0,16,0,130,16,128,2,2,2,130,16,130,2,0,48,8,0,32,0,
+68,16,128,132,2,132,68,32,130,2,0,16,4,0,64,0,56,254,254,120,2,120,56,32,124,2,0,16,0,0,0,16,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,56,248,60,248,254,254,60,130,254,2,130,128,68,130,56,
+124,68,132,66,132,128,128,66,130,16,2,132,128,170,194,68,130,130,130,128,130,128,128,128,130,16,2,136,128,170,162,130,
+146,130,130,128,130,128,128,128,130,16,2,144,128,170,162,130,170,130,132,128,130,128,128,128,130,16,2,160,128,146,146,130,
+170,254,248,128,130,252,252,142,254,16,2,192,128,146,146,130,170,130,132,128,130,128,128,130,130,16,2,160,128,146,146,130,
+190,130,130,128,130,128,128,130,130,16,130,144,128,130,138,130,128,130,130,128,130,128,128,130,130,16,130,136,128,130,138,130,
+126,130,132,66,132,128,128,70,130,16,68,132,128,130,134,68,0,130,248,60,248,254,128,58,130,254,56,130,254,130,130,56,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,248,56,248,60,254,130,130,130,130,130,254,56,128,56,16,0,
+132,68,132,66,16,130,130,130,130,130,2,32,64,8,40,0,130,130,130,128,16,130,130,130,68,130,2,32,64,8,68,0,
+130,130,130,128,16,130,130,130,68,130,4,32,32,8,0,0,132,130,132,64,16,130,68,130,40,68,8,32,32,8,0,0,
+248,130,248,56,16,130,68,146,16,56,16,32,16,8,0,0,128,130,160,4,16,130,68,146,40,16,32,32,8,8,0,0,
+128,130,144,2,16,130,40,146,68,16,64,32,8,8,0,0,128,138,136,2,16,130,40,146,68,16,128,32,4,8,0,0,
+128,68,132,132,16,68,40,146,130,16,128,32,4,8,0,0,128,58,130,120,16,56,16,108,130,16,254,32,2,8,0,254,
+0,0,0,0,0,0,0,0,0,0,0,56,0,56,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,32,0,128,0,2,0,14,0,128,0,0,128,16,0,0,0,
+16,0,128,0,2,0,16,0,128,0,0,128,16,0,0,0,8,0,128,0,2,0,16,0,128,16,16,128,16,0,0,0,
+0,0,128,0,2,0,16,0,128,0,0,128,16,0,0,0,0,124,252,124,126,124,254,126,248,16,16,128,16,236,248,124,
+0,2,130,130,130,130,16,130,132,16,16,136,16,146,132,130,0,2,130,128,130,130,16,130,130,16,16,144,16,146,130,130,
+0,126,130,128,130,252,16,130,130,16,16,224,16,146,130,130,0,130,130,128,130,128,16,130,130,16,16,152,16,146,130,130,
+0,134,130,130,130,130,16,130,130,16,16,132,16,146,130,130,0,122,252,124,126,124,16,126,130,8,16,130,8,130,130,124,
+0,0,0,0,0,0,0,2,0,0,16,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,144,0,0,0,0,0,
+0,0,0,0,0,0,0,124,0,0,96,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,16,0,0,0,0,0,0,12,16,48,0,0,
+0,0,0,0,16,0,0,0,0,0,0,16,16,8,0,0,0,0,0,0,16,0,0,0,0,0,0,16,16,8,0,0,
+0,0,0,0,16,0,0,0,0,0,0,16,16,8,0,0,252,126,252,126,254,130,130,130,130,130,254,8,16,16,96,0,
+130,130,130,128,16,130,130,130,68,130,4,48,16,12,146,0,130,130,128,128,16,130,130,130,40,130,8,8,16,16,12,0,
+130,130,128,124,16,130,68,130,16,130,16,16,16,8,0,0,130,130,128,2,16,130,68,146,40,130,32,16,16,8,0,0,
+130,130,128,2,16,130,40,146,68,130,64,16,16,8,0,0,252,126,128,252,8,126,16,108,130,126,254,12,16,48,0,0,
+128,2,0,0,0,0,0,0,0,2,0,0,16,0,0,0,128,2,0,0,0,0,0,0,0,2,0,0,0,0,0,0,
+128,2,0,0,0,0,0,0,0,124,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,76,196,174,142,110,232,98,238,0,0,0,0,0,254,255,254,164,34,172,194,234,172,134,200,0,0,0,0,0,
+130,128,2,164,198,226,162,238,234,138,140,0,0,0,0,0,186,187,186,78,236,44,66,194,172,102,232,0,0,0,0,0,
+186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,
+186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,130,128,2,0,0,0,0,0,0,0,0,0,0,0,0,0,
+186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,
+186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,
+130,128,2,0,0,0,0,0,0,0,0,0,0,0,0,0,254,255,254,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+};
+static const unsigned char mkfont_a1_1[1792]={
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,24,108,0,16,0,64,24,12,96,0,0,0,0,0,2,
+0,24,108,0,124,32,160,24,24,48,84,0,0,0,0,6,0,24,36,40,214,82,160,8,48,24,56,0,0,0,0,12,
+0,24,0,40,208,86,160,0,96,12,124,16,0,0,0,8,0,24,0,254,208,44,192,0,96,12,56,16,0,0,0,24,
+0,24,0,40,124,24,96,0,96,12,84,124,0,124,0,16,0,24,0,254,22,52,242,0,96,12,0,16,0,0,0,48,
+0,0,0,40,22,106,218,0,96,12,0,16,0,0,0,32,0,0,0,40,214,202,204,0,48,24,0,0,0,0,0,96,
+0,24,0,0,124,4,198,0,24,48,0,0,24,0,24,192,0,24,0,0,16,0,122,0,12,96,0,0,24,0,24,128,
+0,0,0,0,0,0,0,0,0,0,0,0,8,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,16,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,56,8,120,120,198,254,60,254,124,126,0,0,6,0,192,124,
+108,24,204,204,198,192,96,198,198,198,0,0,12,0,96,198,198,56,6,6,198,192,192,6,198,198,0,0,24,0,48,6,
+198,120,6,6,198,192,192,12,198,198,24,0,48,0,24,6,206,24,14,12,198,192,192,12,198,198,24,0,96,254,12,6,
+214,24,124,24,254,252,252,24,124,126,0,24,192,0,6,28,230,24,224,12,6,6,198,24,198,6,24,24,96,254,12,24,
+198,24,192,6,6,6,194,48,198,6,24,0,48,0,24,0,198,24,192,6,6,6,198,48,198,6,0,0,24,0,48,0,
+108,24,192,204,6,198,108,96,198,6,0,24,12,0,96,24,56,126,254,120,6,124,56,96,124,6,0,8,6,0,192,24,
+0,0,0,0,0,0,0,0,0,0,0,8,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,56,248,60,248,254,254,60,198,126,6,198,192,130,134,56,
+124,108,204,102,204,192,192,102,198,24,6,198,192,198,198,108,130,198,198,192,198,192,192,192,198,24,6,204,192,238,230,198,
+146,198,198,192,198,192,192,192,198,24,6,216,192,254,230,198,170,198,204,192,198,192,192,192,198,24,6,240,192,254,246,198,
+170,254,248,192,198,252,252,206,254,24,6,224,192,214,214,198,170,198,204,192,198,192,192,198,198,24,6,240,192,214,222,198,
+190,198,198,192,198,192,192,198,198,24,198,216,192,198,206,198,128,198,198,192,198,192,192,198,198,24,198,204,192,198,206,198,
+126,198,204,102,204,192,192,110,198,24,108,198,192,198,198,108,0,198,248,60,248,254,192,58,198,126,56,198,254,198,194,56,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,248,56,248,60,126,198,130,198,198,198,254,124,128,124,16,0,
+204,108,204,102,24,198,198,198,198,198,6,96,192,12,56,0,198,198,198,192,24,198,198,198,68,204,6,96,64,12,108,0,
+198,198,198,192,24,198,198,198,108,108,12,96,96,12,198,0,204,198,204,96,24,198,108,198,56,120,24,96,48,12,0,0,
+248,198,248,56,24,198,108,214,16,56,16,96,16,12,0,0,192,198,240,12,24,198,108,214,56,48,48,96,24,12,0,0,
+192,198,216,6,24,198,40,214,108,96,96,96,12,12,0,0,192,206,204,6,24,198,56,214,68,96,192,96,4,12,0,0,
+192,108,198,204,24,108,56,214,198,192,192,96,6,12,0,0,192,58,198,120,24,56,16,108,198,192,254,96,2,12,0,254,
+0,0,0,0,0,0,0,0,0,0,0,124,0,124,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,48,0,192,0,6,0,14,0,192,0,0,192,24,0,0,0,
+24,0,192,0,6,0,24,0,192,24,24,192,24,0,0,0,12,0,192,0,6,0,24,0,192,24,24,192,24,0,0,0,
+0,0,192,0,6,0,24,0,192,0,0,192,24,0,0,0,0,124,252,124,126,124,126,126,248,24,24,198,24,236,248,124,
+0,6,198,198,198,198,24,198,204,24,24,204,24,214,204,198,0,6,198,192,198,198,24,198,198,24,24,216,24,214,198,198,
+0,126,198,192,198,252,24,198,198,24,24,240,24,214,198,198,0,198,198,192,198,192,24,198,198,24,24,248,24,214,198,198,
+0,198,198,198,198,198,24,198,198,24,24,204,24,214,198,198,0,122,252,124,126,124,24,126,198,12,24,198,12,198,198,124,
+0,0,0,0,0,0,0,6,0,0,24,0,0,0,0,0,0,0,0,0,0,0,0,6,0,0,216,0,0,0,0,0,
+0,0,0,0,0,0,0,124,0,0,112,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,24,0,0,0,0,0,0,12,24,96,0,0,
+0,0,0,0,24,0,0,0,0,0,0,24,24,48,0,0,0,0,0,0,24,0,0,0,0,0,0,48,24,24,0,0,
+0,0,0,0,24,0,0,0,0,0,0,48,24,24,0,0,252,126,252,126,126,198,198,198,130,198,126,24,24,48,112,0,
+198,198,198,192,24,198,198,198,198,198,6,112,24,28,214,0,198,198,192,192,24,198,198,198,108,198,12,24,24,48,28,0,
+198,198,192,124,24,198,108,198,56,198,24,48,24,24,0,0,198,198,192,6,24,198,108,214,56,198,48,48,24,24,0,0,
+198,198,192,6,24,230,56,214,108,230,96,24,24,48,0,0,252,126,192,252,12,126,16,108,198,126,126,12,24,96,0,0,
+192,6,0,0,0,0,0,0,0,6,0,0,24,0,0,0,192,6,0,0,0,0,0,0,0,14,0,0,0,0,0,0,
+192,6,0,0,0,0,0,0,0,124,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,76,196,174,142,110,232,98,238,0,0,0,0,0,254,255,254,164,34,172,194,234,172,134,200,0,0,0,0,0,
+130,128,2,164,198,226,162,238,234,138,140,0,0,0,0,0,186,187,186,78,236,44,66,194,172,102,232,0,0,0,0,0,
+186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,
+186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,130,128,2,0,0,0,0,0,0,0,0,0,0,0,0,0,
+186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,
+186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,186,187,186,0,0,0,0,0,0,0,0,0,0,0,0,0,
+130,128,2,0,0,0,0,0,0,0,0,0,0,0,0,0,254,255,254,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+};
+static const unsigned char mkfont_a1_2[1008]={
+0,133,0,33,4,8,17,10,128,0,0,2,0,133,0,114,138,8,32,135,0,0,0,2,0,128,20,169,42,0,64,79,
+136,0,0,4,0,128,62,160,68,0,64,71,8,0,0,4,0,128,20,112,138,0,64,74,190,3,224,8,0,128,62,41,
+10,0,64,64,8,0,0,16,0,0,20,170,74,128,64,64,8,0,0,16,0,0,0,112,169,0,32,128,0,0,0,32,
+0,128,0,32,70,128,17,0,0,96,2,32,0,0,0,0,0,0,0,0,0,32,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,112,135,28,139,231,62,113,224,0,8,8,28,137,136,162,138,
+8,2,138,32,0,16,4,34,138,128,130,138,8,2,138,34,0,32,2,2,152,128,130,138,8,4,138,32,0,67,225,2,
+168,135,12,251,207,4,113,224,8,128,0,140,200,136,2,8,40,136,136,32,0,67,225,8,136,136,2,8,40,136,136,34,
+0,32,2,0,136,136,34,10,40,144,136,32,24,16,4,0,115,239,156,9,199,16,112,32,8,8,8,8,0,0,0,0,
+0,0,0,0,8,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+1,207,28,243,239,156,139,224,162,130,40,156,114,40,162,138,8,32,136,128,162,131,108,162,138,40,160,138,8,32,136,128,
+164,130,172,162,170,40,160,138,8,32,136,128,168,130,170,162,171,239,32,139,207,38,248,128,176,130,42,162,186,40,160,138,
+8,34,136,128,168,130,42,162,130,40,160,138,8,34,136,136,164,130,41,162,122,40,162,138,8,34,136,136,162,130,41,162,
+2,47,28,243,232,30,139,231,34,250,40,156,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,241,207,28,250,40,162,138,47,156,9,194,0,138,40,162,34,
+40,162,138,32,144,8,69,0,138,40,160,34,40,162,82,33,16,16,72,128,138,40,160,34,40,162,81,65,16,16,64,0,
+242,47,28,34,37,42,32,130,16,32,64,0,130,42,2,34,37,42,80,132,16,64,64,0,130,169,2,34,37,42,80,132,
+16,64,64,0,130,104,162,34,34,42,136,136,16,128,64,0,129,232,156,33,194,20,136,143,144,128,64,62,0,0,0,0,
+0,0,0,0,28,1,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+64,8,0,8,1,128,128,0,32,32,0,0,32,8,0,8,2,0,128,0,32,32,0,0,16,8,0,8,2,0,128,130,
+32,32,0,0,0,8,0,8,2,0,128,0,32,32,0,0,1,207,30,121,207,158,240,130,34,35,79,28,0,40,160,138,
+34,34,136,130,52,34,168,162,1,232,160,139,194,34,136,130,40,34,168,162,2,40,160,138,2,34,136,130,36,34,168,162,
+1,239,30,121,194,30,136,74,34,18,168,156,0,0,0,0,0,2,0,10,0,0,0,0,0,0,0,0,0,28,0,4,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,32,0,0,0,0,6,33,128,0,0,0,0,32,
+0,0,0,0,8,32,64,0,0,0,0,32,0,0,0,0,8,32,64,0,0,0,0,32,0,0,0,0,4,32,132,0,
+241,239,30,250,40,162,138,47,152,32,106,128,138,40,160,34,40,170,82,33,4,32,129,0,138,40,28,34,37,42,34,34,
+8,32,64,0,138,40,2,34,37,42,82,36,8,32,64,0,241,232,60,17,226,20,137,239,134,33,128,0,128,32,0,0,
+0,0,0,32,0,32,0,0,128,32,0,0,0,0,1,192,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+251,255,255,249,51,50,185,57,25,49,179,184,138,0,0,10,144,138,162,10,170,170,42,32,138,238,238,234,145,19,179,9,
+27,178,43,48,138,238,238,234,146,8,138,138,138,170,42,32,138,238,238,233,59,176,177,9,10,177,179,160,138,238,238,232,
+0,0,0,0,0,0,0,0,138,238,238,232,0,0,0,0,0,0,0,0,138,0,0,8,0,0,0,0,0,0,0,0,
+251,255,255,248,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,};
+const struct gui_embedded_font gui_embedded_fontv[]={
+  {"font_thin_g0_8x16",128,112,16,mkfont_a1_0},
+  {"font_bold_g0_8x16",128,112,16,mkfont_a1_1},
+  {"font_thin_g0_6x12",96,84,12,mkfont_a1_2},
+};
+const int gui_embedded_fontc=3;
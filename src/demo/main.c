@@ -52,6 +52,7 @@ int main(int argc,char **argv) {
   struct gui_delegate delegate={
     .update_rate=60.0,
     .log_clock_at_quit=1,
+    .ui_scale=getenv("FIFE_SCALE")?atoi(getenv("FIFE_SCALE")):0,
     //TODO
   };
   struct gui_context *gui=gui_context_new(&delegate);
@@ -102,13 +103,13 @@ int main(int argc,char **argv) {
       }
     }
     if (child=widget_tabber_spawn(main,"Untitled-1",10,&widget_type_dummy,0,0)) {
-      child->padx=40;
-      child->pady=40;
+      child->padx=gui_scale(gui,40);
+      child->pady=gui_scale(gui,40);
       child->bgcolor=wm_pixel_from_rgbx(0xff8000ff);
     }
     if (child=widget_tabber_spawn(main,"Untitled-2",10,&widget_type_dummy,0,0)) {
-      child->padx=40;
-      child->pady=40;
+      child->padx=gui_scale(gui,40);
+      child->pady=gui_scale(gui,40);
       child->bgcolor=wm_pixel_from_rgbx(0x008000ff);
     }
   }
@@ -140,8 +141,8 @@ int main(int argc,char **argv) {
       return 1;
     }
     root->bgcolor=0x40404040;
-    root->padx=5;
-    root->pady=5;
+    root->padx=gui_scale(gui,5);
+    root->pady=gui_scale(gui,5);
   }
   {
     struct widget_args_label args={
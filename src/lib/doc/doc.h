@@ -0,0 +1,91 @@
+/* doc.h
+ * Text document for editing, as a piece table.
+ * The original text is never copied or modified. Insertions go to an append-only buffer,
+ * and the document is a sequence of pieces referring to one buffer or the other.
+ * Pieces live in a balanced tree which also knows byte and newline counts of each subtree,
+ * so offset and line lookups, inserts, and deletes are all O(log n) in the number of pieces.
+ *
+ * We don't know or care about encoding, only bytes and LF.
+ * Read text by segment and give it to text_decoder yourself.
+ * Segments end at piece boundaries, which can fall inside a multi-byte character.
+ * For decoding across boundaries, copy out with doc_read.
+ */
+
+#ifndef DOC_H
+#define DOC_H
+
+#include <stdint.h>
+
+struct doc;
+struct pool;
+
+void doc_del(struct doc *doc);
+int doc_ref(struct doc *doc);
+
+/* New empty document.
+ */
+struct doc *doc_new();
+
+/* New document over some original text.
+ * "borrow" doesn't copy (src); it must remain constant and outlive the document.
+ * "handoff" doesn't copy either, and we'll free() it at the end.
+ * Either way, opening is quick no matter how big the text is. Newlines get counted when somebody asks about lines.
+ */
+struct doc *doc_new_borrow(const void *src,int64_t srcc);
+struct doc *doc_new_handoff(void *src,int64_t srcc);
+
+/* New document over a file, mapped read-only and never copied.
+ * Resident memory is whatever the OS keeps paged in, and edits only cost what you add.
+ * Only works if the "fs" unit is enabled.
+ */
+struct doc *doc_new_from_path(const char *path);
+
+int64_t doc_get_length(const struct doc *doc);
+
+/* Get a pointer to the text at (p), and return its contiguous length.
+ * Zero at or beyond the end.
+ * The pointer is only valid until the next edit.
+ */
+int doc_get_segment(void *dstpp,const struct doc *doc,int64_t p);
+
+/* Copy up to (dsta) bytes starting at (p), return the length copied.
+ */
+int doc_read(void *dst,int dsta,const struct doc *doc,int64_t p);
+
+/* Replace (c) bytes at (p) with (src,srcc).
+ * We copy (src), and never the original text.
+ */
+int doc_replace(struct doc *doc,int64_t p,int64_t c,const void *src,int srcc);
+
+/* Lines are zero-based and separated by LF; there's always at least one.
+ * We count newlines on demand, and only as far as we have to:
+ * Looking up a line or offset counts the pieces before it, and doc_get_line_count counts everything.
+ * Once counted, these are O(log n) and edits keep the counts current.
+ * doc_get_line_count_upto is the line count, but no more than (limit), and it stops counting there.
+ * doc_lines_counted is nonzero if everything is counted already, ie doc_get_line_count will be quick.
+ */
+int64_t doc_get_line_count(struct doc *doc);
+int64_t doc_get_line_count_upto(struct doc *doc,int64_t limit);
+int doc_lines_counted(const struct doc *doc);
+int64_t doc_offset_from_line(struct doc *doc,int64_t line); // => Start of line, clamped to (0..length).
+int64_t doc_line_from_offset(struct doc *doc,int64_t p); // => Line containing byte (p).
+
+/* Count all the newlines now, so the line calls above are quick from the start.
+ * With a pool, pieces are counted in parallel. That's what you want after opening a big file, if you can wait for it.
+ */
+void doc_prepare_lines(struct doc *doc,struct pool *pool);
+
+/* Count newlines in the background, if you can't wait.
+ * The original text never changes, so another thread can count it while this one goes on reading and editing.
+ * Make the census on the doc's thread, run it on any thread, then apply it back on the doc's thread.
+ * Applying counts every piece still uncounted, including ones cut up by edits since, from the census's tallies.
+ * The census holds a reference to the doc. With a pool, running spreads across it, and that's safe from inside a pool job.
+ */
+struct doc_census;
+void doc_census_del(struct doc_census *census);
+struct doc_census *doc_census_new(struct doc *doc,struct pool *pool);
+int doc_census_run(struct doc_census *census);
+struct doc *doc_census_get_doc(const struct doc_census *census);
+void doc_census_apply(struct doc_census *census); // Works without running too, it just counts everything right here.
+
+#endif
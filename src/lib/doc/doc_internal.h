@@ -0,0 +1,59 @@
+#ifndef DOC_INTERNAL_H
+#define DOC_INTERNAL_H
+
+#include "doc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+struct file_map;
+
+/* Original text is cut into pieces no longer than this when opened.
+ * So splitting a piece never counts newlines in more than this much text.
+ */
+#define DOC_ORIGINAL_PIECE_SIZE (1<<20)
+
+#define DOC_BUF_ORIGINAL 0
+#define DOC_BUF_ADD 1
+
+/* One piece, and the root of a subtree.
+ * Ordered by position in the document, and a max-heap on (pri).
+ */
+struct doc_node {
+  struct doc_node *l,*r; // STRONG
+  uint32_t pri;
+  int buf; // DOC_BUF_*
+  int64_t off,len; // In (buf).
+  int64_t nlc; // Newlines in this piece, or <0 if not counted yet.
+  int64_t sumlen,sumnlc; // Entire subtree. (sumnlc<0) if any piece is uncounted.
+};
+
+struct doc {
+  int refc;
+  const char *orig;
+  int64_t origc;
+  int origown; // Nonzero if we free (orig).
+  struct file_map *map; // STRONG, if (orig) is a mapped file.
+  char *add; // Append-only. Pieces refer to it by offset, so it's free to move.
+  int64_t addc,adda;
+  struct doc_node *root;
+  uint32_t rand;
+};
+
+static inline const char *doc_node_src(const struct doc *doc,const struct doc_node *node) {
+  return (node->buf==DOC_BUF_ADD)?(doc->add+node->off):(doc->orig+node->off);
+}
+
+// Tree primitives, doc_tree.c.
+void doc_node_del(struct doc_node *node);
+struct doc_node *doc_node_new(struct doc *doc,int buf,int64_t off,int64_t len,int64_t nlc);
+void doc_node_update(struct doc_node *node);
+struct doc_node *doc_tree_merge(struct doc_node *a,struct doc_node *b);
+int doc_tree_split(struct doc_node **a,struct doc_node **b,struct doc *doc,struct doc_node *node,int64_t p);
+int doc_tree_extend_last(struct doc_node *node,int buf,int64_t off,int64_t len,int64_t nlc);
+
+// Newlines, doc_line.c.
+int64_t doc_count_newlines(const char *src,int64_t srcc);
+void doc_require_newlines(struct doc *doc);
+
+#endif
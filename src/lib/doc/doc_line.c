@@ -0,0 +1,281 @@
+/* doc_line.c
+ * Newline counting, and lookups between lines and offsets.
+ */
+
+#include "doc_internal.h"
+#include "lib/serial/serial.h"
+#include "lib/pool/pool.h"
+
+/* Count LF in raw text.
+ */
+
+int64_t doc_count_newlines(const char *src,int64_t srcc) {
+  return sr_count_newlines(src,srcc);
+}
+
+/* Count every piece not counted yet.
+ */
+
+static void doc_require_newlines_1(struct doc *doc,struct doc_node *node) {
+  if (!node||(node->sumnlc>=0)) return;
+  doc_require_newlines_1(doc,node->l);
+  if (node->nlc<0) node->nlc=doc_count_newlines(doc_node_src(doc,node),node->len);
+  doc_require_newlines_1(doc,node->r);
+  doc_node_update(node);
+}
+
+void doc_require_newlines(struct doc *doc) {
+  doc_require_newlines_1(doc,doc->root);
+}
+
+/* Count in parallel.
+ * Gather the uncounted pieces, count them across the pool, then let doc_require_newlines fix the sums.
+ */
+
+struct doc_prepare_lines {
+  struct doc *doc;
+  struct doc_node **nodev;
+  int nodec,nodea;
+};
+
+static int doc_prepare_lines_gather(struct doc_prepare_lines *ctx,struct doc_node *node) {
+  if (!node||(node->sumnlc>=0)) return 0;
+  if (doc_prepare_lines_gather(ctx,node->l)<0) return -1;
+  if (node->nlc<0) {
+    if (ctx->nodec>=ctx->nodea) {
+      int na=ctx->nodea+256;
+      if (na>INT_MAX/sizeof(void*)) return -1;
+      void *nv=realloc(ctx->nodev,sizeof(void*)*na);
+      if (!nv) return -1;
+      ctx->nodev=nv;
+      ctx->nodea=na;
+    }
+    ctx->nodev[ctx->nodec++]=node;
+  }
+  return doc_prepare_lines_gather(ctx,node->r);
+}
+
+static int doc_prepare_lines_cb(int p,void *userdata) {
+  struct doc_prepare_lines *ctx=userdata;
+  struct doc_node *node=ctx->nodev[p];
+  node->nlc=doc_count_newlines(doc_node_src(ctx->doc,node),node->len);
+  return 0;
+}
+
+void doc_prepare_lines(struct doc *doc,struct pool *pool) {
+  if (!doc) return;
+  struct doc_prepare_lines ctx={.doc=doc};
+  if (pool&&(doc_prepare_lines_gather(&ctx,doc->root)>=0)) {
+    pool_run_batch(pool,ctx.nodec,doc_prepare_lines_cb,&ctx);
+  }
+  if (ctx.nodev) free(ctx.nodev);
+  doc_require_newlines(doc);
+}
+
+/* Lookups count as they go.
+ * Walk pieces in order, counting the ones we pass, and stop at the one we want.
+ * Whole subtrees that are counted already and lie before the target get skipped, so once everything is counted it's a plain descent.
+ * Any subtree we finish walking gets its sums fixed on the way out.
+ */
+
+struct doc_walk {
+  int64_t line; // Newlines to pass, for doc_walk_to_line.
+  int64_t p; // Bytes to pass, for doc_walk_to_offset.
+  int64_t base; // Offset or line reached so far.
+  int found;
+};
+
+static void doc_walk_to_line(struct doc *doc,struct doc_node *node,struct doc_walk *walk) {
+  if (!node||walk->found) return;
+  if ((node->sumnlc>=0)&&(walk->line>node->sumnlc)) {
+    walk->line-=node->sumnlc;
+    walk->base+=node->sumlen;
+    return;
+  }
+  doc_walk_to_line(doc,node->l,walk);
+  if (walk->found) return;
+  if (node->nlc<0) node->nlc=doc_count_newlines(doc_node_src(doc,node),node->len);
+  if (walk->line<=node->nlc) { // It's the (line)th newline in this piece, and our line starts right after.
+    const char *src=doc_node_src(doc,node),*p=src;
+    for (;;) {
+      p=(const char*)memchr(p,0x0a,node->len-(p-src))+1;
+      if (!--(walk->line)) break;
+    }
+    walk->base+=p-src;
+    walk->found=1;
+    return;
+  }
+  walk->line-=node->nlc;
+  walk->base+=node->len;
+  doc_walk_to_line(doc,node->r,walk);
+  doc_node_update(node);
+}
+
+static void doc_walk_to_offset(struct doc *doc,struct doc_node *node,struct doc_walk *walk) {
+  if (!node||walk->found) return;
+  if ((node->sumnlc>=0)&&(walk->p>=node->sumlen)) {
+    walk->p-=node->sumlen;
+    walk->base+=node->sumnlc;
+    return;
+  }
+  doc_walk_to_offset(doc,node->l,walk);
+  if (walk->found) return;
+  if (walk->p<node->len) {
+    walk->base+=doc_count_newlines(doc_node_src(doc,node),walk->p);
+    walk->found=1;
+    return;
+  }
+  if (node->nlc<0) node->nlc=doc_count_newlines(doc_node_src(doc,node),node->len);
+  walk->p-=node->len;
+  walk->base+=node->nlc;
+  doc_walk_to_offset(doc,node->r,walk);
+  doc_node_update(node);
+}
+
+/* Line count.
+ */
+
+int64_t doc_get_line_count(struct doc *doc) {
+  if (!doc||!doc->root) return 1;
+  doc_require_newlines(doc);
+  return doc->root->sumnlc+1;
+}
+
+int64_t doc_get_line_count_upto(struct doc *doc,int64_t limit) {
+  if (limit<=1) return 1;
+  if (!doc||!doc->root) return 1;
+  if (doc->root->sumnlc>=0) return (doc->root->sumnlc<limit)?(doc->root->sumnlc+1):limit;
+  struct doc_walk walk={.line=limit-1};
+  doc_walk_to_line(doc,doc->root,&walk);
+  if (walk.found) return limit;
+  return limit-walk.line;
+}
+
+int doc_lines_counted(const struct doc *doc) {
+  if (!doc||!doc->root) return 1;
+  return (doc->root->sumnlc>=0);
+}
+
+/* Start of line.
+ */
+
+int64_t doc_offset_from_line(struct doc *doc,int64_t line) {
+  if (!doc||(line<=0)) return 0;
+  struct doc_walk walk={.line=line};
+  doc_walk_to_line(doc,doc->root,&walk);
+  return walk.base;
+}
+
+/* Line at offset.
+ */
+
+int64_t doc_line_from_offset(struct doc *doc,int64_t p) {
+  if (!doc||(p<=0)) return 0;
+  struct doc_walk walk={.p=p};
+  doc_walk_to_offset(doc,doc->root,&walk);
+  return walk.base;
+}
+
+/* Census.
+ * Tally newlines in the original text by fixed blocks, and keep the running total at each block boundary.
+ * Then any piece of the original counts in two partial blocks at most, plus a subtraction.
+ */
+
+#define DOC_CENSUS_BLOCK_SIZE 65536
+#define DOC_CENSUS_BATCH 256 /* Blocks per call from the pool. */
+
+struct doc_census {
+  struct doc *doc; // STRONG
+  struct pool *pool; // WEAK, optional
+  int64_t *totalv; // Newlines in the original text before each block boundary, (blockc+1) of them. Null until run.
+  int64_t blockc;
+};
+
+void doc_census_del(struct doc_census *census) {
+  if (!census) return;
+  doc_del(census->doc);
+  if (census->totalv) free(census->totalv);
+  free(census);
+}
+
+struct doc_census *doc_census_new(struct doc *doc,struct pool *pool) {
+  if (!doc) return 0;
+  struct doc_census *census=calloc(1,sizeof(struct doc_census));
+  if (!census) return 0;
+  if (doc_ref(doc)<0) {
+    free(census);
+    return 0;
+  }
+  census->doc=doc;
+  census->pool=pool;
+  return census;
+}
+
+struct doc *doc_census_get_doc(const struct doc_census *census) {
+  if (!census) return 0;
+  return census->doc;
+}
+
+// Each block's own count goes in the slot after it, then run adds them up.
+static int doc_census_cb(int p,void *userdata) {
+  struct doc_census *census=userdata;
+  int64_t block=(int64_t)p*DOC_CENSUS_BATCH;
+  int64_t blockz=block+DOC_CENSUS_BATCH;
+  if (blockz>census->blockc) blockz=census->blockc;
+  for (;block<blockz;block++) {
+    int64_t off=block*DOC_CENSUS_BLOCK_SIZE;
+    int64_t len=census->doc->origc-off;
+    if (len>DOC_CENSUS_BLOCK_SIZE) len=DOC_CENSUS_BLOCK_SIZE;
+    census->totalv[block+1]=doc_count_newlines(census->doc->orig+off,len);
+  }
+  return 0;
+}
+
+int doc_census_run(struct doc_census *census) {
+  if (!census||census->totalv) return -1;
+  int64_t blockc=(census->doc->origc+DOC_CENSUS_BLOCK_SIZE-1)/DOC_CENSUS_BLOCK_SIZE;
+  int64_t batchc=(blockc+DOC_CENSUS_BATCH-1)/DOC_CENSUS_BATCH;
+  if (batchc>INT_MAX) return -1;
+  int64_t *totalv=malloc(sizeof(int64_t)*(blockc+1));
+  if (!totalv) return -1;
+  totalv[0]=0;
+  census->totalv=totalv;
+  census->blockc=blockc;
+  if (pool_run_batch(census->pool,batchc,doc_census_cb,census)<0) {
+    census->totalv=0;
+    free(totalv);
+    return -1;
+  }
+  int64_t i=0;
+  for (;i<blockc;i++) totalv[i+1]+=totalv[i];
+  return 0;
+}
+
+static int64_t doc_census_count(const struct doc_census *census,int64_t off,int64_t len) {
+  const char *src=census->doc->orig;
+  int64_t a=(off+DOC_CENSUS_BLOCK_SIZE-1)/DOC_CENSUS_BLOCK_SIZE; // First whole block.
+  int64_t z=(off+len)/DOC_CENSUS_BLOCK_SIZE; // Block after the last whole one.
+  if (a>=z) return doc_count_newlines(src+off,len);
+  int64_t aoff=a*DOC_CENSUS_BLOCK_SIZE,zoff=z*DOC_CENSUS_BLOCK_SIZE;
+  return
+    doc_count_newlines(src+off,aoff-off)+
+    census->totalv[z]-census->totalv[a]+
+    doc_count_newlines(src+zoff,off+len-zoff);
+}
+
+static void doc_census_apply_1(struct doc_census *census,struct doc_node *node) {
+  if (!node||(node->sumnlc>=0)) return;
+  doc_census_apply_1(census,node->l);
+  if (node->nlc<0) {
+    if (node->buf==DOC_BUF_ORIGINAL) node->nlc=doc_census_count(census,node->off,node->len);
+    else node->nlc=doc_count_newlines(doc_node_src(census->doc,node),node->len);
+  }
+  doc_census_apply_1(census,node->r);
+  doc_node_update(node);
+}
+
+void doc_census_apply(struct doc_census *census) {
+  if (!census) return;
+  if (census->totalv) doc_census_apply_1(census,census->doc->root);
+  else doc_require_newlines(census->doc);
+}
@@ -0,0 +1,202 @@
+#include "doc_internal.h"
+#if USE_fs
+  #include "opt/fs/fs.h"
+#endif
+
+/* Delete.
+ */
+
+void doc_del(struct doc *doc) {
+  if (!doc) return;
+  if (doc->refc-->1) return;
+  doc_node_del(doc->root);
+  if (doc->origown) free((void*)doc->orig);
+  #if USE_fs
+    file_unmap(doc->map);
+  #endif
+  if (doc->add) free(doc->add);
+  free(doc);
+}
+
+/* Retain.
+ */
+
+int doc_ref(struct doc *doc) {
+  if (!doc) return -1;
+  if ((doc->refc<1)||(doc->refc>=INT_MAX)) return -1;
+  doc->refc++;
+  return 0;
+}
+
+/* New.
+ */
+
+struct doc *doc_new() {
+  struct doc *doc=calloc(1,sizeof(struct doc));
+  if (!doc) return 0;
+  doc->refc=1;
+  doc->rand=0x2545f491;
+  return doc;
+}
+
+/* New with original text.
+ * Cut it into pieces of uniform size, with newlines not counted yet.
+ * Merging each at the right edge is cheap; the tree only ever has a logarithmic right spine.
+ */
+
+static struct doc *doc_new_original(const void *src,int64_t srcc,int own) {
+  if (!src&&srcc) return 0;
+  if (srcc<0) return 0;
+  struct doc *doc=doc_new();
+  if (!doc) return 0;
+  int64_t p=0;
+  while (p<srcc) {
+    int64_t len=srcc-p;
+    if (len>DOC_ORIGINAL_PIECE_SIZE) len=DOC_ORIGINAL_PIECE_SIZE;
+    struct doc_node *node=doc_node_new(doc,DOC_BUF_ORIGINAL,p,len,-1);
+    if (!node) {
+      doc_del(doc);
+      return 0;
+    }
+    doc->root=doc_tree_merge(doc->root,node);
+    p+=len;
+  }
+  doc->orig=src;
+  doc->origc=srcc;
+  doc->origown=own;
+  return doc;
+}
+
+struct doc *doc_new_borrow(const void *src,int64_t srcc) {
+  return doc_new_original(src,srcc,0);
+}
+
+struct doc *doc_new_handoff(void *src,int64_t srcc) {
+  return doc_new_original(src,srcc,1);
+}
+
+/* New from file.
+ * No access hint: Counting lines reads front to back, then viewing jumps around. The OS's default suits both.
+ */
+
+struct doc *doc_new_from_path(const char *path) {
+  #if USE_fs
+    struct file_map *map=file_map(path,0);
+    if (!map) return 0;
+    struct doc *doc=doc_new_original(map->v,map->c,0);
+    if (!doc) {
+      file_unmap(map);
+      return 0;
+    }
+    doc->map=map;
+    return doc;
+  #else
+    return 0;
+  #endif
+}
+
+/* Trivial accessors.
+ */
+
+int64_t doc_get_length(const struct doc *doc) {
+  if (!doc||!doc->root) return 0;
+  return doc->root->sumlen;
+}
+
+/* Read.
+ */
+
+int doc_get_segment(void *dstpp,const struct doc *doc,int64_t p) {
+  if (!doc||(p<0)) return 0;
+  const struct doc_node *node=doc->root;
+  while (node) {
+    int64_t leftlen=node->l?node->l->sumlen:0;
+    if (p<leftlen) {
+      node=node->l;
+      continue;
+    }
+    p-=leftlen;
+    if (p<node->len) {
+      if (dstpp) *(const char**)dstpp=doc_node_src(doc,node)+p;
+      int64_t len=node->len-p;
+      if (len>INT_MAX) len=INT_MAX;
+      return len;
+    }
+    p-=node->len;
+    node=node->r;
+  }
+  return 0;
+}
+
+int doc_read(void *dst,int dsta,const struct doc *doc,int64_t p) {
+  if (!dst||(dsta<1)) return 0;
+  int dstc=0;
+  while (dstc<dsta) {
+    const char *src;
+    int srcc=doc_get_segment(&src,doc,p);
+    if (srcc<1) break;
+    if (srcc>dsta-dstc) srcc=dsta-dstc;
+    memcpy((char*)dst+dstc,src,srcc);
+    dstc+=srcc;
+    p+=srcc;
+  }
+  return dstc;
+}
+
+/* Append to the add buffer, and return the offset where it landed.
+ */
+
+static int64_t doc_add_text(struct doc *doc,const void *src,int srcc) {
+  if (doc->addc>doc->adda-srcc) {
+    int64_t na=doc->adda<<1;
+    if (na<doc->addc+srcc) na=doc->addc+srcc;
+    if (na<4096) na=4096;
+    if ((uint64_t)na>SIZE_MAX) return -1;
+    void *nv=realloc(doc->add,na);
+    if (!nv) return -1;
+    doc->add=nv;
+    doc->adda=na;
+  }
+  int64_t p=doc->addc;
+  memcpy(doc->add+p,src,srcc);
+  doc->addc+=srcc;
+  return p;
+}
+
+/* Replace.
+ */
+
+int doc_replace(struct doc *doc,int64_t p,int64_t c,const void *src,int srcc) {
+  if (!doc) return -1;
+  if (!src) srcc=0; else if (srcc<0) { srcc=0; while (((char*)src)[srcc]) srcc++; }
+  int64_t len=doc_get_length(doc);
+  if ((p<0)||(c<0)||(p>len-c)) return -1;
+  if (!c&&!srcc) return 0;
+
+  // Stage the new text first, so nothing can fail after we start cutting.
+  int64_t addp=0,nlc=0;
+  struct doc_node *node=0;
+  if (srcc) {
+    if ((addp=doc_add_text(doc,src,srcc))<0) return -1;
+    nlc=doc_count_newlines(doc->add+addp,srcc);
+    if (!(node=doc_node_new(doc,DOC_BUF_ADD,addp,srcc,nlc))) return -1;
+  }
+
+  struct doc_node *a,*b,*m,*z;
+  if (doc_tree_split(&a,&b,doc,doc->root,p)<0) {
+    free(node);
+    return -1;
+  }
+  if (doc_tree_split(&m,&z,doc,b,c)<0) {
+    doc->root=doc_tree_merge(a,b);
+    free(node);
+    return -1;
+  }
+  doc_node_del(m);
+  if (node&&doc_tree_extend_last(a,DOC_BUF_ADD,addp,srcc,nlc)) {
+    free(node);
+    node=0;
+  }
+  doc->root=doc_tree_merge(doc_tree_merge(a,node),z);
+  return 0;
+}
@@ -0,0 +1,134 @@
+/* doc_tree.c
+ * Treap of pieces, keyed implicitly by position.
+ * All restructuring is split and merge, and the recursion is as deep as the tree, ie logarithmic.
+ */
+
+#include "doc_internal.h"
+
+/* Node lifecycle.
+ */
+
+void doc_node_del(struct doc_node *node) {
+  if (!node) return;
+  doc_node_del(node->l);
+  doc_node_del(node->r);
+  free(node);
+}
+
+struct doc_node *doc_node_new(struct doc *doc,int buf,int64_t off,int64_t len,int64_t nlc) {
+  struct doc_node *node=calloc(1,sizeof(struct doc_node));
+  if (!node) return 0;
+  // xorshift32. Priorities only need to be unpredictable with respect to the edits.
+  doc->rand^=doc->rand<<13;
+  doc->rand^=doc->rand>>17;
+  doc->rand^=doc->rand<<5;
+  node->pri=doc->rand;
+  node->buf=buf;
+  node->off=off;
+  node->len=len;
+  node->nlc=nlc;
+  node->sumlen=len;
+  node->sumnlc=nlc;
+  return node;
+}
+
+void doc_node_update(struct doc_node *node) {
+  node->sumlen=node->len;
+  node->sumnlc=node->nlc;
+  if (node->l) {
+    node->sumlen+=node->l->sumlen;
+    if ((node->sumnlc<0)||(node->l->sumnlc<0)) node->sumnlc=-1;
+    else node->sumnlc+=node->l->sumnlc;
+  }
+  if (node->r) {
+    node->sumlen+=node->r->sumlen;
+    if ((node->sumnlc<0)||(node->r->sumnlc<0)) node->sumnlc=-1;
+    else node->sumnlc+=node->r->sumnlc;
+  }
+}
+
+/* Merge: Everything in (a) comes before everything in (b).
+ */
+
+struct doc_node *doc_tree_merge(struct doc_node *a,struct doc_node *b) {
+  if (!a) return b;
+  if (!b) return a;
+  if (a->pri>=b->pri) {
+    a->r=doc_tree_merge(a->r,b);
+    doc_node_update(a);
+    return a;
+  }
+  b->l=doc_tree_merge(a,b->l);
+  doc_node_update(b);
+  return b;
+}
+
+/* Split so (*a) has the first (p) bytes and (*b) the rest.
+ * If (p) falls inside a piece, it becomes two pieces.
+ * Fails only if we need a new node and can't allocate it; then the tree is untouched.
+ */
+
+static int doc_tree_split_piece(struct doc_node **right,struct doc *doc,struct doc_node *node,int64_t k) {
+  int64_t rnlc=-1;
+  if (node->nlc>=0) {
+    // Count whichever side is shorter.
+    const char *src=doc_node_src(doc,node);
+    if (k>=node->len-k) rnlc=doc_count_newlines(src+k,node->len-k);
+    else rnlc=node->nlc-doc_count_newlines(src,k);
+  }
+  if (!(*right=doc_node_new(doc,node->buf,node->off+k,node->len-k,rnlc))) return -1;
+  node->len=k;
+  if (rnlc>=0) node->nlc-=rnlc;
+  return 0;
+}
+
+int doc_tree_split(struct doc_node **a,struct doc_node **b,struct doc *doc,struct doc_node *node,int64_t p) {
+  if (!node) {
+    *a=*b=0;
+    return 0;
+  }
+  int64_t leftlen=node->l?node->l->sumlen:0;
+  if (p<=leftlen) {
+    struct doc_node *la,*lb;
+    if (doc_tree_split(&la,&lb,doc,node->l,p)<0) return -1;
+    node->l=lb;
+    doc_node_update(node);
+    *a=la;
+    *b=node;
+    return 0;
+  }
+  if (p>=leftlen+node->len) {
+    struct doc_node *ra,*rb;
+    if (doc_tree_split(&ra,&rb,doc,node->r,p-leftlen-node->len)<0) return -1;
+    node->r=ra;
+    doc_node_update(node);
+    *a=node;
+    *b=rb;
+    return 0;
+  }
+  struct doc_node *right;
+  if (doc_tree_split_piece(&right,doc,node,p-leftlen)<0) return -1;
+  struct doc_node *rest=node->r;
+  node->r=0;
+  doc_node_update(node);
+  *a=node;
+  *b=doc_tree_merge(right,rest);
+  return 0;
+}
+
+/* If the last piece in (node) ends exactly at (buf,off), grow it by (len,nlc) and return >0.
+ * That's typing: Every keystroke would be a new piece otherwise.
+ */
+
+int doc_tree_extend_last(struct doc_node *node,int buf,int64_t off,int64_t len,int64_t nlc) {
+  if (!node) return 0;
+  if (node->r) {
+    if (!doc_tree_extend_last(node->r,buf,off,len,nlc)) return 0;
+  } else {
+    if ((node->buf!=buf)||(node->off+node->len!=off)) return 0;
+    node->len+=len;
+    if (node->nlc>=0) node->nlc+=nlc;
+  }
+  doc_node_update(node);
+  return 1;
+}
@@ -1,10 +1,11 @@
 /* font.h
  * Quirky and opinionated pure-software text rendering.
  *  - All text is monospaced.
- *  - Only G0 displays normally.
- *  - We can produce tofu for non-G0 codepoints.
- *  - Glyphs come from a 16x7-cell image that you provide.
+ *  - Image fonts display only G0 normally. PSF fonts display whatever their unicode table covers.
+ *  - We can produce tofu for anything the font doesn't cover.
+ *  - Glyphs come from a 16x7-cell image that you provide, or a PSF file.
  *  - Only 32-bit images can be rendered to. We could add more if needed; see font_render.c.
+ *  - Fonts are 1-bit by default. Use font_new_a8 for anti-aliased glyphs, from a grayscale image.
  * Source images:
  *  - Top 6 rows are 0x20..0x7f.
  *  - Bottom row starts with tofu frames. Must align to column boundaries. A rectangular outline, filled with boxes of uniform size.
@@ -29,14 +30,46 @@ int font_ref(struct font *font);
 struct font *font_new(struct image *image,const struct text_encoding *encoding);
 struct font *font_new_from_path(const char *path,const struct text_encoding *encoding);
 
+/* Anti-aliased font, keeping 8 bits of coverage per pixel.
+ * Coverage comes from luminance and alpha, so a gray PNG, gray+alpha, or white-on-transparent RGBA all work.
+ * Rendering blends against the destination instead of overwriting.
+ */
+struct font *font_new_a8(struct image *image,const struct text_encoding *encoding);
+struct font *font_new_a8_from_path(const char *path,const struct text_encoding *encoding);
+
+/* New font with each pixel of (font) blown up to a (scale)x(scale) square.
+ * Expansion happens once here, so rendering at 2x or 3x costs no more per pixel than 1x.
+ * Colors and encoding carry over. (scale==1) returns (font) itself with a new reference.
+ */
+struct font *font_new_scaled(struct font *font,int scale);
+
+/* Wrap an A1 image that's already in our format: Big-endian, 16x7 glyphs, rows (stride) bytes apart.
+ * We borrow (a1) without copying, it must outlive the font. Meant for atlases compiled into the program (see src/tool/mkfont).
+ */
+struct font *font_new_from_a1(const void *a1,int w,int h,int stride,const struct text_encoding *encoding);
+
+/* PC Screen Font, version 1 or 2, can cover much more than G0.
+ * We don't convert the glyphs; they're read straight from the file, which we map if possible.
+ * With the Unicode table, codepoints are looked up in blocks of 256, built the first time each block is used.
+ * Without, glyphs are indexed by codepoint.
+ * PSF fonts can't be scaled: font_new_scaled fails.
+ */
+struct font *font_new_psf(const void *src,int srcc,const struct text_encoding *encoding);
+struct font *font_new_psf_from_path(const char *path,const struct text_encoding *encoding);
+
 /* Retrieve size of one glyph.
  */
 int font_get_width(const struct font *font);
 int font_get_height(const struct font *font);
 
+/* Nonzero if we have a real glyph for this codepoint, ie font_render_glyph will succeed.
+ * For image fonts, that's exactly G0.
+ */
+int font_has_glyph(struct font *font,int codepoint);
+
 /* Render one glyph with top-left corner at (dstx,dsty).
  * Both return the horizontal advancement on success.
- * font_render_glyph fails for anything outside G0; you should then call font_render_tofu.
+ * font_render_glyph fails for anything we don't have a glyph for (see font_has_glyph); you should then call font_render_tofu.
  */
 int font_render_glyph(struct image *dst,int dstx,int dsty,struct font *font,int codepoint,uint32_t color);
 int font_render_tofu(struct image *dst,int dstx,int dsty,struct font *font,int codepoint,uint32_t color);
@@ -68,4 +101,96 @@ int font_measure_tofu(struct font *font,int codepoint);
  */
 int font_render_string(struct image *dst,int dstx,int dsty,struct font *font,const char *src,int srcc);
 
+/* Line index.
+ * For very long lines, remembers the x position of a codepoint boundary every (interval) bytes or so.
+ * Then measuring or locating only needs to decode from the nearest checkpoint, not the start of the line.
+ * The index doesn't hold the font or text; pass the same font and the current text every time.
+ * It builds itself on first use, and rebuilds if the text length changes behind its back.
+ * After editing, call font_line_index_replace with the new text to patch it up.
+ * If you change font, invalidate.
+ * Like text_encoder, zero is a valid initial state, and you must clean up.
+ ****************************************************************/
+
+#define FONT_LINE_INDEX_INTERVAL_DEFAULT 256
+
+struct font_line_index {
+  struct font_line_checkpoint { int p,x; } *v; // Sorted by both. (v[0]) is (0,0) when built. Empty if not built.
+  int c,a;
+  int interval; // Bytes between checkpoints. Zero for the default.
+  int srcc; // Length of text when built, or -1 while building from windows.
+  int w; // Width of the entire text.
+};
+
+void font_line_index_cleanup(struct font_line_index *index);
+void font_line_index_invalidate(struct font_line_index *index);
+int font_line_index_build(struct font_line_index *index,struct font *font,const char *src,int srcc);
+
+/* Same results as font_measure_string(font,src,p) and font_locate_point(font,src,srcc,x).
+ * (p) must be a codepoint boundary.
+ */
+int font_line_index_measure(struct font_line_index *index,struct font *font,const char *src,int srcc,int p);
+int font_line_index_locate(struct font_line_index *index,struct font *font,const char *src,int srcc,int x);
+
+/* (src,srcc) is the new text, after you replaced (rmc) bytes at (p) with (addc) new ones.
+ * Only the neighborhood of the edit gets decoded again.
+ */
+int font_line_index_replace(struct font_line_index *index,struct font *font,const char *src,int srcc,int p,int rmc,int addc);
+
+/* Windows, for text you don't hold contiguous, eg a line of a doc.
+ * (src,srcc) is the part of the text at (base), and (total) is the length of the whole thing.
+ * build_window: Start with (base) zero, then call again from wherever the last call returned, until that's (total).
+ * It stops a few bytes short of each window's end, so nothing decodes across the edge.
+ * span_p and span_x: Which part of the text to read yourself, returning the x position where it starts, or <0 if not built.
+ * Measure (*spanp..p), or locate (x-returned) within (*spanp..*spanp+*spanc), and add what we returned.
+ * replace_window: From two intervals before (p) to two after the added text is plenty.
+ * If that's not enough, eg badly misencoded text, the index goes invalid, and you'll have to build it again.
+ */
+int font_line_index_build_window(struct font_line_index *index,struct font *font,const char *src,int srcc,int base,int total);
+int font_line_index_span_p(int *spanp,const struct font_line_index *index,int p);
+int font_line_index_span_x(int *spanp,int *spanc,const struct font_line_index *index,int x);
+int font_line_index_replace_window(struct font_line_index *index,struct font *font,const char *src,int srcc,int base,int total,int p,int rmc,int addc);
+
+/* Soft wrap.
+ * Breaks one line into rows no wider than (w), and returns the row count, always at least one.
+ * (breakv) gets the offset where each row after the first begins, as many as fit in (breaka).
+ * We break after the last space that fits, or at the edge if there isn't one. Spaces may hang past the edge.
+ */
+int font_wrap_line(int *breakv,int breaka,struct font *font,const char *src,int srcc,int w);
+
+/* Wrap index.
+ * Visual row count of each line in a document, for soft wrap, with prefix sums for converting between lines and rows.
+ * Counts can be guesses ("stale"), eg after the width changes, and you replace them with real ones as you measure.
+ * That way a view can measure what's visible first and the rest at leisure.
+ * Like font_line_index, zero is a valid initial state (no lines), and you must clean up.
+ * If replace fails, the index is unusable until you reset it.
+ ****************************************************************/
+
+#define FONT_WRAP_BLOCK_SIZE 256
+
+struct font_wrap_index {
+  struct font_wrap_block **blockv; // Private, see font_wrap_index.c.
+  int blockc,blocka;
+  int *linetree; // Fenwick trees over the blocks.
+  int64_t *rowtree;
+  int treea;
+  int linec;
+  int64_t rowc; // Total rows, guesses included.
+  int stalec; // How many lines are guesses.
+};
+
+void font_wrap_index_cleanup(struct font_wrap_index *index);
+int font_wrap_index_reset(struct font_wrap_index *index,int linec); // (linec) lines of one row each, all stale.
+void font_wrap_index_invalidate(struct font_wrap_index *index); // Mark everything stale, keeping the counts as guesses.
+
+/* Lines (line..line+rmc-1) were replaced by (addc) new ones, stale at one row each.
+ */
+int font_wrap_index_replace(struct font_wrap_index *index,int line,int rmc,int addc);
+
+int font_wrap_index_get(int *stale,const struct font_wrap_index *index,int line); // => rows, zero if out of range.
+int font_wrap_index_set(struct font_wrap_index *index,int line,int rowc); // Measured, no longer stale.
+
+int64_t font_wrap_index_row_from_line(const struct font_wrap_index *index,int line); // => First row of (line).
+int font_wrap_index_line_from_row(int *sub,const struct font_wrap_index *index,int64_t row); // => Line containing (row), clamped. (sub) is the row within it.
+int font_wrap_index_next_stale(const struct font_wrap_index *index,int line); // => First stale line at or after (line), or -1.
+
 #endif
@@ -0,0 +1,116 @@
+/* font_a8.c
+ * Anti-aliased fonts: One byte of coverage per pixel instead of one bit.
+ * We blend each channel byte independently, so it works for any 32-bit pixel order the WM gives us.
+ */
+
+#include "font_internal.h"
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+/* Coverage of one source pixel.
+ * Luminance times alpha, whatever channels the image has.
+ * 16-bit pixels are assumed to be gray+alpha; 16-bit gray is silly for a font.
+ */
+
+static inline uint8_t font_a8_coverage_ga(uint8_t g,uint8_t a) {
+  return (g*a+127)/255;
+}
+
+static inline uint8_t font_a8_coverage_rgba(const uint8_t *src) {
+  int luma=(src[0]*77+src[1]*150+src[2]*29)>>8;
+  return font_a8_coverage_ga(luma,src[3]);
+}
+
+/* Copy image into font as A8.
+ * Caller must initialize font to image's size, with (img) at least (imgstride*imgh) bytes.
+ */
+
+void font_copy_image_a8(struct font *font,struct image *image) {
+  if (!font||!image) return;
+  if ((font->imgw!=image->w)||(font->imgh!=image->h)) return;
+  uint8_t *dstrow=font->img;
+  const uint8_t *srcrow=image->v;
+  int yi=image->h;
+  for (;yi-->0;dstrow+=font->imgstride,srcrow+=image->stride) {
+    uint8_t *dstp=dstrow;
+    int xi=0;
+    switch (image->pixelsize) {
+      case 1: for (;xi<image->w;xi++) *(dstp++)=(srcrow[xi>>3]&(0x80>>(xi&7)))?0xff:0; break;
+      case 8: memcpy(dstp,srcrow,image->w); break;
+      case 16: for (;xi<image->w;xi++) *(dstp++)=font_a8_coverage_ga(srcrow[xi<<1],srcrow[(xi<<1)+1]); break;
+      case 24: for (;xi<image->w;xi++) *(dstp++)=(srcrow[xi*3]*77+srcrow[xi*3+1]*150+srcrow[xi*3+2]*29)>>8; break;
+      case 32: for (;xi<image->w;xi++) *(dstp++)=font_a8_coverage_rgba(srcrow+(xi<<2)); break;
+    }
+  }
+}
+
+/* Blend one row of coverage onto 32-bit pixels.
+ * Per byte: dst=(dst*(255-a)+color*a)/255, rounded.
+ */
+
+static void font_a8_blend_row_scalar(uint32_t *dst,const uint8_t *cov,int c,uint32_t color) {
+  const uint8_t *colorv=(const uint8_t*)&color;
+  for (;c-->0;dst++,cov++) {
+    uint8_t a=*cov;
+    if (!a) continue;
+    if (a==0xff) { *dst=color; continue; }
+    uint8_t *dstv=(uint8_t*)dst;
+    int i=4; while (i-->0) {
+      int t=dstv[i]*(255-a)+colorv[i]*a+128;
+      dstv[i]=(t+(t>>8))>>8;
+    }
+  }
+}
+
+#if defined(__SSE2__)
+
+static void font_a8_blend_row(uint32_t *dst,const uint8_t *cov,int c,uint32_t color) {
+  const __m128i zero=_mm_setzero_si128();
+  const __m128i k255=_mm_set1_epi16(255);
+  const __m128i k128=_mm_set1_epi16(128);
+  const __m128i color16=_mm_unpacklo_epi8(_mm_set1_epi32(color),zero); // 2 pixels, 16 bits per channel.
+  for (;c>=4;c-=4,dst+=4,cov+=4) {
+    uint32_t cov4;
+    memcpy(&cov4,cov,4);
+    if (!cov4) continue; // Most of a glyph's cell is empty, and this is where we make up time.
+    if (cov4==0xffffffff) {
+      _mm_storeu_si128((__m128i*)dst,_mm_set1_epi32(color));
+      continue;
+    }
+    __m128i a=_mm_unpacklo_epi8(_mm_cvtsi32_si128(cov4),zero); // a0..a3 in 16 bits
+    a=_mm_unpacklo_epi16(a,a); // a0 a0 a1 a1 a2 a2 a3 a3
+    __m128i alo=_mm_unpacklo_epi32(a,a); // Each pixel's coverage in all four channels.
+    __m128i ahi=_mm_unpackhi_epi32(a,a);
+    __m128i d=_mm_loadu_si128((const __m128i*)dst);
+    __m128i dlo=_mm_unpacklo_epi8(d,zero);
+    __m128i dhi=_mm_unpackhi_epi8(d,zero);
+    #define BLEND(dd,aa) { \
+      __m128i t=_mm_add_epi16(_mm_mullo_epi16(dd,_mm_sub_epi16(k255,aa)),_mm_mullo_epi16(color16,aa)); \
+      t=_mm_add_epi16(t,k128); \
+      dd=_mm_srli_epi16(_mm_add_epi16(t,_mm_srli_epi16(t,8)),8); \
+    }
+    BLEND(dlo,alo)
+    BLEND(dhi,ahi)
+    #undef BLEND
+    _mm_storeu_si128((__m128i*)dst,_mm_packus_epi16(dlo,dhi));
+  }
+  if (c>0) font_a8_blend_row_scalar(dst,cov,c,color);
+}
+
+#else
+
+static void font_a8_blend_row(uint32_t *dst,const uint8_t *cov,int c,uint32_t color) {
+  font_a8_blend_row_scalar(dst,cov,c,color);
+}
+
+#endif
+
+/* Blit a block of coverage rows.
+ */
+
+void font_blit_a8(uint32_t *dstrow,int dststridewords,const uint8_t *srcrow,int srcstride,int w,int h,uint32_t color) {
+  for (;h-->0;dstrow+=dststridewords,srcrow+=srcstride) {
+    font_a8_blend_row(dstrow,srcrow,w,color);
+  }
+}
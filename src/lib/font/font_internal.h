@@ -13,14 +13,69 @@
 struct font {
   int refc;
   int w,h; // Of one glyph.
-  uint8_t *img; // A1 big-endian, the way PNG does it.
+  uint8_t *img; // A1 big-endian, the way PNG does it. Or A8 if (a8).
+  int a8; // Nonzero if (img) is one byte of coverage per pixel.
+  struct font_psf *psf; // If not null, all glyphs come from here and (img) is unused.
+  int ownimg; // Nonzero if we allocated (img). Fonts from font_new_from_a1 borrow it.
   int imgw,imgh;
   int imgstride;
   uint32_t color_normal,color_missing,color_misencode;
   const struct text_encoding *encoding;
-  //TODO Whatever bookkeeping we need around the tofu.
+  struct font_tofu *tofu; // Null if the image has no usable tofu layout; then we draw plain boxes.
+  int g0; // Nonzero if printable ASCII bytes are one full-width glyph each. See font_g0_init.
+};
+
+#define FONT_DECODE_CHUNK 256 /* Codepoints per text_decoder_read_many, on the stack. */
+
+#define FONT_TOFU_FRAME_LIMIT 8
+#define FONT_TOFU_BOX_LIMIT 8 /* 32 bits of codepoint. */
+#define FONT_TOFU_DIRECT_COUNT 256 /* U+0..U+ff, one slot each. */
+#define FONT_TOFU_SET_COUNT 32 /* Everything else, in a 4-way LRU cache. */
+#define FONT_TOFU_WAY_COUNT 4
+#define FONT_TOFU_ENTRY_COUNT (FONT_TOFU_DIRECT_COUNT+FONT_TOFU_SET_COUNT*FONT_TOFU_WAY_COUNT)
+
+struct font_tofu {
+  struct font_tofu_frame {
+    int x; // In image. Top is the bottom row's top.
+    int cellc;
+    int boxc;
+    int boxxv[FONT_TOFU_BOX_LIMIT],boxyv[FONT_TOFU_BOX_LIMIT]; // Relative to frame. Row-major.
+  } framev[FONT_TOFU_FRAME_LIMIT];
+  int framec;
+  int framep_by_digitc[1+FONT_TOFU_BOX_LIMIT];
+  int hexx,hexy,digitw,digith,digitpitch; // Digit glyphs in image. (digitw==0) if the font has none.
+  struct font_tofu_entry {
+    int codepoint; // -1 if vacant
+    int w;
+    unsigned int stamp; // Least recent in its set gets evicted.
+    uint8_t *bits; // In (bitv), (bitstride*font->h), in the font's format.
+  } entryv[FONT_TOFU_ENTRY_COUNT];
+  uint8_t *bitv; // Allocated at first use.
+  int bitstride;
+  unsigned int stamp;
 };
 
 void font_copy_image(struct font *font,struct image *image);
+void font_g0_init(struct font *font); // Call after (encoding) and glyph source are set.
+
+void font_tofu_init(struct font *font); // Read layout from (img). Not having one is not an error.
+void font_tofu_init_scaled(struct font *dst,const struct font *src,int scale);
+void font_tofu_del(struct font_tofu *tofu);
+
+void font_psf_del(struct font_psf *psf);
+const uint8_t *font_psf_get_glyph(struct font_psf *psf,int codepoint); // A1, (w,h) of the font, rows (rowstride) apart.
+int font_psf_get_rowstride(const struct font_psf *psf);
+void font_copy_image_a8(struct font *font,struct image *image);
+
+/* (dst) must be a writeable 32-bit image; font_blit does the clipping.
+ * (src,srcstride) is a whole A1 or A8 image, and (srcx,srcy,w,h) the part of it to draw.
+ */
+void font_blit(
+  struct image *dst,int dstx,int dsty,
+  const uint8_t *src,int srcstride,int a8,
+  int srcx,int srcy,int w,int h,
+  uint32_t color
+);
+void font_blit_a8(uint32_t *dstrow,int dststridewords,const uint8_t *srcrow,int srcstride,int w,int h,uint32_t color);
 
 #endif
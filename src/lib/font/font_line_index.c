@@ -0,0 +1,314 @@
+/* font_line_index.c
+ * Checkpoints of (byte,x) along one long line of text, every (interval) bytes or so, always on a codepoint boundary.
+ * Measuring or locating only has to decode from the nearest checkpoint.
+ * After an edit, we walk from the last checkpoint the edit can't have disturbed, until the decoder lands on an old checkpoint again,
+ * then shift everything after that by the change in length and width.
+ * The walk only ever needs a window of the text, so callers that don't hold it contiguous can feed us pieces.
+ */
+
+#include "font_internal.h"
+
+/* No encoding looks more than this many bytes ahead of a codepoint's start.
+ * A checkpoint this far before an edit is still on a boundary, and still at the same x, after it.
+ */
+#define FONT_LINE_INDEX_LOOKAHEAD 4
+
+/* Cleanup.
+ */
+
+void font_line_index_cleanup(struct font_line_index *index) {
+  if (!index) return;
+  if (index->v) free(index->v);
+  index->v=0;
+  index->c=0;
+  index->a=0;
+}
+
+void font_line_index_invalidate(struct font_line_index *index) {
+  if (!index) return;
+  index->c=0;
+}
+
+/* Append checkpoint.
+ */
+
+static int font_line_index_append(struct font_line_index *index,int p,int x) {
+  if (index->c>=index->a) {
+    int na=index->a+256;
+    if (na>INT_MAX/sizeof(struct font_line_checkpoint)) return -1;
+    void *nv=realloc(index->v,sizeof(struct font_line_checkpoint)*na);
+    if (!nv) return -1;
+    index->v=nv;
+    index->a=na;
+  }
+  struct font_line_checkpoint *checkpoint=index->v+index->c++;
+  checkpoint->p=p;
+  checkpoint->x=x;
+  return 0;
+}
+
+static inline int font_line_index_interval(const struct font_line_index *index) {
+  if (index->interval>0) return index->interval;
+  return FONT_LINE_INDEX_INTERVAL_DEFAULT;
+}
+
+/* Walk from (*p,*x) to the first boundary at or after (stopp), appending checkpoints as we go.
+ * (src,srcc) is the text at (base..base+srcc). Positions in and out are of the whole text.
+ * The last checkpoint in (index) must be at or before (*p).
+ */
+
+static int font_line_index_walk(struct font_line_index *index,struct font *font,const char *src,int srcc,int base,int *p,int *x,int stopp) {
+  int interval=font_line_index_interval(index);
+  int nextp=index->v[index->c-1].p+interval-base;
+  struct text_decoder decoder={.v=src,.c=srcc,.p=*p-base,.encoding=font->encoding};
+  int codepointv[FONT_DECODE_CHUNK],lenv[FONT_DECODE_CHUNK],codepointc;
+  stopp-=base;
+  if (stopp>srcc) stopp=srcc;
+  while (decoder.p<stopp) {
+    if (font->g0) {
+      int runc=text_g0_run(src+decoder.p,stopp-decoder.p);
+      int runend=decoder.p+runc;
+      for (;nextp<=runend;nextp+=interval) {
+        if (font_line_index_append(index,base+nextp,*x+(nextp-decoder.p)*font->w)<0) return -1;
+      }
+      *x+=runc*font->w;
+      decoder.p=runend;
+      if (decoder.p>=stopp) break;
+    }
+    int pvp=decoder.p;
+    if ((codepointc=text_decoder_read_many(codepointv,lenv,FONT_DECODE_CHUNK,&decoder))<1) break;
+    int i=0;
+    for (;i<codepointc;i++) {
+      int codepoint=codepointv[i];
+      if (codepoint<0) *x+=font_measure_tofu(font,codepoint+0x100);
+      else if (font_has_glyph(font,codepoint)) *x+=font->w;
+      else *x+=font_measure_tofu(font,codepoint);
+      pvp+=lenv[i];
+      if (pvp>=nextp) {
+        if (font_line_index_append(index,base+pvp,*x)<0) return -1;
+        nextp=pvp+interval;
+      }
+      if (pvp>=stopp) break;
+    }
+    decoder.p=pvp; // Might have decoded past (stopp); back up to the boundary where we stopped.
+  }
+  *p=base+decoder.p;
+  return 0;
+}
+
+/* How far we can walk in a window: To its end if that's the end of the text.
+ * Otherwise stop short, so nothing decodes across the edge.
+ */
+
+static inline int font_line_index_window_limit(int srcc,int base,int total) {
+  if (base+srcc>=total) return total;
+  return base+srcc-FONT_LINE_INDEX_LOOKAHEAD;
+}
+
+/* Build.
+ */
+
+int font_line_index_build(struct font_line_index *index,struct font *font,const char *src,int srcc) {
+  if (!index||!font) return -1;
+  if (!src||(srcc<0)) srcc=0;
+  index->c=0;
+  if (font_line_index_append(index,0,0)<0) return -1;
+  int p=0,x=0;
+  if (font_line_index_walk(index,font,src,srcc,0,&p,&x,srcc)<0) {
+    index->c=0;
+    return -1;
+  }
+  index->srcc=srcc;
+  index->w=x;
+  return 0;
+}
+
+/* Build from windows.
+ * While we're partway, (srcc) is -1 and (w) is the x position we've reached.
+ */
+
+int font_line_index_build_window(struct font_line_index *index,struct font *font,const char *src,int srcc,int base,int total) {
+  if (!index||!font||!src||(srcc<0)||(base<0)||(base>total-srcc)) return -1;
+  if (!base) {
+    index->c=0;
+    if (font_line_index_append(index,0,0)<0) return -1;
+    index->w=0;
+  } else if (!index->c||(index->srcc>=0)) {
+    return -1;
+  }
+  index->srcc=-1;
+  int stopp=font_line_index_window_limit(srcc,base,total);
+  if ((stopp<=base)&&(base<total)) return -1;
+  int p=base,x=index->w;
+  if (font_line_index_walk(index,font,src,srcc,base,&p,&x,stopp)<0) {
+    index->c=0;
+    return -1;
+  }
+  index->w=x;
+  if (p>=total) index->srcc=total;
+  return p;
+}
+
+static int font_line_index_require(struct font_line_index *index,struct font *font,const char *src,int srcc) {
+  if (index->c&&(index->srcc==srcc)) return 0;
+  return font_line_index_build(index,font,src,srcc);
+}
+
+/* Search.
+ */
+
+// Index of the last checkpoint at or before (p).
+static int font_line_index_search_p(const struct font_line_index *index,int p) {
+  int lo=0,hi=index->c;
+  while (hi-lo>1) {
+    int ck=(lo+hi)>>1;
+    if (index->v[ck].p<=p) lo=ck;
+    else hi=ck;
+  }
+  return lo;
+}
+
+// Index of the last checkpoint strictly left of (x), or zero.
+static int font_line_index_search_x(const struct font_line_index *index,int x) {
+  int lo=0,hi=index->c;
+  while (hi-lo>1) {
+    int ck=(lo+hi)>>1;
+    if (index->v[ck].x<x) lo=ck;
+    else hi=ck;
+  }
+  return lo;
+}
+
+/* Spans for measuring and locating from a window.
+ * Same searches as below, but the caller reads the text.
+ */
+
+int font_line_index_span_p(int *spanp,const struct font_line_index *index,int p) {
+  if (!index||!index->c||(index->srcc<0)) return -1;
+  if (p<0) p=0; else if (p>index->srcc) p=index->srcc;
+  const struct font_line_checkpoint *checkpoint=index->v+font_line_index_search_p(index,p);
+  *spanp=checkpoint->p;
+  return checkpoint->x;
+}
+
+int font_line_index_span_x(int *spanp,int *spanc,const struct font_line_index *index,int x) {
+  if (!index||!index->c||(index->srcc<0)) return -1;
+  int ckp=font_line_index_search_x(index,x);
+  const struct font_line_checkpoint *checkpoint=index->v+ckp;
+  int endp=(ckp<index->c-1)?checkpoint[1].p:index->srcc;
+  *spanp=checkpoint->p;
+  *spanc=endp-checkpoint->p;
+  return checkpoint->x;
+}
+
+/* Measure.
+ */
+
+int font_line_index_measure(struct font_line_index *index,struct font *font,const char *src,int srcc,int p) {
+  if (!index||!font) return 0;
+  if (!src||(srcc<0)) srcc=0;
+  if (p<=0) return 0;
+  if (p>srcc) p=srcc;
+  if (font_line_index_require(index,font,src,srcc)<0) return font_measure_string(font,src,p);
+  if (p==srcc) return index->w;
+  const struct font_line_checkpoint *checkpoint=index->v+font_line_index_search_p(index,p);
+  return checkpoint->x+font_measure_string(font,src+checkpoint->p,p-checkpoint->p);
+}
+
+/* Locate.
+ * The glyph crossing (x) ends after the checkpoint we find, and no later than the next one.
+ * So searching just that segment is the same as searching the whole line.
+ */
+
+int font_line_index_locate(struct font_line_index *index,struct font *font,const char *src,int srcc,int x) {
+  if (!index||!font) return 0;
+  if (!src||(srcc<0)) srcc=0;
+  if (x<=0) return 0;
+  if (font_line_index_require(index,font,src,srcc)<0) return font_locate_point(font,src,srcc,x);
+  if (x>index->w) return srcc;
+  int ckp=font_line_index_search_x(index,x);
+  const struct font_line_checkpoint *checkpoint=index->v+ckp;
+  int endp=(ckp<index->c-1)?checkpoint[1].p:srcc;
+  return checkpoint->p+font_locate_point(font,src+checkpoint->p,endp-checkpoint->p,x-checkpoint->x);
+}
+
+/* Patch after edit.
+ */
+
+int font_line_index_replace(struct font_line_index *index,struct font *font,const char *src,int srcc,int p,int rmc,int addc) {
+  if (!src||(srcc<0)) srcc=0;
+  return font_line_index_replace_window(index,font,src,srcc,0,srcc,p,rmc,addc);
+}
+
+/* If the window doesn't reach as far as we need, the index is invalid and we return zero, same as if the edit didn't make sense.
+ */
+
+int font_line_index_replace_window(struct font_line_index *index,struct font *font,const char *src,int srcc,int base,int total,int p,int rmc,int addc) {
+  if (!index||!font) return -1;
+  if (!index->c||(index->srcc<0)) { // Not built, nothing to patch.
+    index->c=0;
+    return 0;
+  }
+  if (!src||(srcc<0)) srcc=0;
+  if ((p<0)||(rmc<0)||(addc<0)||(p>index->srcc-rmc)||(index->srcc-rmc+addc!=total)||(base<0)||(base>total-srcc)) {
+    index->c=0;
+    return 0;
+  }
+  int d=addc-rmc;
+  int limit=font_line_index_window_limit(srcc,base,total);
+
+  // Keep checkpoints well clear of the edit. (v[0]) is always safe.
+  int keepc=font_line_index_search_p(index,p-FONT_LINE_INDEX_LOOKAHEAD)+1;
+  if (index->v[keepc-1].p<base) {
+    index->c=0;
+    return 0;
+  }
+
+  // Set aside the ones after it. Those are our candidates to resync with.
+  int tailp=font_line_index_search_p(index,p+rmc);
+  if (index->v[tailp].p<p+rmc) tailp++;
+  if (tailp<keepc) tailp=keepc;
+  int tailc=index->c-tailp;
+  struct font_line_checkpoint *tail=0;
+  if (tailc>0) {
+    if (!(tail=malloc(sizeof(struct font_line_checkpoint)*tailc))) {
+      index->c=0;
+      return -1;
+    }
+    memcpy(tail,index->v+tailp,sizeof(struct font_line_checkpoint)*tailc);
+  }
+  index->c=keepc;
+
+  int wp=index->v[keepc-1].p,x=index->v[keepc-1].x,i=0;
+  for (;i<tailc;i++) {
+    int target=tail[i].p+d;
+    if (target>limit) goto _short_;
+    if (font_line_index_walk(index,font,src,srcc,base,&wp,&x,target)<0) goto _fail_;
+    if (wp!=target) continue; // Decoded over it; try the next.
+    int dx=x-tail[i].x;
+    if (index->v[index->c-1].p==target) index->c--; // The walk may have just put a checkpoint here.
+    for (;i<tailc;i++) {
+      if (font_line_index_append(index,tail[i].p+d,tail[i].x+dx)<0) goto _fail_;
+    }
+    free(tail);
+    index->srcc=total;
+    index->w+=dx;
+    return 0;
+  }
+
+  // Never resynced. Walk to the end.
+  if (limit<total) goto _short_;
+  if (font_line_index_walk(index,font,src,srcc,base,&wp,&x,total)<0) goto _fail_;
+  if (tail) free(tail);
+  index->srcc=total;
+  index->w=x;
+  return 0;
+ _short_:
+  if (tail) free(tail);
+  index->c=0;
+  return 0;
+ _fail_:
+  if (tail) free(tail);
+  index->c=0;
+  return -1;
+}
@@ -1,5 +1,19 @@
 #include "font_internal.h"
 
+/* Width of one decoded codepoint, glyph or tofu.
+ */
+ 
+static inline int font_measure_codepoint(struct font *font,int codepoint) {
+  if (codepoint<0) return font_measure_tofu(font,codepoint+0x100);
+  if (font_has_glyph(font,codepoint)) return font->w;
+  return font_measure_tofu(font,codepoint);
+}
+
+/* With a G0 font, text alternates between runs of printable ASCII, which we measure arithmetically,
+ * and islands of anything else, which we decode this many codepoints at a time before looking for the next run.
+ */
+#define FONT_ISLAND_CHUNK 16
+
 /* Measure string.
  */
 
@@ -8,20 +22,25 @@ int font_measure_string(struct font *font,const char *src,int srcc) {
   if (!src) return 0;
   if (srcc<0) { srcc=0; while (src[srcc]) srcc++; }
   struct text_decoder decoder={.v=src,.c=srcc,.encoding=font->encoding};
-  int w=0,codepoint;
-  while (text_decoder_read(&codepoint,&decoder)>0) {
-    if (codepoint<0) {
-      codepoint+=0x100;
-      w+=font_measure_tofu(font,codepoint);
-    } else {
-      if ((codepoint>=0x20)&&(codepoint<=0x7f)) w+=font->w;
-      else w+=font_measure_tofu(font,codepoint);
+  int w=0,codepointv[FONT_DECODE_CHUNK],codepointc;
+  int chunk=font->g0?FONT_ISLAND_CHUNK:FONT_DECODE_CHUNK;
+  while (decoder.p<decoder.c) {
+    if (font->g0) {
+      int runc=text_g0_run(src+decoder.p,srcc-decoder.p);
+      w+=runc*font->w;
+      decoder.p+=runc;
     }
+    if ((codepointc=text_decoder_read_many(codepointv,0,chunk,&decoder))<1) break;
+    const int *codepoint=codepointv;
+    for (;codepointc-->0;codepoint++) w+=font_measure_codepoint(font,*codepoint);
   }
   return w;
 }
 
 /* Reverse measure string.
+ * Inside a G0 run, we jump straight to the column under (x).
+ * Elsewhere, walk glyph by glyph.
+ * Either way, we return the boundary nearest (x) of the glyph that crosses it.
  */
  
 int font_locate_point(struct font *font,const char *src,int srcc,int x) {
@@ -29,35 +48,38 @@ int font_locate_point(struct font *font,const char *src,int srcc,int x) {
   if (x<=0) return 0;
   if (!src) srcc=0; else if (srcc<0) { srcc=0; while (src[srcc]) srcc++; }
   struct text_decoder decoder={.v=src,.c=srcc,.encoding=font->encoding};
-  int w=0,codepoint,pvp=0;
-  while (text_decoder_read(&codepoint,&decoder)>0) {
-    int pvw=w;
-    if (codepoint<0) {
-      codepoint+=0x100;
-      w+=font_measure_tofu(font,codepoint);
-    } else {
-      if ((codepoint>=0x20)&&(codepoint<=0x7f)) w+=font->w;
-      else w+=font_measure_tofu(font,codepoint);
+  int w=0,codepointv[FONT_DECODE_CHUNK],lenv[FONT_DECODE_CHUNK],codepointc;
+  int chunk=font->g0?FONT_ISLAND_CHUNK:FONT_DECODE_CHUNK;
+  while (decoder.p<decoder.c) {
+    if (font->g0) {
+      int runc=text_g0_run(src+decoder.p,srcc-decoder.p);
+      int runw=runc*font->w;
+      if (w+runw>=x) {
+        int col=(x-w+font->w-1)/font->w-1; // First glyph whose right edge reaches (x).
+        int pvw=w+col*font->w;
+        if (x>=pvw+(font->w>>1)) return decoder.p+col+1;
+        return decoder.p+col;
+      }
+      w+=runw;
+      decoder.p+=runc;
     }
-    if (w>=x) { // Crossed the target. Return either (pvp) or (decoder.p).
-      int midx=(pvw+w)>>1;
-      if (x>=midx) return decoder.p;
-      return pvp;
+    int pvp=decoder.p;
+    if ((codepointc=text_decoder_read_many(codepointv,lenv,chunk,&decoder))<1) break;
+    int i=0;
+    for (;i<codepointc;i++) {
+      int pvw=w;
+      w+=font_measure_codepoint(font,codepointv[i]);
+      if (w>=x) { // Crossed the target. Return either before or after this glyph.
+        int midx=(pvw+w)>>1;
+        if (x>=midx) return pvp+lenv[i];
+        return pvp;
+      }
+      pvp+=lenv[i];
     }
-    pvp=decoder.p;
   }
   return decoder.p;
 }
 
-/* Measure tofu.
- */
- 
-int font_measure_tofu(struct font *font,int codepoint) {
-  if (!font) return 0;
-  //TODO tofu
-  return 0;
-}
-
 /* Render multiple glyphs, allowing embedded tofu.
  */
 
@@ -71,18 +93,80 @@ int font_render_string(struct image *dst,int dstx,int dsty,struct font *font,con
   
   if (srcc<0) { srcc=0; while (src[srcc]) srcc++; }
   struct text_decoder decoder={.v=src,.c=srcc,.encoding=font->encoding};
-  int subx=0,codepoint;
-  while (text_decoder_read(&codepoint,&decoder)>0) {
-    if (codepoint<0) {
-      codepoint+=0x100;
-      subx+=font_render_tofu(dst,dstx+subx,dsty,font,codepoint,font->color_misencode);
-    } else {
-      if ((codepoint<0x20)||(codepoint>0x7f)) {
-        subx+=font_render_tofu(dst,dstx+subx,dsty,font,codepoint,font->color_missing);
+  int subx=0,codepointv[FONT_DECODE_CHUNK],codepointc;
+  while ((codepointc=text_decoder_read_many(codepointv,0,FONT_DECODE_CHUNK,&decoder))>0) {
+    const int *codepoint=codepointv;
+    for (;codepointc-->0;codepoint++) {
+      if (*codepoint<0) {
+        subx+=font_render_tofu(dst,dstx+subx,dsty,font,*codepoint+0x100,font->color_misencode);
       } else {
-        subx+=font_render_glyph(dst,dstx+subx,dsty,font,codepoint,font->color_normal);
+        int adv=font_render_glyph(dst,dstx+subx,dsty,font,*codepoint,font->color_normal);
+        if (adv<0) adv=font_render_tofu(dst,dstx+subx,dsty,font,*codepoint,font->color_missing);
+        subx+=adv;
       }
     }
   }
   return subx;
 }
+
+/* Soft wrap.
+ * Greedy: Each row takes what fits, then breaks after its last space, or right at the edge if it has none.
+ * Spaces never force a break; they hang off the right edge, so rows begin with the next word.
+ * Every row takes at least one glyph, so absurdly narrow widths still finish.
+ */
+
+struct font_wrap_state {
+  int *breakv;
+  int breaka;
+  int w;
+  int rowc;
+  int rowp; // Start of the current row.
+  int x; // Width of the current row so far.
+  int spacep,spacex; // Just after the last space in the current row, and the width there. (spacep<=rowp) if none.
+};
+
+static inline void font_wrap_step(struct font_wrap_state *st,int codepoint,int p,int len,int cw) {
+  if (codepoint!=0x20) {
+    while ((st->x+cw>st->w)&&(p>st->rowp)) {
+      if (st->spacep>st->rowp) {
+        st->rowp=st->spacep;
+        st->x-=st->spacex;
+      } else {
+        st->rowp=p;
+        st->x=0;
+      }
+      if (st->rowc<=st->breaka) st->breakv[st->rowc-1]=st->rowp;
+      st->rowc++;
+    }
+  }
+  st->x+=cw;
+  if (codepoint==0x20) {
+    st->spacep=p+len;
+    st->spacex=st->x;
+  }
+}
+
+int font_wrap_line(int *breakv,int breaka,struct font *font,const char *src,int srcc,int w) {
+  if (!font) return 1;
+  if (!src) srcc=0; else if (srcc<0) { srcc=0; while (src[srcc]) srcc++; }
+  if (!breakv) breaka=0;
+  struct font_wrap_state st={.breakv=breakv,.breaka=breaka,.w=w,.rowc=1};
+  struct text_decoder decoder={.v=src,.c=srcc,.encoding=font->encoding};
+  int codepointv[FONT_DECODE_CHUNK],lenv[FONT_DECODE_CHUNK],codepointc;
+  int chunk=font->g0?FONT_ISLAND_CHUNK:FONT_DECODE_CHUNK;
+  while (decoder.p<decoder.c) {
+    if (font->g0) {
+      int runc=text_g0_run(src+decoder.p,srcc-decoder.p);
+      const uint8_t *v=(const uint8_t*)src+decoder.p;
+      int i=0; for (;i<runc;i++) font_wrap_step(&st,v[i],decoder.p+i,1,font->w);
+      decoder.p+=runc;
+    }
+    int p=decoder.p;
+    if ((codepointc=text_decoder_read_many(codepointv,lenv,chunk,&decoder))<1) break;
+    int i=0; for (;i<codepointc;i++) {
+      font_wrap_step(&st,codepointv[i],p,lenv[i],font_measure_codepoint(font,codepointv[i]));
+      p+=lenv[i];
+    }
+  }
+  return st.rowc;
+}
@@ -6,7 +6,9 @@
 void font_del(struct font *font) {
   if (!font) return;
   if (font->refc-->1) return;
-  if (font->img) free(font->img);
+  if (font->img&&font->ownimg) free(font->img);
+  font_psf_del(font->psf);
+  font_tofu_del(font->tofu);
   free(font);
 }
 
@@ -23,7 +25,7 @@ int font_ref(struct font *font) {
 /* New, from image.
  */
 
-struct font *font_new(struct image *image,const struct text_encoding *encoding) {
+static struct font *font_new_from_image(struct image *image,const struct text_encoding *encoding,int a8) {
   if (!image||!encoding) return 0;
   
   // Confirm it produces sane dimensions.
@@ -37,15 +39,59 @@ struct font *font_new(struct image *image,const struct text_encoding *encoding)
   
   font->imgw=image->w;
   font->imgh=image->h;
-  font->imgstride=(font->imgw+7)>>3;
+  font->a8=a8;
+  font->imgstride=a8?font->imgw:((font->imgw+7)>>3);
   if (!(font->img=calloc(font->imgstride,font->imgh))) {
     font_del(font);
     return 0;
   }
+  font->ownimg=1;
   font->w=image->w/16;
   font->h=image->h/7;
   
-  font_copy_image(font,image);
+  if (a8) font_copy_image_a8(font,image);
+  else font_copy_image(font,image);
+  font_tofu_init(font);
+  font_g0_init(font);
+  
+  font->color_normal=0xffffffff;
+  font->color_missing=0xff0000ff;
+  font->color_misencode=0xff0000ff;
+  
+  return font;
+}
+
+struct font *font_new(struct image *image,const struct text_encoding *encoding) {
+  return font_new_from_image(image,encoding,0);
+}
+
+struct font *font_new_a8(struct image *image,const struct text_encoding *encoding) {
+  return font_new_from_image(image,encoding,1);
+}
+
+/* New, from prepared A1 data.
+ */
+ 
+struct font *font_new_from_a1(const void *a1,int w,int h,int stride,const struct text_encoding *encoding) {
+  if (!a1||!encoding) return 0;
+  if ((w<1)||(w%16)) return 0;
+  if ((h<1)||(h%7)) return 0;
+  if (stride<((w+7)>>3)) return 0;
+  
+  struct font *font=calloc(1,sizeof(struct font));
+  if (!font) return 0;
+  font->refc=1;
+  font->encoding=encoding;
+  
+  // We never write to (img), it's only non-const because font_new owns its copy.
+  font->img=(uint8_t*)a1;
+  font->imgw=w;
+  font->imgh=h;
+  font->imgstride=stride;
+  font->w=w/16;
+  font->h=h/7;
+  font_tofu_init(font);
+  font_g0_init(font);
   
   font->color_normal=0xffffffff;
   font->color_missing=0xff0000ff;
@@ -54,6 +100,81 @@ struct font *font_new(struct image *image,const struct text_encoding *encoding)
   return font;
 }
 
+/* New, scaled from another font.
+ */
+ 
+#define FONT_SCALE_LIMIT 16
+
+struct font *font_new_scaled(struct font *src,int scale) {
+  if (!src||(scale<1)||(scale>FONT_SCALE_LIMIT)) return 0;
+  if (src->psf&&(scale!=1)) return 0;
+  if (scale==1) {
+    if (font_ref(src)<0) return 0;
+    return src;
+  }
+  
+  struct font *font=calloc(1,sizeof(struct font));
+  if (!font) return 0;
+  font->refc=1;
+  font->encoding=src->encoding;
+  font->color_normal=src->color_normal;
+  font->color_missing=src->color_missing;
+  font->color_misencode=src->color_misencode;
+  
+  font->imgw=src->imgw*scale;
+  font->imgh=src->imgh*scale;
+  font->a8=src->a8;
+  font->imgstride=font->a8?font->imgw:((font->imgw+7)>>3);
+  if (!(font->img=calloc(font->imgstride,font->imgh))) {
+    font_del(font);
+    return 0;
+  }
+  font->ownimg=1;
+  font->w=src->w*scale;
+  font->h=src->h*scale;
+  
+  /* Expand each source row once, then copy it for the remaining (scale-1) rows.
+   */
+  const uint8_t *srcrow=src->img;
+  uint8_t *dstrow=font->img;
+  int yi=src->imgh;
+  for (;yi-->0;srcrow+=src->imgstride) {
+    if (font->a8) {
+      uint8_t *dstp=dstrow;
+      int xi=0; for (;xi<src->imgw;xi++) {
+        memset(dstp,srcrow[xi],scale);
+        dstp+=scale;
+      }
+    } else {
+      const uint8_t *srcp=srcrow;
+      uint8_t srcmask=0x80;
+      uint8_t *dstp=dstrow;
+      uint8_t dstmask=0x80;
+      int xi=src->imgw; for (;xi-->0;) {
+        int on=(*srcp)&srcmask;
+        if (srcmask==1) { srcmask=0x80; srcp++; }
+        else srcmask>>=1;
+        int i=scale; while (i-->0) {
+          if (on) (*dstp)|=dstmask;
+          if (dstmask==1) { dstmask=0x80; dstp++; }
+          else dstmask>>=1;
+        }
+      }
+    }
+    uint8_t *firstrow=dstrow;
+    dstrow+=font->imgstride;
+    int i=scale; while (i-->1) {
+      memcpy(dstrow,firstrow,font->imgstride);
+      dstrow+=font->imgstride;
+    }
+  }
+  
+  font_tofu_init_scaled(font,src,scale);
+  font->g0=src->g0;
+  
+  return font;
+}
+
 /* New, from path.
  */
  
@@ -65,6 +186,29 @@ struct font *font_new_from_path(const char *path,const struct text_encoding *enc
   return font;
 }
 
+struct font *font_new_a8_from_path(const char *path,const struct text_encoding *encoding) {
+  struct image *image=image_new_from_path(path);
+  if (!image) return 0;
+  struct font *font=font_new_a8(image,encoding);
+  image_del(image);
+  return font;
+}
+
+/* Can we measure printable ASCII without decoding it?
+ * Only if the encoding maps those bytes to themselves and we have all of them.
+ * Page-based encodings might too, but we can't tell generically.
+ */
+ 
+void font_g0_init(struct font *font) {
+  font->g0=0;
+  if ((font->encoding!=&text_encoding_utf8)&&(font->encoding!=&text_encoding_iso88591)) return;
+  int codepoint=0x20;
+  for (;codepoint<0x7f;codepoint++) {
+    if (!font_has_glyph(font,codepoint)) return;
+  }
+  font->g0=1;
+}
+
 /* Trivial accessors.
  */
 
@@ -78,6 +222,12 @@ int font_get_height(const struct font *font) {
   return font->h;
 }
 
+int font_has_glyph(struct font *font,int codepoint) {
+  if (!font) return 0;
+  if (font->psf) return font_psf_get_glyph(font->psf,codepoint)?1:0;
+  return ((codepoint>=0x20)&&(codepoint<=0x7f));
+}
+
 void font_set_color_normal(struct font *font,uint32_t color) {
   if (!font) return;
   font->color_normal=color;
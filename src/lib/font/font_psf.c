@@ -0,0 +1,309 @@
+/* font_psf.c
+ * Fonts from PC Screen Font files, versions 1 and 2.
+ * These can cover thousands of codepoints, so we don't convert anything up front.
+ * Glyph bits are used in place, straight from the file, which we map when we can.
+ * The Unicode table is flattened to a sorted list at load. Lookup goes through a page table of 256-codepoint blocks,
+ * and each page is filled from the sorted list the first time something in its block is asked for.
+ * So resident memory is proportional to the glyphs you actually touch.
+ */
+
+#include "font_internal.h"
+#if USE_fs
+  #include "opt/fs/fs.h"
+#endif
+
+#define FONT_PSF_PLANE_COUNT 17 /* Unicode stops at U+10ffff. */
+
+struct font_psf_page {
+  int glyphpv[256]; // Glyph index, or -1 if none.
+};
+
+struct font_psf {
+  const uint8_t *v; // Entire file. Backed by one of:
+  struct file_map *map; // ...a mapped file
+  void *own; // ...or our own copy.
+  int c;
+  const uint8_t *glyphv;
+  int glyphc,glyphsize,rowstride;
+  int w,h;
+  struct font_psf_entry { int codepoint,glyphp; } *entryv; // Sorted by codepoint. Empty if the file has no Unicode table.
+  int entryc,entrya;
+  struct font_psf_page **planev[FONT_PSF_PLANE_COUNT]; // Each null or 256 pages, each null or STRONG or (font_psf_page_empty).
+  int pagec; // How many we've materialized.
+};
+
+// Marks a page we've looked at and found nothing in. Saves a second search. Its content is meaningless.
+static struct font_psf_page font_psf_page_empty;
+
+/* Delete.
+ */
+
+void font_psf_del(struct font_psf *psf) {
+  if (!psf) return;
+  int planep=FONT_PSF_PLANE_COUNT;
+  while (planep-->0) {
+    struct font_psf_page **pagev=psf->planev[planep];
+    if (!pagev) continue;
+    int i=256; while (i-->0) {
+      if (pagev[i]&&(pagev[i]!=&font_psf_page_empty)) free(pagev[i]);
+    }
+    free(pagev);
+  }
+  if (psf->entryv) free(psf->entryv);
+  #if USE_fs
+    file_unmap(psf->map);
+  #endif
+  if (psf->own) free(psf->own);
+  free(psf);
+}
+
+/* Unicode table.
+ */
+
+static int font_psf_add_entry(struct font_psf *psf,int codepoint,int glyphp) {
+  if ((codepoint<0)||(codepoint>=FONT_PSF_PLANE_COUNT<<16)) return 0;
+  if (psf->entryc>=psf->entrya) {
+    int na=psf->entrya+256;
+    if (na>INT_MAX/sizeof(struct font_psf_entry)) return -1;
+    void *nv=realloc(psf->entryv,sizeof(struct font_psf_entry)*na);
+    if (!nv) return -1;
+    psf->entryv=nv;
+    psf->entrya=na;
+  }
+  struct font_psf_entry *entry=psf->entryv+psf->entryc++;
+  entry->codepoint=codepoint;
+  entry->glyphp=glyphp;
+  return 0;
+}
+
+static int font_psf_entry_cmp(const void *a,const void *b) {
+  const struct font_psf_entry *A=a,*B=b;
+  if (A->codepoint<B->codepoint) return -1;
+  if (A->codepoint>B->codepoint) return 1;
+  return A->glyphp-B->glyphp;
+}
+
+// Sort, and where a codepoint is listed twice, the lower glyph wins.
+static void font_psf_sort_entries(struct font_psf *psf) {
+  if (psf->entryc<1) return;
+  qsort(psf->entryv,psf->entryc,sizeof(struct font_psf_entry),font_psf_entry_cmp);
+  int rp=1,wp=1;
+  for (;rp<psf->entryc;rp++) {
+    if (psf->entryv[rp].codepoint==psf->entryv[wp-1].codepoint) continue;
+    psf->entryv[wp++]=psf->entryv[rp];
+  }
+  psf->entryc=wp;
+}
+
+/* PSF2 table: Per glyph, UTF-8 codepoints, then optional 0xfe-led sequences, then 0xff.
+ * We don't do multi-codepoint sequences.
+ */
+
+static int font_psf2_read_table(struct font_psf *psf,const uint8_t *src,int srcc) {
+  int srcp=0,glyphp=0;
+  while ((srcp<srcc)&&(glyphp<psf->glyphc)) {
+    if (src[srcp]==0xff) {
+      srcp++;
+      glyphp++;
+    } else if (src[srcp]==0xfe) {
+      while ((srcp<srcc)&&(src[srcp]!=0xff)) srcp++;
+    } else {
+      int codepoint;
+      int err=text_encoding_utf8.read(&codepoint,src+srcp,srcc-srcp,0);
+      if (err<=0) return -1;
+      srcp+=err;
+      if (font_psf_add_entry(psf,codepoint,glyphp)<0) return -1;
+    }
+  }
+  return 0;
+}
+
+/* PSF1 table: Per glyph, UCS-2LE codepoints, then optional 0xfffe-led sequences, then 0xffff.
+ */
+
+static int font_psf1_read_table(struct font_psf *psf,const uint8_t *src,int srcc) {
+  int srcp=0,glyphp=0,seq=0;
+  while ((srcp<=srcc-2)&&(glyphp<psf->glyphc)) {
+    int codepoint=src[srcp]|(src[srcp+1]<<8);
+    srcp+=2;
+    if (codepoint==0xffff) {
+      glyphp++;
+      seq=0;
+    } else if (codepoint==0xfffe) {
+      seq=1;
+    } else if (!seq) {
+      if (font_psf_add_entry(psf,codepoint,glyphp)<0) return -1;
+    }
+  }
+  return 0;
+}
+
+/* Decode header and table, with (psf->v,c) already set.
+ */
+
+static int font_psf_decode(struct font_psf *psf) {
+  const uint8_t *src=psf->v;
+  int srcc=psf->c,glyphp,tablep=0;
+  if ((srcc>=32)&&!memcmp(src,"\x72\xb5\x4a\x86",4)) {
+    #define RD32(p) (src[p]|(src[p+1]<<8)|(src[p+2]<<16)|(src[p+3]<<24))
+    int hdrlen=RD32(8);
+    int flags=RD32(12);
+    psf->glyphc=RD32(16);
+    psf->glyphsize=RD32(20);
+    psf->h=RD32(24);
+    psf->w=RD32(28);
+    #undef RD32
+    if ((hdrlen<32)||(hdrlen>srcc)) return -1;
+    if ((psf->w<1)||(psf->h<1)||(psf->w>256)||(psf->h>256)) return -1;
+    psf->rowstride=(psf->w+7)>>3;
+    if (psf->glyphsize<psf->rowstride*psf->h) return -1;
+    if ((psf->glyphc<1)||(psf->glyphc>(srcc-hdrlen)/psf->glyphsize)) return -1;
+    glyphp=hdrlen;
+    if (flags&1) tablep=glyphp+psf->glyphc*psf->glyphsize;
+    psf->glyphv=src+glyphp;
+    if (tablep&&(font_psf2_read_table(psf,src+tablep,srcc-tablep)<0)) return -1;
+  } else if ((srcc>=4)&&(src[0]==0x36)&&(src[1]==0x04)) {
+    int mode=src[2];
+    psf->glyphc=(mode&0x01)?512:256;
+    psf->glyphsize=src[3];
+    psf->w=8;
+    psf->h=psf->glyphsize;
+    psf->rowstride=1;
+    if (psf->h<1) return -1;
+    if (psf->glyphc>(srcc-4)/psf->glyphsize) return -1;
+    glyphp=4;
+    if (mode&0x06) tablep=glyphp+psf->glyphc*psf->glyphsize;
+    psf->glyphv=src+glyphp;
+    if (tablep&&(font_psf1_read_table(psf,src+tablep,srcc-tablep)<0)) return -1;
+  } else {
+    return -1;
+  }
+  font_psf_sort_entries(psf);
+  return 0;
+}
+
+/* Materialize a page.
+ */
+
+static int font_psf_entry_search(const struct font_psf *psf,int codepoint) {
+  int lo=0,hi=psf->entryc;
+  while (lo<hi) {
+    int ck=(lo+hi)>>1;
+    if (codepoint<psf->entryv[ck].codepoint) hi=ck;
+    else if (codepoint>psf->entryv[ck].codepoint) lo=ck+1;
+    else return ck;
+  }
+  return -lo-1;
+}
+
+static struct font_psf_page *font_psf_page_require(struct font_psf *psf,int codepoint) {
+  int planep=codepoint>>16;
+  struct font_psf_page **pagev=psf->planev[planep];
+  if (!pagev) {
+    if (!(pagev=calloc(256,sizeof(void*)))) return 0;
+    psf->planev[planep]=pagev;
+  }
+  int pagep=(codepoint>>8)&0xff;
+  if (pagev[pagep]) return pagev[pagep];
+
+  int lo=codepoint&~0xff;
+  int p=font_psf_entry_search(psf,lo);
+  if (p<0) p=-p-1;
+  if ((p>=psf->entryc)||(psf->entryv[p].codepoint>lo+0xff)) {
+    pagev[pagep]=&font_psf_page_empty;
+    return pagev[pagep];
+  }
+  struct font_psf_page *page=malloc(sizeof(struct font_psf_page));
+  if (!page) return 0;
+  memset(page->glyphpv,0xff,sizeof(page->glyphpv));
+  for (;(p<psf->entryc)&&(psf->entryv[p].codepoint<=lo+0xff);p++) {
+    page->glyphpv[psf->entryv[p].codepoint&0xff]=psf->entryv[p].glyphp;
+  }
+  pagev[pagep]=page;
+  psf->pagec++;
+  return page;
+}
+
+/* Get glyph.
+ */
+
+const uint8_t *font_psf_get_glyph(struct font_psf *psf,int codepoint) {
+  if (!psf||(codepoint<0)||(codepoint>=FONT_PSF_PLANE_COUNT<<16)) return 0;
+  int glyphp;
+  if (!psf->entryc) { // No table: Glyphs are indexed by codepoint.
+    glyphp=codepoint;
+  } else {
+    struct font_psf_page *page=font_psf_page_require(psf,codepoint);
+    if (!page||(page==&font_psf_page_empty)) return 0;
+    glyphp=page->glyphpv[codepoint&0xff];
+  }
+  if ((glyphp<0)||(glyphp>=psf->glyphc)) return 0;
+  return psf->glyphv+glyphp*psf->glyphsize;
+}
+
+int font_psf_get_rowstride(const struct font_psf *psf) {
+  return psf->rowstride;
+}
+
+/* New.
+ */
+
+static struct font *font_new_psf_internal(struct font_psf *psf,const struct text_encoding *encoding) {
+  if (font_psf_decode(psf)<0) {
+    font_psf_del(psf);
+    return 0;
+  }
+  struct font *font=calloc(1,sizeof(struct font));
+  if (!font) {
+    font_psf_del(psf);
+    return 0;
+  }
+  font->refc=1;
+  font->encoding=encoding;
+  font->psf=psf;
+  font->w=psf->w;
+  font->h=psf->h;
+  font_g0_init(font);
+  font->color_normal=0xffffffff;
+  font->color_missing=0xff0000ff;
+  font->color_misencode=0xff0000ff;
+  return font;
+}
+
+struct font *font_new_psf(const void *src,int srcc,const struct text_encoding *encoding) {
+  if (!src||(srcc<1)||!encoding) return 0;
+  struct font_psf *psf=calloc(1,sizeof(struct font_psf));
+  if (!psf) return 0;
+  if (!(psf->own=malloc(srcc))) {
+    free(psf);
+    return 0;
+  }
+  memcpy(psf->own,src,srcc);
+  psf->v=psf->own;
+  psf->c=srcc;
+  return font_new_psf_internal(psf,encoding);
+}
+
+struct font *font_new_psf_from_path(const char *path,const struct text_encoding *encoding) {
+  if (!path||!encoding) return 0;
+  #if USE_fs
+    // Glyphs get touched in whatever order the text asks for them.
+    struct file_map *map=file_map(path,FILE_MAP_RANDOM);
+    if (!map) return 0;
+    if ((map->c<1)||(map->c>INT_MAX)) {
+      file_unmap(map);
+      return 0;
+    }
+    struct font_psf *psf=calloc(1,sizeof(struct font_psf));
+    if (!psf) {
+      file_unmap(map);
+      return 0;
+    }
+    psf->map=map;
+    psf->v=map->v;
+    psf->c=map->c;
+    return font_new_psf_internal(psf,encoding);
+  #else
+    return 0;
+  #endif
+}
@@ -80,29 +80,16 @@ void font_copy_image(struct font *font,struct image *image) {
   }
 }
 
-/* Render glyph.
+/* Blit A1 or A8 bits with clipping. Glyphs and tofu both come through here.
+ * (src,srcstride) is the whole source image, and (srcx,srcy,w,h) the part of it we want.
  */
 
-int font_render_glyph(struct image *dst,int dstx,int dsty,struct font *font,int codepoint,uint32_t color) {
-  if (!dst||!dst->writeable||(dst->pixelsize!=32)) return -1;
-  if (!font||(codepoint<0x20)||(codepoint>0x7f)) return -1;
-  dstx+=dst->x0;
-  dsty+=dst->y0;
-  int srcx=(codepoint&15)*font->w;
-  int srcy=((codepoint-0x20)>>4)*font->h;
-  int w=font->w; // Will be the amount to actually copy. Return value is always (font->w).
-  int h=font->h;
-  if (dstx<0) { w+=dstx; srcx-=dstx; dstx=0; }
-  if (dsty<0) { h+=dsty; srcy-=dsty; dsty=0; }
-  if (dstx>dst->w-w) w=dst->w-dstx;
-  if (dsty>dst->h-h) h=dst->h-dsty;
-  if ((w<1)||(h<1)) return font->w;
-  
-  int dststridewords=dst->stride>>2;
-  uint32_t *dstrow=((uint32_t*)dst->v)+dsty*dststridewords+dstx;
-  const uint8_t *srcrow=font->img+srcy*font->imgstride+(srcx>>3);
-  uint8_t srcmask0=0x80>>(srcx&7);
-  int yi=h; for (;yi-->0;dstrow+=dststridewords,srcrow+=font->imgstride) {
+static void font_blit_a1(
+  uint32_t *dstrow,int dststridewords,
+  const uint8_t *srcrow,int srcstride,uint8_t srcmask0,
+  int w,int h,uint32_t color
+) {
+  int yi=h; for (;yi-->0;dstrow+=dststridewords,srcrow+=srcstride) {
     uint32_t *dstp=dstrow;
     const uint8_t *srcp=srcrow;
     uint8_t srcmask=srcmask0;
@@ -116,17 +103,45 @@ int font_render_glyph(struct image *dst,int dstx,int dsty,struct font *font,int
       }
     }
   }
-  return font->w;
 }
 
-/* Render tofu.
+void font_blit(
+  struct image *dst,int dstx,int dsty,
+  const uint8_t *src,int srcstride,int a8,
+  int srcx,int srcy,int w,int h,
+  uint32_t color
+) {
+  dstx+=dst->x0;
+  dsty+=dst->y0;
+  if (dstx<0) { w+=dstx; srcx-=dstx; dstx=0; }
+  if (dsty<0) { h+=dsty; srcy-=dsty; dsty=0; }
+  if (dstx>dst->w-w) w=dst->w-dstx;
+  if (dsty>dst->h-h) h=dst->h-dsty;
+  if ((w<1)||(h<1)) return;
+  int dststridewords=dst->stride>>2;
+  uint32_t *dstrow=((uint32_t*)dst->v)+dsty*dststridewords+dstx;
+  if (a8) {
+    font_blit_a8(dstrow,dststridewords,src+srcy*srcstride+srcx,srcstride,w,h,color);
+  } else {
+    font_blit_a1(dstrow,dststridewords,src+srcy*srcstride+(srcx>>3),srcstride,0x80>>(srcx&7),w,h,color);
+  }
+}
+
+/* Render glyph.
  */
- 
-int font_render_tofu(struct image *dst,int dstx,int dsty,struct font *font,int codepoint,uint32_t color) {
+
+int font_render_glyph(struct image *dst,int dstx,int dsty,struct font *font,int codepoint,uint32_t color) {
   if (!dst||!dst->writeable||(dst->pixelsize!=32)) return -1;
   if (!font) return -1;
-  dstx+=dst->x0;
-  dsty+=dst->y0;
-  //TODO tofu
-  return 0;
+  if (font->psf) {
+    const uint8_t *glyph=font_psf_get_glyph(font->psf,codepoint);
+    if (!glyph) return -1;
+    font_blit(dst,dstx,dsty,glyph,font_psf_get_rowstride(font->psf),0,0,0,font->w,font->h,color);
+  } else {
+    if ((codepoint<0x20)||(codepoint>0x7f)) return -1;
+    int srcx=(codepoint&15)*font->w;
+    int srcy=((codepoint-0x20)>>4)*font->h;
+    font_blit(dst,dstx,dsty,font->img,font->imgstride,font->a8,srcx,srcy,font->w,font->h,color);
+  }
+  return font->w;
 }
@@ -0,0 +1,285 @@
+/* font_tofu.c
+ * Boxes with hex digits, for codepoints we don't have glyphs for.
+ * At font creation, we read the frames and digits from the image's bottom row.
+ * Composed tofus are kept in a small set-associative cache keyed by codepoint, so rendering one is just a blit.
+ * That matters for binary files, where nearly everything is tofu.
+ */
+
+#include "font_internal.h"
+
+/* Read one pixel of the font image, either format.
+ */
+
+static inline int font_tofu_pixel(const struct font *font,int x,int y) {
+  if ((x<0)||(y<0)||(x>=font->imgw)||(y>=font->imgh)) return 0;
+  if (font->a8) return (font->img[y*font->imgstride+x]>=0x80);
+  return (font->img[y*font->imgstride+(x>>3)]&(0x80>>(x&7)))?1:0;
+}
+
+/* Read one frame's placeholder boxes.
+ * Outline and one pixel of margin are excluded; the first row with anything lit is the top row of boxes.
+ * Boxes must all be the same size, and we return that.
+ */
+
+static int font_tofu_read_boxes(
+  struct font_tofu_frame *frame,int *boxw,int *boxh,
+  const struct font *font,int l,int t,int r,int b
+) {
+  int y=t+1,boxy0=-1;
+  for (;y<b;y++) {
+    int x=l+1; for (;x<r;x++) if (font_tofu_pixel(font,x,y)) break;
+    if (x<r) { boxy0=y; break; }
+  }
+  if (boxy0<0) return 0; // No boxes, fine.
+  int colv[FONT_TOFU_BOX_LIMIT],colc=0,roww=0,rowv[FONT_TOFU_BOX_LIMIT],rowc=0,colh=0;
+  int x=l+1; while (x<r) {
+    if (!font_tofu_pixel(font,x,boxy0)) { x++; continue; }
+    int w=0; while ((x+w<r)&&font_tofu_pixel(font,x+w,boxy0)) w++;
+    if (roww&&(w!=roww)) return -1;
+    roww=w;
+    if (colc<FONT_TOFU_BOX_LIMIT) colv[colc++]=x;
+    x+=w;
+  }
+  y=boxy0; while (y<b) {
+    if (!font_tofu_pixel(font,colv[0],y)) { y++; continue; }
+    int h=0; while ((y+h<b)&&font_tofu_pixel(font,colv[0],y+h)) h++;
+    if (colh&&(h!=colh)) return -1;
+    colh=h;
+    if (rowc<FONT_TOFU_BOX_LIMIT) rowv[rowc++]=y;
+    y+=h;
+  }
+  if ((*boxw&&(*boxw!=roww))||(*boxh&&(*boxh!=colh))) return -1;
+  *boxw=roww;
+  *boxh=colh;
+  int row=0; for (;row<rowc;row++) {
+    int col=0; for (;col<colc;col++) {
+      if (frame->boxc>=FONT_TOFU_BOX_LIMIT) return 0;
+      frame->boxxv[frame->boxc]=colv[col]-frame->x;
+      frame->boxyv[frame->boxc]=rowv[row]-font->h*6;
+      frame->boxc++;
+    }
+  }
+  return 0;
+}
+
+/* Read the layout from the bottom row of the image.
+ * Frames are packed from the left. Each is an outline whose top edge spans its cells less one pixel.
+ * The first cell that doesn't look like that starts the 16 hex digits, packed with one column between.
+ */
+
+static int font_tofu_read_layout(struct font_tofu *tofu,const struct font *font) {
+  int y0=font->h*6,cellx=0;
+  while ((cellx<16)&&(tofu->framec<FONT_TOFU_FRAME_LIMIT)) {
+    int x0=cellx*font->w,yt=0;
+    while ((yt<font->h)&&!font_tofu_pixel(font,x0,y0+yt)) yt++;
+    if (yt>=font->h) break;
+    int w=0; while ((w<font->w*(16-cellx))&&font_tofu_pixel(font,x0+w,y0+yt)) w++;
+    if ((w+1)%font->w) break;
+    int h=0; while ((yt+h<font->h)&&font_tofu_pixel(font,x0,y0+yt+h)) h++;
+    if (h<3) break;
+    struct font_tofu_frame *frame=tofu->framev+tofu->framec++;
+    memset(frame,0,sizeof(struct font_tofu_frame));
+    frame->x=x0;
+    frame->cellc=(w+1)/font->w;
+    if (font_tofu_read_boxes(frame,&tofu->digitw,&tofu->digith,font,x0,y0+yt,x0+w-1,y0+yt+h-1)<0) return -1;
+    cellx+=frame->cellc;
+  }
+  if (!tofu->framec) return -1;
+  if (tofu->digitw) {
+    tofu->digitpitch=tofu->digitw+1;
+    tofu->hexx=cellx*font->w;
+    tofu->hexy=y0;
+    if (tofu->hexx+tofu->digitpitch*16>font->imgw+1) return -1;
+  }
+  return 0;
+}
+
+/* Choose a frame for each digit count.
+ * Smallest capacity that fits, or the biggest we have if none do.
+ */
+
+static void font_tofu_choose_frames(struct font_tofu *tofu) {
+  int digitc=1; for (;digitc<=FONT_TOFU_BOX_LIMIT;digitc++) {
+    int best=-1,biggest=0,i=0;
+    for (;i<tofu->framec;i++) {
+      const struct font_tofu_frame *frame=tofu->framev+i;
+      if (frame->boxc>tofu->framev[biggest].boxc) biggest=i;
+      if (frame->boxc<digitc) continue;
+      if ((best<0)||(frame->boxc<tofu->framev[best].boxc)) best=i;
+    }
+    tofu->framep_by_digitc[digitc]=(best>=0)?best:biggest;
+  }
+}
+
+/* Row size for cached bitmaps: Enough for the widest frame.
+ */
+
+static void font_tofu_set_bitstride(struct font_tofu *tofu,const struct font *font) {
+  int maxw=0,i=tofu->framec;
+  while (i-->0) if (tofu->framev[i].cellc>maxw) maxw=tofu->framev[i].cellc;
+  maxw*=font->w;
+  tofu->bitstride=font->a8?maxw:((maxw+7)>>3);
+}
+
+/* Create.
+ */
+
+void font_tofu_init(struct font *font) {
+  if (!font||!font->img) return;
+  struct font_tofu *tofu=calloc(1,sizeof(struct font_tofu));
+  if (!tofu) return;
+  if (font_tofu_read_layout(tofu,font)<0) {
+    free(tofu);
+    return;
+  }
+  font_tofu_choose_frames(tofu);
+  font_tofu_set_bitstride(tofu,font);
+  font->tofu=tofu;
+}
+
+void font_tofu_del(struct font_tofu *tofu) {
+  if (!tofu) return;
+  if (tofu->bitv) free(tofu->bitv);
+  free(tofu);
+}
+
+/* Copy layout for a scaled font. Cache starts empty.
+ */
+
+void font_tofu_init_scaled(struct font *dst,const struct font *src,int scale) {
+  if (!src->tofu) return;
+  struct font_tofu *tofu=calloc(1,sizeof(struct font_tofu));
+  if (!tofu) return;
+  memcpy(tofu->framev,src->tofu->framev,sizeof(tofu->framev));
+  tofu->framec=src->tofu->framec;
+  memcpy(tofu->framep_by_digitc,src->tofu->framep_by_digitc,sizeof(tofu->framep_by_digitc));
+  int i=tofu->framec; while (i-->0) {
+    struct font_tofu_frame *frame=tofu->framev+i;
+    frame->x*=scale;
+    int j=frame->boxc; while (j-->0) {
+      frame->boxxv[j]*=scale;
+      frame->boxyv[j]*=scale;
+    }
+  }
+  tofu->digitw=src->tofu->digitw*scale;
+  tofu->digith=src->tofu->digith*scale;
+  tofu->hexx=src->tofu->hexx*scale;
+  tofu->hexy=src->tofu->hexy*scale;
+  tofu->digitpitch=src->tofu->digitpitch*scale;
+  font_tofu_set_bitstride(tofu,dst);
+  dst->tofu=tofu;
+}
+
+/* How many hex digits to show this codepoint? Two minimum.
+ */
+
+static int font_tofu_digitc(int codepoint) {
+  if (codepoint<0) codepoint=0;
+  int digitc=2;
+  while ((digitc<FONT_TOFU_BOX_LIMIT)&&(codepoint>>(digitc<<2))) digitc++;
+  return digitc;
+}
+
+/* Bitmap ops in the font's format.
+ */
+
+static void font_tofu_copy_rect(uint8_t *dst,int dststride,int dstx,int dsty,const struct font *font,int srcx,int srcy,int w,int h) {
+  int yi=0; for (;yi<h;yi++) {
+    int xi=0; for (;xi<w;xi++) {
+      int on=font_tofu_pixel(font,srcx+xi,srcy+yi);
+      int x=dstx+xi,y=dsty+yi;
+      if (font->a8) {
+        dst[y*dststride+x]=on?font->img[(srcy+yi)*font->imgstride+srcx+xi]:0;
+      } else if (on) {
+        dst[y*dststride+(x>>3)]|=0x80>>(x&7);
+      } else {
+        dst[y*dststride+(x>>3)]&=~(0x80>>(x&7));
+      }
+    }
+  }
+}
+
+/* Compose a tofu bitmap into (dst), which is (bitstride*h) and zeroed.
+ */
+
+static void font_tofu_compose(uint8_t *dst,struct font *font,const struct font_tofu_frame *frame,int codepoint) {
+  struct font_tofu *tofu=font->tofu;
+  int w=frame->cellc*font->w;
+  font_tofu_copy_rect(dst,tofu->bitstride,0,0,font,frame->x,font->h*6,w,font->h);
+  // Digits are right-aligned: The last box gets the lowest digit.
+  int i=frame->boxc; while (i-->0) {
+    int shift=(frame->boxc-1-i)<<2;
+    int digit=(shift<32)?((codepoint>>shift)&15):0;
+    font_tofu_copy_rect(
+      dst,tofu->bitstride,frame->boxxv[i],frame->boxyv[i],
+      font,tofu->hexx+digit*tofu->digitpitch,tofu->hexy,tofu->digitw,tofu->digith
+    );
+  }
+}
+
+/* Find or compose a tofu.
+ * Below U+100 gets a dedicated slot: That covers misencoded bytes and control characters, ie most of any binary file.
+ * Everything else shares the LRU sets.
+ */
+
+static struct font_tofu_entry *font_tofu_get(struct font *font,int codepoint) {
+  struct font_tofu *tofu=font->tofu;
+  if (!tofu->bitv) {
+    int entrysize=tofu->bitstride*font->h;
+    if (!(tofu->bitv=calloc(FONT_TOFU_ENTRY_COUNT,entrysize))) return 0;
+    int i=FONT_TOFU_ENTRY_COUNT; while (i-->0) {
+      tofu->entryv[i].codepoint=-1;
+      tofu->entryv[i].bits=tofu->bitv+i*entrysize;
+    }
+  }
+  struct font_tofu_entry *entry;
+  if (codepoint<FONT_TOFU_DIRECT_COUNT) {
+    entry=tofu->entryv+codepoint;
+    if (entry->codepoint==codepoint) return entry;
+  } else {
+    unsigned int setp=(((unsigned int)codepoint*2654435761u)>>24)%FONT_TOFU_SET_COUNT;
+    struct font_tofu_entry *set=tofu->entryv+FONT_TOFU_DIRECT_COUNT+setp*FONT_TOFU_WAY_COUNT;
+    entry=set;
+    tofu->stamp++;
+    int i=0; for (;i<FONT_TOFU_WAY_COUNT;i++) {
+      if (set[i].codepoint==codepoint) {
+        set[i].stamp=tofu->stamp;
+        return set+i;
+      }
+      if (set[i].stamp<entry->stamp) entry=set+i;
+    }
+    entry->stamp=tofu->stamp;
+  }
+  const struct font_tofu_frame *frame=tofu->framev+tofu->framep_by_digitc[font_tofu_digitc(codepoint)];
+  memset(entry->bits,0,tofu->bitstride*font->h);
+  font_tofu_compose(entry->bits,font,frame,codepoint);
+  entry->codepoint=codepoint;
+  entry->w=frame->cellc*font->w;
+  return entry;
+}
+
+/* Measure tofu.
+ */
+
+int font_measure_tofu(struct font *font,int codepoint) {
+  if (!font) return 0;
+  if (!font->tofu) return font->w;
+  return font->tofu->framev[font->tofu->framep_by_digitc[font_tofu_digitc(codepoint)]].cellc*font->w;
+}
+
+/* Render tofu.
+ */
+
+int font_render_tofu(struct image *dst,int dstx,int dsty,struct font *font,int codepoint,uint32_t color) {
+  if (!dst||!dst->writeable||(dst->pixelsize!=32)) return -1;
+  if (!font) return -1;
+  if (codepoint<0) codepoint=0;
+  struct font_tofu_entry *entry;
+  if (!font->tofu||!(entry=font_tofu_get(font,codepoint))) {
+    // No layout, eg PSF fonts. Plain box.
+    image_frame_rect(dst,dstx+1,dsty+1,font->w-2,font->h-2,color);
+    return font->w;
+  }
+  font_blit(dst,dstx,dsty,entry->bits,font->tofu->bitstride,font->a8,0,0,entry->w,font->h,color);
+  return entry->w;
+}
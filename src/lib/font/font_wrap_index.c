@@ -0,0 +1,373 @@
+/* font_wrap_index.c
+ * Visual rows per line, for soft wrap.
+ * Lines live in blocks of up to FONT_WRAP_BLOCK_SIZE, and two Fenwick trees over the blocks sum their lines and rows.
+ * Lookups either way are a descent through the trees, then a scan inside one block.
+ * Inserting or removing lines only touches the blocks involved. The trees are then rebuilt, but there's only one node per block.
+ */
+
+#include "font_internal.h"
+
+struct font_wrap_block {
+  int linec;
+  int stalec;
+  int64_t rowc;
+  int rowv[FONT_WRAP_BLOCK_SIZE]; // Rows per line, negative if it's a guess.
+};
+
+/* Cleanup.
+ */
+
+void font_wrap_index_cleanup(struct font_wrap_index *index) {
+  if (!index) return;
+  if (index->blockv) {
+    while (index->blockc-->0) free(index->blockv[index->blockc]);
+    free(index->blockv);
+  }
+  if (index->linetree) free(index->linetree);
+  if (index->rowtree) free(index->rowtree);
+  memset(index,0,sizeof(struct font_wrap_index));
+}
+
+/* Trees.
+ */
+
+static int font_wrap_index_rebuild_trees(struct font_wrap_index *index) {
+  if (index->blockc>index->treea) {
+    int na=(index->blockc+256)&~255;
+    if (na>INT_MAX/sizeof(int64_t)) return -1;
+    void *nv=realloc(index->linetree,sizeof(int)*na);
+    if (!nv) return -1;
+    index->linetree=nv;
+    if (!(nv=realloc(index->rowtree,sizeof(int64_t)*na))) return -1;
+    index->rowtree=nv;
+    index->treea=na;
+  }
+  int i=0;
+  for (;i<index->blockc;i++) {
+    index->linetree[i]=index->blockv[i]->linec;
+    index->rowtree[i]=index->blockv[i]->rowc;
+  }
+  // Linear-time Fenwick construction, same as widget_list.
+  for (i=0;i<index->blockc;i++) {
+    int parent=i|(i+1);
+    if (parent<index->blockc) {
+      index->linetree[parent]+=index->linetree[i];
+      index->rowtree[parent]+=index->rowtree[i];
+    }
+  }
+  return 0;
+}
+
+static void font_wrap_index_adjust_rows(struct font_wrap_index *index,int b,int64_t d) {
+  for (;b<index->blockc;b|=b+1) index->rowtree[b]+=d;
+}
+
+static int font_wrap_index_lines_before(const struct font_wrap_index *index,int b) {
+  int sum=0;
+  for (;b>0;b&=b-1) sum+=index->linetree[b-1];
+  return sum;
+}
+
+static int64_t font_wrap_index_rows_before(const struct font_wrap_index *index,int b) {
+  int64_t sum=0;
+  for (;b>0;b&=b-1) sum+=index->rowtree[b-1];
+  return sum;
+}
+
+/* Block containing (line), and (line)'s position in it.
+ * Returns (blockc) if out of range.
+ */
+
+static int font_wrap_index_find_line(int *local,const struct font_wrap_index *index,int line) {
+  if ((line<0)||(line>=index->linec)) return index->blockc;
+  int mask=1;
+  while (mask<=index->blockc>>1) mask<<=1;
+  int b=0;
+  for (;mask;mask>>=1) {
+    int q=b+mask;
+    if (q>index->blockc) continue;
+    if (index->linetree[q-1]<=line) {
+      line-=index->linetree[q-1];
+      b=q;
+    }
+  }
+  *local=line;
+  return b;
+}
+
+/* Add and remove blocks.
+ */
+
+static struct font_wrap_block *font_wrap_index_insert_block(struct font_wrap_index *index,int b) {
+  if (index->blockc>=index->blocka) {
+    int na=index->blocka+256;
+    if (na>INT_MAX/sizeof(void*)) return 0;
+    void *nv=realloc(index->blockv,sizeof(void*)*na);
+    if (!nv) return 0;
+    index->blockv=nv;
+    index->blocka=na;
+  }
+  struct font_wrap_block *block=calloc(1,sizeof(struct font_wrap_block));
+  if (!block) return 0;
+  memmove(index->blockv+b+1,index->blockv+b,sizeof(void*)*(index->blockc-b));
+  index->blockv[b]=block;
+  index->blockc++;
+  return block;
+}
+
+static void font_wrap_index_remove_block(struct font_wrap_index *index,int b) {
+  free(index->blockv[b]);
+  index->blockc--;
+  memmove(index->blockv+b,index->blockv+b+1,sizeof(void*)*(index->blockc-b));
+}
+
+/* Append one line to block (*b), moving on to a new block after it if full.
+ * Doesn't touch the trees or totals.
+ */
+
+static int font_wrap_index_push(struct font_wrap_index *index,int *b,int v) {
+  struct font_wrap_block *block=index->blockv[*b];
+  if (block->linec>=FONT_WRAP_BLOCK_SIZE) {
+    if (!(block=font_wrap_index_insert_block(index,*b+1))) return -1;
+    (*b)++;
+  }
+  block->rowv[block->linec++]=v;
+  if (v<0) {
+    block->stalec++;
+    block->rowc-=v;
+  } else {
+    block->rowc+=v;
+  }
+  return 0;
+}
+
+/* Reset.
+ */
+
+int font_wrap_index_reset(struct font_wrap_index *index,int linec) {
+  if (!index||(linec<0)) return -1;
+  while (index->blockc>0) font_wrap_index_remove_block(index,index->blockc-1);
+  index->linec=index->stalec=0;
+  index->rowc=0;
+  if (linec>0) {
+    if (!font_wrap_index_insert_block(index,0)) return -1;
+    int b=0,i=linec;
+    while (i-->0) if (font_wrap_index_push(index,&b,-1)<0) return -1;
+    index->linec=index->stalec=linec;
+    index->rowc=linec;
+  }
+  return font_wrap_index_rebuild_trees(index);
+}
+
+/* Invalidate.
+ */
+
+void font_wrap_index_invalidate(struct font_wrap_index *index) {
+  if (!index) return;
+  int b=0;
+  for (;b<index->blockc;b++) {
+    struct font_wrap_block *block=index->blockv[b];
+    int *v=block->rowv;
+    int i=block->linec;
+    for (;i-->0;v++) if (*v>0) *v=-*v;
+    block->stalec=block->linec;
+  }
+  index->stalec=index->linec;
+}
+
+/* Replace lines.
+ */
+
+int font_wrap_index_replace(struct font_wrap_index *index,int line,int rmc,int addc) {
+  if (!index) return -1;
+  if ((line<0)||(rmc<0)||(addc<0)||(line>index->linec-rmc)) return -1;
+  if (addc>INT_MAX-(index->linec-rmc)) return -1;
+  if (!rmc&&!addc) return 0;
+
+  // Find the insertion point: Block (b) at (local), or the end of the last block.
+  int local=0,b;
+  if (line<index->linec) {
+    b=font_wrap_index_find_line(&local,index,line);
+  } else if (index->blockc) {
+    b=index->blockc-1;
+    local=index->blockv[b]->linec;
+  } else {
+    if (!font_wrap_index_insert_block(index,0)) return -1;
+    b=0;
+  }
+
+  // Remove lines from (b,local) onward, dropping blocks that empty out.
+  index->linec-=rmc;
+  int rb=b,rlocal=local;
+  while (rmc>0) {
+    struct font_wrap_block *block=index->blockv[rb];
+    int c=block->linec-rlocal;
+    if (c>rmc) c=rmc;
+    int i=0; for (;i<c;i++) {
+      int v=block->rowv[rlocal+i];
+      if (v<0) {
+        block->stalec--;
+        index->stalec--;
+        v=-v;
+      }
+      block->rowc-=v;
+      index->rowc-=v;
+    }
+    block->linec-=c;
+    memmove(block->rowv+rlocal,block->rowv+rlocal+c,sizeof(int)*(block->linec-rlocal));
+    rmc-=c;
+    if (!block->linec&&(index->blockc>1)) {
+      font_wrap_index_remove_block(index,rb);
+      if (rb==b) local=0;
+    } else {
+      rb++;
+    }
+    rlocal=0;
+  }
+  if (b>=index->blockc) {
+    b=index->blockc-1;
+    local=index->blockv[b]->linec;
+  }
+
+  // Insert by cutting the block at (local), pushing new lines, then pushing the tail back.
+  if (addc) {
+    struct font_wrap_block *block=index->blockv[b];
+    int tailv[FONT_WRAP_BLOCK_SIZE];
+    int tailc=block->linec-local;
+    memcpy(tailv,block->rowv+local,sizeof(int)*tailc);
+    int i=0; for (;i<tailc;i++) {
+      int v=tailv[i];
+      if (v<0) {
+        block->stalec--;
+        v=-v;
+      }
+      block->rowc-=v;
+    }
+    block->linec=local;
+    for (i=addc;i-->0;) {
+      if (font_wrap_index_push(index,&b,-1)<0) return -1;
+    }
+    for (i=0;i<tailc;i++) {
+      if (font_wrap_index_push(index,&b,tailv[i])<0) return -1;
+    }
+    index->linec+=addc;
+    index->stalec+=addc;
+    index->rowc+=addc;
+  }
+
+  // Merge with the neighbors if they'd fit in one block, so deleting doesn't leave lots of tiny blocks behind.
+  int i=b+1; for (;(i>=b-1)&&(i>=1);i--) {
+    if (i>=index->blockc) continue;
+    struct font_wrap_block *l=index->blockv[i-1],*r=index->blockv[i];
+    if (l->linec+r->linec>FONT_WRAP_BLOCK_SIZE) continue;
+    memcpy(l->rowv+l->linec,r->rowv,sizeof(int)*r->linec);
+    l->linec+=r->linec;
+    l->stalec+=r->stalec;
+    l->rowc+=r->rowc;
+    font_wrap_index_remove_block(index,i);
+  }
+
+  return font_wrap_index_rebuild_trees(index);
+}
+
+/* Get and set one line.
+ */
+
+int font_wrap_index_get(int *stale,const struct font_wrap_index *index,int line) {
+  if (!index) return 0;
+  int local;
+  int b=font_wrap_index_find_line(&local,index,line);
+  if (b>=index->blockc) return 0;
+  int v=index->blockv[b]->rowv[local];
+  if (stale) *stale=(v<0);
+  return (v<0)?-v:v;
+}
+
+int font_wrap_index_set(struct font_wrap_index *index,int line,int rowc) {
+  if (!index||(rowc<1)) return -1;
+  int local;
+  int b=font_wrap_index_find_line(&local,index,line);
+  if (b>=index->blockc) return -1;
+  struct font_wrap_block *block=index->blockv[b];
+  int v=block->rowv[local];
+  if (v<0) {
+    block->stalec--;
+    index->stalec--;
+    v=-v;
+  }
+  block->rowv[local]=rowc;
+  if (rowc!=v) {
+    block->rowc+=rowc-v;
+    index->rowc+=rowc-v;
+    font_wrap_index_adjust_rows(index,b,rowc-v);
+  }
+  return 0;
+}
+
+/* Convert between lines and rows.
+ */
+
+int64_t font_wrap_index_row_from_line(const struct font_wrap_index *index,int line) {
+  if (!index||(line<=0)) return 0;
+  if (line>=index->linec) return index->rowc;
+  int local;
+  int b=font_wrap_index_find_line(&local,index,line);
+  int64_t row=font_wrap_index_rows_before(index,b);
+  const int *v=index->blockv[b]->rowv;
+  for (;local-->0;v++) row+=(*v<0)?-*v:*v;
+  return row;
+}
+
+int font_wrap_index_line_from_row(int *sub,const struct font_wrap_index *index,int64_t row) {
+  if (sub) *sub=0;
+  if (!index||(row<0)||(index->linec<1)) return 0;
+  if (row>=index->rowc) {
+    int line=index->linec-1;
+    if (sub) *sub=font_wrap_index_get(0,index,line)-1;
+    return line;
+  }
+  int mask=1;
+  while (mask<=index->blockc>>1) mask<<=1;
+  int b=0;
+  for (;mask;mask>>=1) {
+    int q=b+mask;
+    if (q>index->blockc) continue;
+    if (index->rowtree[q-1]<=row) {
+      row-=index->rowtree[q-1];
+      b=q;
+    }
+  }
+  int line=font_wrap_index_lines_before(index,b);
+  const struct font_wrap_block *block=index->blockv[b];
+  int i=0; for (;i<block->linec;i++,line++) {
+    int v=block->rowv[i];
+    if (v<0) v=-v;
+    if (row<v) break;
+    row-=v;
+  }
+  if (sub) *sub=row;
+  return line;
+}
+
+/* Find stale lines.
+ */
+
+int font_wrap_index_next_stale(const struct font_wrap_index *index,int line) {
+  if (!index||(index->stalec<1)) return -1;
+  if (line<0) line=0;
+  if (line>=index->linec) return -1;
+  int local;
+  int b=font_wrap_index_find_line(&local,index,line);
+  line-=local;
+  for (;b<index->blockc;b++) {
+    const struct font_wrap_block *block=index->blockv[b];
+    if (block->stalec) {
+      for (;local<block->linec;local++) {
+        if (block->rowv[local]<0) return line+local;
+      }
+    }
+    line+=block->linec;
+    local=0;
+  }
+  return -1;
+}
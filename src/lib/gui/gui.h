@@ -26,9 +26,15 @@ struct gui_delegate {
   void *userdata;
   double update_rate; // hz, only relevant if you use gui_main.
   int log_clock_at_quit; // 1 to show counters and CPU consumption on normal exits. >1 to log on abnormal exits too.
+  int worker_count; // Threads for background jobs, created on first use. Zero for one per CPU core.
+  double background_rate; // hz while the window is unfocused. Default 10, never more than (update_rate).
+  double hidden_rate; // hz while the window is minimized or covered. We don't render then. Default 1, never less than GUI_CLOCK_RATE_MIN.
+  int ui_scale; // Integer multiplier for fonts and widget metrics, for high-density displays. Zero for 1.
   //TODO
 };
  
+/* Widgets you still hold a reference to survive this, but only to be deleted: Their (ctx) is dangling after.
+ */
 void gui_context_del(struct gui_context *ctx);
 
 struct gui_context *gui_context_new(const struct gui_delegate *delegate);
@@ -58,6 +64,14 @@ void gui_terminate_soon(struct gui_context *ctx,int status);
 struct font *gui_get_default_font(struct gui_context *ctx);
 struct font *gui_get_named_font(struct gui_context *ctx,const char *name,int namec);
 
+/* Integer UI scale, from the delegate. Always at least 1.
+ * Fonts from gui_get_named_font are already scaled.
+ * Widgets express their metrics in 1x pixels and pass them through gui_scale at init, so everything downstream sees device pixels.
+ * If you set a widget's padding directly, do the same.
+ */
+int gui_get_scale(const struct gui_context *ctx);
+int gui_scale(const struct gui_context *ctx,int px);
+
 /* If you're not using gui_main(), call this often.
  * Does not block for timing, that's your concern.
  */
@@ -96,6 +110,52 @@ int gui_defer_widget_task(struct widget *widget,double delay_s,void (*cb)(struct
 void gui_cancel_task(struct gui_context *ctx,int taskid);
 int gui_set_task_cleanup(struct gui_context *ctx,int taskid,void (*cb_cleanup)(struct widget *widget,void *userdata));
 
+/* The only gui call that's safe from other threads.
+ * (cb) runs on the UI thread during the next update, then (cb_cleanup) if provided. In the order they were posted.
+ * If the context is deleted first, only (cb_cleanup) is called.
+ * Widget refcounts are not thread-safe, so we can't retain (widget) for you.
+ * Take a reference with widget_ref() on the UI thread before handing off to your worker; we widget_del() it after cleanup.
+ * (widget) may be null.
+ * gui_main() wakes immediately for posts, it doesn't wait for the next frame.
+ * Workers must finish before you delete the context.
+ */
+int gui_post_from_thread(
+  struct gui_context *ctx,
+  struct widget *widget, // HANDOFF
+  void (*cb)(struct widget *widget,void *userdata),
+  void (*cb_cleanup)(struct widget *widget,void *userdata),
+  void *userdata
+);
+
+/* Idle jobs: Long work on the UI thread, sliced to fit in the time left over after each frame.
+ * (cb) does a bit of work and returns <=0 if finished (or failed), or >0 to be called again later.
+ * Within (cb), call gui_idle_yield() periodically and return >0 as soon as it's nonzero.
+ * Jobs take turns. The returned id is a taskid, usable with gui_cancel_task and gui_set_task_cleanup.
+ * gui_main() runs these automatically.
+ * If you drive gui_update() yourself, call gui_run_idle() after it with however much time you can spare.
+ * It returns >0 if jobs remain, 0 if none.
+ */
+int gui_add_idle_job(struct widget *widget,int (*cb)(struct widget *widget,void *userdata),void *userdata);
+int gui_idle_yield(struct gui_context *ctx);
+int gui_run_idle(struct gui_context *ctx,double budget_s);
+
+/* Run (cb) on the shared worker pool, then (cb_done) on the UI thread with whatever (cb) returned.
+ * (cb) must not touch the gui. It can call pool_cancelled() to check whether it should quit early.
+ * (cb_done) is optional; if present it's called exactly once, with (status) POOL_CANCELLED if the job never ran (see lib/pool/pool.h).
+ * We retain (widget), which may be null, until after (cb_done).
+ * Returns jobid >0, for gui_cancel_background.
+ * gui_get_pool() is for other library units that want to submit raw jobs. Creates the pool if needed.
+ */
+int gui_run_in_background(
+  struct gui_context *ctx,
+  struct widget *widget,
+  int (*cb)(void *userdata),
+  void (*cb_done)(struct widget *widget,int jobid,int status,void *userdata),
+  void *userdata
+);
+void gui_cancel_background(struct gui_context *ctx,int jobid);
+struct pool *gui_get_pool(struct gui_context *ctx);
+
 int gui_add_modal(struct gui_context *ctx,struct widget *modal);
 int gui_remove_modal(struct gui_context *ctx,struct widget *modal);
 struct widget *gui_get_modal(const struct gui_context *ctx);
@@ -164,22 +224,31 @@ struct widget_type {
   int (*mwheel)(struct widget *widget,int dx,int dy,int x,int y);
 };
  
+#define WIDGET_CHILDV_INLINE 3
+
 struct widget {
   const struct widget_type *type;
   struct gui_context *ctx; // REQUIRED.
   int refc;
   struct widget *parent; // WEAK. Null for the root.
-  struct widget **childv; // STRONG.
+  struct widget **childv; // STRONG. Points to (childv_inline) until it outgrows that.
   int childc,childa;
   int x,y,w,h; // (x,y) relative to parent.
   int scrollx,scrolly; // My content is offset by so much. These are typically positive if not zero.
   int padx,pady; // Interior padding. Generic pack and measure will use it. If you do those yourself, it's up to you.
   uint32_t bgcolor; // If nonzero, fill my background with this. (individual render hooks are expected to, and the no-hook default will).
-  int focusable; // Nonzero to accept keyboard focus. Set (ctx->tree_changed) if you change.
-  int clickable; // Nonzero to enable click-and-track from the mouse.
-  int rawmouse; // Nonzero to receive mmotion, mbutton, and mwheel events when the mouse is hovering.
+  int focusable; // Nonzero to accept keyboard focus. Set at init, or use widget_set_focusable() after.
+  int clickable; // Nonzero to enable click-and-track from the mouse. Changes after init take effect at the next pack.
+  int rawmouse; // Nonzero to receive mmotion, mbutton, and mwheel events when the mouse is hovering. Also takes effect at the next pack.
   uint32_t parentuse; // Private field for widget's parent's use only. eg for layout bookkeeping. Resets to zero when reparenting.
   struct widget *proxyto; // STRONG,OPTIONAL. If set, events striking this widget will go to (proxyto) instead. eg I'm a label and it's a field.
+  struct widget *childv_inline[WIDGET_CHILDV_INLINE]; // Private. Most widgets have just a few children, and they live here.
+  
+  // Cached by widget_refresh_transform(), which pack and scroll changes call for you. Read-only.
+  int absx,absy; // My top-left corner in global space, ie where I render.
+  int clipx,clipy,clipw,cliph; // Visible portion of my bounds in global space, after all ancestors' clipping.
+  int mirrorp; // Private. My index in the context's geometry mirror, if it's current.
+  struct gui_slab *slab; // Private. Where I was allocated. Unlike (ctx), it stays valid as long as I do.
 };
 
 void widget_del(struct widget *widget);
@@ -210,6 +279,8 @@ struct widget *widget_spawn(
  * When removing, beware that (parent) very likely holds the last reference to (child). Retain child first if you need to.
  * widget_is_ancestor, the edge case where they're the same widget, the answer is YES.
  */
+int widget_set_focusable(struct widget *widget,int focusable);
+
 int widget_childv_insert(struct widget *parent,int p,struct widget *child);
 int widget_childv_remove(struct widget *parent,struct widget *child);
 int widget_childv_remove_at(struct widget *parent,int p);
@@ -222,16 +293,30 @@ int widget_is_ancestor(const struct widget *ancestor,const struct widget *descen
 struct widget *widget_get_root(struct widget *widget);
 
 /* Rewrite (x,y) in place to convert between (widget)'s origin and the global origin.
+ * (widget)'s own scroll applies, ie local space is its content.
+ * These and the next two read the cached transform, they don't walk the tree.
  */
 void widget_coords_global_from_local(int *x,int *y,const struct widget *widget);
 void widget_coords_local_from_global(int *x,int *y,const struct widget *widget);
 
+// (x,y) in global space.
 int widget_point_in_bounds(const struct widget *widget,int x,int y);
 
-/* Examine all ancestor boundaries and return the bounds in global space that this widget clips to.
+/* The bounds in global space that this widget clips to, considering all ancestors.
  */
 void widget_get_clip(int *x,int *y,int *w,int *h,const struct widget *widget);
 
+/* Recalculate cached (absx,absy,clip*) for (widget) and all its descendants, from its parent's cached values.
+ * widget_pack() does this at the end of the outermost call, and adding a child does it for the new subtree.
+ * You only need to call it yourself if you move a widget without packing it.
+ */
+void widget_refresh_transform(struct widget *widget);
+
+/* Change (scrollx,scrolly) and refresh the descendants' transforms.
+ * Doesn't render; set (render_soon) yourself.
+ */
+void widget_set_scroll(struct widget *widget,int x,int y);
+
 /* Render all my child widgets into (dst), which must have (widget)'s bounds.
  * ie this takes exactly the same arguments as the render hook.
  * It's better to set (type->autorender) and let the wrapper take care of it.
@@ -253,6 +338,10 @@ int widget_set_proxy(struct widget *proxy,struct widget *target);
 /* Timing regulator, used by gui_main().
  *************************************************************************/
  
+#define GUI_CLOCK_WAKEFD_LIMIT 4
+#define GUI_CLOCK_RATE_MIN 0.1 /* hz. Low rates are for hidden windows, which mostly wake on input or posts anyway. */
+#define GUI_CLOCK_RATE_MAX 1000.0
+
 struct gui_clock {
   double period; // Desired update period in seconds. Typically 1/60.
   double starttime_real;
@@ -261,6 +350,9 @@ struct gui_clock {
   double nexttime;
   int framec;
   int panicc;
+  // Optional. If present, we poll these instead of sleeping, and return early when one becomes readable.
+  int wakefdv[GUI_CLOCK_WAKEFD_LIMIT];
+  int wakefdc;
 };
 
 // Read the realtime and cpu clocks.
@@ -273,8 +365,15 @@ void gui_sleep(double s);
  */
 void gui_clock_init(struct gui_clock *clock,double rate_hz);
 
+/* Change rate without resetting counters.
+ * Rates outside (GUI_CLOCK_RATE_MIN..GUI_CLOCK_RATE_MAX) are clamped.
+ * If the next tick was due later than one new period from the last, it's pulled in.
+ */
+void gui_clock_set_rate(struct gui_clock *clock,double rate_hz);
+
 /* Examine current and recent time.
  * If it's too soon, we'll sleep into the next period.
+ * If a (wakefdv) becomes readable while sleeping, we return early. That doesn't count as a frame; the next tick resumes the schedule.
  * Returns time elapsed since the last tick, or a sensible lie on the first tick.
  */
 double gui_clock_tick(struct gui_clock *clock);
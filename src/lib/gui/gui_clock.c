@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <time.h>
+#include <poll.h>
 
 /* System clocks.
  * TODO These are for Linux. Not sure if there are other things we should use, for Windows and MacOS.
@@ -37,12 +38,23 @@ void gui_clock_init(struct gui_clock *clock,double rate_hz) {
   clock->prevtime=clock->nexttime=clock->starttime_real;
   clock->framec=0;
   clock->panicc=0;
+  clock->wakefdc=0;
   
   // Now lie a little bit about (prevtime), pretend it's one cycle ago.
   // The first tick won't sleep, but we want it to report a sane interval.
   clock->prevtime-=clock->period;
 }
 
+/* Change rate.
+ */
+
+void gui_clock_set_rate(struct gui_clock *clock,double rate_hz) {
+  if (rate_hz<GUI_CLOCK_RATE_MIN) rate_hz=GUI_CLOCK_RATE_MIN;
+  else if (rate_hz>GUI_CLOCK_RATE_MAX) rate_hz=GUI_CLOCK_RATE_MAX;
+  clock->period=1.0/rate_hz;
+  if (clock->nexttime>clock->prevtime+clock->period) clock->nexttime=clock->prevtime+clock->period;
+}
+
 /* Tick.
  */
 
@@ -51,15 +63,32 @@ double gui_clock_tick(struct gui_clock *clock) {
   double now=gui_now_real();
   while (now<clock->nexttime) {
     double sleeptime=clock->nexttime-now+0.001; // Plus a millisecond in case the system sleeps a little short, eg rounding error.
-    // Negative sleep time, or substantially slower than 1 Hz, means the clock is broken.
+    // Negative sleep time, or substantially longer than a period, means the clock is broken.
     // Log a panic, reset, and don't sleep.
-    if ((sleeptime<0.0)||(sleeptime>2.0)) {
+    if ((sleeptime<0.0)||(sleeptime>clock->period+1.0)) {
       clock->panicc++;
       clock->nexttime=now;
       clock->prevtime=now-clock->period;
       break;
     }
-    gui_sleep(sleeptime);
+    if (clock->wakefdc>0) {
+      struct pollfd pollfdv[GUI_CLOCK_WAKEFD_LIMIT];
+      int i=0; for (;i<clock->wakefdc;i++) {
+        pollfdv[i].fd=clock->wakefdv[i];
+        pollfdv[i].events=POLLIN;
+        pollfdv[i].revents=0;
+      }
+      int ms=(int)(sleeptime*1000.0);
+      if (poll(pollfdv,clock->wakefdc,ms)>0) {
+        // Woken early. Report the time, but don't consume a period.
+        now=gui_now_real();
+        double elapsed=now-clock->prevtime;
+        clock->prevtime=now;
+        return elapsed;
+      }
+    } else {
+      gui_sleep(sleeptime);
+    }
     now=gui_now_real();
   }
   
@@ -21,6 +21,9 @@ void gui_context_del(struct gui_context *ctx) {
   if (!ctx) return;
   wm_quit();
   if (ctx==gui_global_context) gui_global_context=0;
+  pool_del(ctx->pool); // First, so any completions land in the post queue, which cleans them up next.
+  gui_post_cleanup(ctx);
+  gui_idle_cleanup(ctx);
   if (ctx->deferredv) {
     struct deferred *deferred=ctx->deferredv+ctx->deferredc;
     while (ctx->deferredc-->0) {
@@ -34,16 +37,15 @@ void gui_context_del(struct gui_context *ctx) {
     while (ctx->modalc-->0) widget_del(ctx->modalv[ctx->modalc]);
     free(ctx->modalv);
   }
-  if (ctx->focusv) {
-    while (ctx->focusc-->0) widget_del(ctx->focusv[ctx->focusc]);
-    free(ctx->focusv);
-  }
+  if (ctx->focusv) free(ctx->focusv);
   widget_del(ctx->track);
   widget_del(ctx->root);
   if (ctx->fontv) {
     while (ctx->fontc-->0) font_entry_cleanup(ctx->fontv+ctx->fontc);
     free(ctx->fontv);
   }
+  gui_mirror_cleanup(&ctx->mirror);
+  gui_slab_release(ctx->slab); // Last, after our widgets are gone. Any the client still holds keep it alive.
   free(ctx);
 }
 
@@ -56,13 +58,31 @@ struct gui_context *gui_context_new(const struct gui_delegate *delegate) {
   struct gui_context *ctx=calloc(1,sizeof(struct gui_context));
   if (!ctx) return 0;
   gui_global_context=ctx;
+  ctx->wakefd[0]=ctx->wakefd[1]=-1;
+  if (!(ctx->slab=gui_slab_new())) {
+    gui_context_del(ctx);
+    return 0;
+  }
   
   if (delegate) ctx->delegate=*delegate;
   if (ctx->delegate.update_rate<1.0) ctx->delegate.update_rate=60.0;
+  else if (ctx->delegate.update_rate>GUI_CLOCK_RATE_MAX) ctx->delegate.update_rate=GUI_CLOCK_RATE_MAX;
+  if (ctx->delegate.background_rate<=0.0) ctx->delegate.background_rate=10.0;
+  else if (ctx->delegate.background_rate<GUI_CLOCK_RATE_MIN) ctx->delegate.background_rate=GUI_CLOCK_RATE_MIN;
+  if (ctx->delegate.background_rate>ctx->delegate.update_rate) ctx->delegate.background_rate=ctx->delegate.update_rate;
+  if (ctx->delegate.hidden_rate<=0.0) ctx->delegate.hidden_rate=1.0;
+  else if (ctx->delegate.hidden_rate<GUI_CLOCK_RATE_MIN) ctx->delegate.hidden_rate=GUI_CLOCK_RATE_MIN;
+  if (ctx->delegate.hidden_rate>ctx->delegate.background_rate) ctx->delegate.hidden_rate=ctx->delegate.background_rate;
+  if (ctx->delegate.ui_scale<1) ctx->delegate.ui_scale=1;
+  else if (ctx->delegate.ui_scale>GUI_SCALE_LIMIT) ctx->delegate.ui_scale=GUI_SCALE_LIMIT;
+  ctx->focus=1;
+  ctx->visible=1;
   ctx->focusp=-1;
   ctx->encoding=&text_encoding_utf8;
   ctx->double_click_interval=0.500; // Some quick Googling suggests 500 is the prevailing default, and 100..900 the usual config range. Mine are pretty uniformly 100-130ms.
   
+  gui_post_init(ctx); // Failure is not fatal. Posts will still run, just at the next regular update.
+  
   struct wm_delegate wmdelegate={
     .cb_close=gui_cb_close,
     .cb_resize=gui_cb_resize,
@@ -72,6 +92,7 @@ struct gui_context *gui_context_new(const struct gui_delegate *delegate) {
     .cb_mmotion=gui_cb_mmotion,
     .cb_mbutton=gui_cb_mbutton,
     .cb_mwheel=gui_cb_mwheel,
+    .cb_visibility=gui_cb_visibility,
   };
   if (wm_init(&wmdelegate)<0) {
     gui_context_del(ctx);
@@ -170,22 +191,44 @@ static int gui_check_deferred_tasks(struct gui_context *ctx) {
  
 int gui_update(struct gui_context *ctx,double elapsed) {
   ctx->totalclock+=elapsed;
+  if (gui_post_update(ctx)<0) return -1;
   if (gui_check_deferred_tasks(ctx)<0) return -1;
   if (ctx->tree_changed) {
     ctx->tree_changed=0;
     widget_pack(ctx->root);
     int i=ctx->modalc;
     while (i-->0) widget_pack(ctx->modalv[i]);
-    gui_rebuild_focus_ring(ctx);
+    gui_focus_default(ctx);
     ctx->render_soon=1;
   }
-  if (ctx->render_soon) {
+  if (ctx->render_soon&&ctx->visible) {
     ctx->render_soon=0;
     gui_render(ctx);
   }
   return 0;
 }
 
+/* Before each tick of the main loop, choose a rate appropriate to our window's state.
+ * And don't sleep past the next deferred task.
+ */
+ 
+static void gui_main_adjust_clock(struct gui_context *ctx,struct gui_clock *clock) {
+  double rate;
+  if (!ctx->visible) rate=ctx->delegate.hidden_rate;
+  else if (!ctx->focus) rate=ctx->delegate.background_rate;
+  else rate=ctx->delegate.update_rate;
+  if (clock->period!=1.0/rate) gui_clock_set_rate(clock,rate);
+  
+  if (ctx->deferredc>0) {
+    double when=ctx->deferredv[0].when;
+    int i=ctx->deferredc;
+    while (i-->1) if (ctx->deferredv[i].when<when) when=ctx->deferredv[i].when;
+    // (totalclock) advances in real time, as of the last tick.
+    double due=clock->prevtime+when-ctx->totalclock;
+    if (due<clock->nexttime) clock->nexttime=due;
+  }
+}
+
 /* Main.
  */
 
@@ -193,16 +236,27 @@ int gui_main(struct gui_context *ctx) {
   if (!ctx||(ctx!=gui_global_context)) return 1;
   struct gui_clock clock;
   gui_clock_init(&clock,ctx->delegate.update_rate);
+  if (ctx->wakefd[0]>=0) clock.wakefdv[clock.wakefdc++]=ctx->wakefd[0];
+  if ((clock.wakefdv[clock.wakefdc]=wm_get_event_fd())>=0) clock.wakefdc++; // Wake on input, so low background rates don't add latency.
   while (!ctx->terminate) {
     if (wm_update()<0) {
       if (ctx->delegate.log_clock_at_quit>1) gui_clock_report(&clock);
       return 1;
     }
+    gui_main_adjust_clock(ctx,&clock);
     double elapsed=gui_clock_tick(&clock);
     if (gui_update(ctx,elapsed)<0) {
       if (ctx->delegate.log_clock_at_quit>1) gui_clock_report(&clock);
       return 1;
     }
+    if (ctx->idlec>0) {
+      // Whatever's left of this frame goes to idle jobs, less a margin for the sleep and wakeup.
+      double budget=clock.nexttime-gui_now_real()-clock.period*0.125;
+      if (gui_run_idle(ctx,budget)<0) {
+        if (ctx->delegate.log_clock_at_quit>1) gui_clock_report(&clock);
+        return 1;
+      }
+    }
   }
   if (ctx->delegate.log_clock_at_quit) gui_clock_report(&clock);
   return 0;
@@ -230,6 +284,8 @@ struct widget *gui_context_create_root(
   struct widget *widget=widget_new(ctx,type,args,argslen);
   if (!widget) return 0;
   ctx->root=widget;
+  ctx->mirror.dirty=1;
+  gui_rebuild_focus_ring(ctx);
   widget->x=0;
   widget->y=0;
   widget->w=ctx->w;
@@ -247,6 +303,19 @@ struct font *gui_get_default_font(struct gui_context *ctx) {
   return ctx->fontv[0].font;
 }
 
+/* UI scale.
+ */
+ 
+int gui_get_scale(const struct gui_context *ctx) {
+  if (!ctx) return 1;
+  return ctx->delegate.ui_scale;
+}
+
+int gui_scale(const struct gui_context *ctx,int px) {
+  if (!ctx) return px;
+  return px*ctx->delegate.ui_scale;
+}
+
 struct font *gui_get_named_font(struct gui_context *ctx,const char *name,int namec) {
   if (!ctx) return 0;
   if (!name) return 0;
@@ -270,11 +339,24 @@ struct font *gui_get_named_font(struct gui_context *ctx,const char *name,int nam
     ctx->fonta=na;
   }
   
-  char path[1024];
-  int pathc=snprintf(path,sizeof(path),"src/lib/gui/img/%.*s.png",namec,name);//TODO
-  if ((pathc<1)||(pathc>=sizeof(path))) return 0;
-  struct font *font=font_new_from_path(path,ctx->encoding);
-  if (!font) return 0;
+  struct font *font=0;
+  const struct gui_embedded_font *embedded=gui_embedded_fontv;
+  for (i=gui_embedded_fontc;i-->0;embedded++) {
+    if (strncmp(embedded->name,name,namec)||embedded->name[namec]) continue;
+    if (!(font=font_new_from_a1(embedded->a1,embedded->w,embedded->h,embedded->stride,ctx->encoding))) return 0;
+    break;
+  }
+  if (!font) {
+    char path[1024];
+    int pathc=snprintf(path,sizeof(path),"src/lib/gui/img/%.*s.png",namec,name);//TODO
+    if ((pathc<1)||(pathc>=sizeof(path))) return 0;
+    if (!(font=font_new_from_path(path,ctx->encoding))) return 0;
+  }
+  if (ctx->delegate.ui_scale>1) {
+    struct font *scaled=font_new_scaled(font,ctx->delegate.ui_scale);
+    font_del(font);
+    if (!(font=scaled)) return 0;
+  }
   
   char *nname=malloc(namec+1);
   if (!nname) {
@@ -335,6 +417,7 @@ void gui_cancel_task(struct gui_context *ctx,int taskid) {
     widget_del(tmp.widget);
     return;
   }
+  gui_idle_cancel(ctx,taskid);
 }
 
 /* Set task cleanup.
@@ -349,7 +432,7 @@ int gui_set_task_cleanup(struct gui_context *ctx,int taskid,void (*cb_cleanup)(s
     deferred->cb_cleanup=cb_cleanup;
     return 0;
   }
-  return -1;
+  return gui_idle_set_cleanup(ctx,taskid,cb_cleanup);
 }
 
 /* Modal stack.
@@ -369,6 +452,7 @@ int gui_add_modal(struct gui_context *ctx,struct widget *modal) {
   if (widget_ref(modal)<0) return -1;
   ctx->modalv[ctx->modalc++]=modal;
   ctx->tree_changed=1;
+  ctx->mirror.dirty=1;
   gui_rebuild_focus_ring(ctx);
   return 0;
 }
@@ -381,8 +465,9 @@ int gui_remove_modal(struct gui_context *ctx,struct widget *modal) {
     ctx->modalc--;
     memmove(ctx->modalv+i,ctx->modalv+i+1,sizeof(void*)*(ctx->modalc-i));
     ctx->tree_changed=1;
+    ctx->mirror.dirty=1; // Even if the new top has the same address as some old one, it's a different tree.
+    gui_rebuild_focus_ring(ctx); // Before deleting; the ring is weak and might still point into (modal).
     widget_del(modal);
-    gui_rebuild_focus_ring(ctx);
     return 0;
   }
   return -1;
@@ -31,7 +31,15 @@ void gui_cb_resize(int w,int h) {
  */
  
 void gui_cb_focus(int focus) {
-  fprintf(stderr,"%s %d\n",__func__,focus);
+  gui_global_context->focus=focus;
+}
+
+/* Window hidden or shown.
+ */
+ 
+void gui_cb_visibility(int visible) {
+  gui_global_context->visible=visible;
+  // Renders that came due while hidden stay pending, so we'll catch up on the next update.
 }
 
 /* Window exposure.
@@ -91,46 +99,6 @@ void gui_cb_key(int keycode,int value,int codepoint) {
   }
 }
 
-/* Find a widget that supports tracking, at the given point.
- */
- 
-static struct widget *gui_find_track_widget(struct widget *widget,int x,int y) {
-  if (!widget_point_in_bounds(widget,x,y)) return 0;
-  struct widget **childp=widget->childv;
-  int i=widget->childc;
-  for (;i-->0;childp++) {
-    struct widget *child=*childp;
-    struct widget *found=gui_find_track_widget(child,x,y);
-    if (found) return found;
-  }
-  if (widget->proxyto) {
-    if (widget->proxyto->parent&&widget->proxyto->clickable) return widget;
-  } else {
-    if (widget->clickable) return widget;
-  }
-  return 0;
-}
-
-/* Find the innermost widget that supports raw mouse events, at the given point.
- */
- 
-static struct widget *gui_find_mouse_widget(struct widget *widget,int x,int y) {
-  if (!widget_point_in_bounds(widget,x,y)) return 0;
-  struct widget **childp=widget->childv;
-  int i=widget->childc;
-  for (;i-->0;childp++) {
-    struct widget *child=*childp;
-    struct widget *found=gui_find_mouse_widget(child,x,y);
-    if (found) return found;
-  }
-  if (widget->proxyto) {
-    if (widget->proxyto->parent&&widget->proxyto->rawmouse) return widget;
-  } else {
-    if (widget->rawmouse) return widget;
-  }
-  return 0;
-}
-
 /* Mouse motion, client coords.
  */
  
@@ -157,9 +125,7 @@ void gui_cb_mmotion(int x,int y) {
   
   // Raw.
   } else {
-    struct widget *root=ctx->root;
-    if (ctx->modalc>0) root=ctx->modalv[ctx->modalc-1];
-    struct widget *hover=gui_find_mouse_widget(root,ctx->mx,ctx->my);
+    struct widget *hover=gui_mirror_hit(ctx,ctx->mx,ctx->my,GUI_MIRROR_RAWMOUSE);
     while (hover) {
       struct widget *target=hover->proxyto?hover->proxyto:hover;
       if (target->rawmouse&&target->type->mmotion&&target->type->mmotion(target,ctx->mx,ctx->my)) break;
@@ -204,7 +170,7 @@ void gui_cb_mbutton(int btnid,int value) {
   if ((btnid==1)&&value) {
     struct widget *root=ctx->root;
     if (ctx->modalc>0) root=ctx->modalv[ctx->modalc-1];
-    struct widget *track=gui_find_track_widget(root,ctx->mx,ctx->my);
+    struct widget *track=gui_mirror_hit(ctx,ctx->mx,ctx->my,GUI_MIRROR_CLICKABLE);
     if (track) {
       struct widget *target=track->proxyto?track->proxyto:track;
       int ack=target->type->track(target,GUI_TRACK_BEGIN);
@@ -225,9 +191,7 @@ void gui_cb_mbutton(int btnid,int value) {
   
   /* Not tracking, send raw mouse events.
    */
-  struct widget *root=ctx->root;
-  if (ctx->modalc>0) root=ctx->modalv[ctx->modalc-1];
-  struct widget *hover=gui_find_mouse_widget(root,ctx->mx,ctx->my);
+  struct widget *hover=gui_mirror_hit(ctx,ctx->mx,ctx->my,GUI_MIRROR_RAWMOUSE);
   while (hover) {
     struct widget *target=hover->proxyto?hover->proxyto:hover;
     if (target->rawmouse&&target->type->mbutton&&target->type->mbutton(target,btnid,value,ctx->mx,ctx->my)) break;
@@ -241,9 +205,7 @@ void gui_cb_mbutton(int btnid,int value) {
 void gui_cb_mwheel(int dx,int dy) {
   struct gui_context *ctx=gui_global_context;
   if (!ctx) return;
-  struct widget *root=ctx->root;
-  if (ctx->modalc>0) root=ctx->modalv[ctx->modalc-1];
-  struct widget *hover=gui_find_mouse_widget(root,ctx->mx,ctx->my);
+  struct widget *hover=gui_mirror_hit(ctx,ctx->mx,ctx->my,GUI_MIRROR_RAWMOUSE);
   while (hover) {
     struct widget *target=hover->proxyto?hover->proxyto:hover;
     if (target->rawmouse&&target->type->mwheel&&target->type->mwheel(target,dx,dy,ctx->mx,ctx->my)) break;
@@ -1,63 +1,187 @@
 #include "gui_internal.h"
 
-/* Add one widget to the focus ring.
+/* Which tree is the focus ring tracking? Topmost modal if there is one, otherwise the root.
  */
  
-static int gui_add_focus(struct gui_context *ctx,struct widget *widget) {
-  if (ctx->focusc>=ctx->focusa) {
-    int na=ctx->focusa+16;
+static struct widget *gui_focus_active_root(const struct gui_context *ctx) {
+  if (ctx->modalc>0) return ctx->modalv[ctx->modalc-1];
+  return ctx->root;
+}
+
+static int gui_focus_tracks(const struct gui_context *ctx,const struct widget *widget) {
+  const struct widget *root=gui_focus_active_root(ctx);
+  if (!root) return 0;
+  while (widget->parent) widget=widget->parent;
+  return (widget==root);
+}
+
+/* Compare two widgets' positions in a preorder walk of their tree: <0 if (a) comes first.
+ * Costs a walk to the root, plus a scan of the sibling list where they diverge.
+ * That scan runs from the back and stops at whichever it meets first, so a newly appended child costs nothing extra.
+ */
+ 
+static int gui_compare_tree_order(const struct widget *a,const struct widget *b) {
+  if (a==b) return 0;
+  int da=0,db=0;
+  const struct widget *pa,*pb;
+  for (pa=a;pa->parent;pa=pa->parent) da++;
+  for (pb=b;pb->parent;pb=pb->parent) db++;
+  for (pa=a;da>db;da--) pa=pa->parent;
+  for (pb=b;db>da;db--) pb=pb->parent;
+  if (pa==pb) return (pa==a)?-1:1; // One is an ancestor of the other. Ancestors come first.
+  while (pa->parent!=pb->parent) {
+    pa=pa->parent;
+    pb=pb->parent;
+  }
+  if (!pa->parent) return 0; // Different trees, shouldn't happen.
+  struct widget **v=pa->parent->childv;
+  int i=pa->parent->childc;
+  while (i-->0) {
+    if (v[i]==pa) return 1;
+    if (v[i]==pb) return -1;
+  }
+  return 0;
+}
+
+/* Index of the first ring entry not before (widget) in tree order.
+ */
+ 
+static int gui_focus_search(const struct gui_context *ctx,const struct widget *widget) {
+  // Appending is by far the most common case, check that first.
+  if ((ctx->focusc<1)||(gui_compare_tree_order(ctx->focusv[ctx->focusc-1],widget)<0)) return ctx->focusc;
+  int lo=0,hi=ctx->focusc-1;
+  while (lo<hi) {
+    int ck=(lo+hi)>>1;
+    if (gui_compare_tree_order(ctx->focusv[ck],widget)<0) lo=ck+1;
+    else hi=ck;
+  }
+  return lo;
+}
+
+/* Insert the focusable widgets of a new subtree, as one contiguous block.
+ */
+ 
+static int gui_focus_count_subtree(const struct widget *widget) {
+  int c=widget->focusable?1:0,i=widget->childc;
+  while (i-->0) c+=gui_focus_count_subtree(widget->childv[i]);
+  return c;
+}
+
+static struct widget **gui_focus_list_subtree(struct widget **dst,struct widget *widget) {
+  if (widget->focusable) *(dst++)=widget;
+  int i=0;
+  for (;i<widget->childc;i++) dst=gui_focus_list_subtree(dst,widget->childv[i]);
+  return dst;
+}
+ 
+static int gui_focus_insert(struct gui_context *ctx,struct widget *widget,int recursive) {
+  int addc=recursive?gui_focus_count_subtree(widget):widget->focusable?1:0;
+  if (addc<1) return 0;
+  if (ctx->focusc>INT_MAX-addc) return -1;
+  if (ctx->focusc+addc>ctx->focusa) {
+    int na=ctx->focusc+addc+16;
     if (na>INT_MAX/sizeof(void*)) return -1;
     void *nv=realloc(ctx->focusv,sizeof(void*)*na);
     if (!nv) return -1;
     ctx->focusv=nv;
     ctx->focusa=na;
   }
-  if (widget_ref(widget)<0) return -1;
-  ctx->focusv[ctx->focusc++]=widget;
+  int p=gui_focus_search(ctx,widget);
+  memmove(ctx->focusv+p+addc,ctx->focusv+p,sizeof(void*)*(ctx->focusc-p));
+  if (recursive) gui_focus_list_subtree(ctx->focusv+p,widget);
+  else ctx->focusv[p]=widget;
+  ctx->focusc+=addc;
+  if (ctx->focusp>=p) ctx->focusp+=addc;
   return 0;
 }
 
-/* Build focus ring.
- * Must be empty at the start.
- * This is recursive. We first add (widget) itself if applicable, then recur into its children in order.
+/* Remove (widget), and its descendants if (recursive), from the ring.
+ * If the current focus is among them, we return it WEAK. And blur it, if (blur).
+ * Must be called while (widget) is still attached to the tree.
  */
  
-static int gui_build_focus_ring(struct gui_context *ctx,struct widget *widget) {
-  if (!widget) return 0;
-  if (widget->focusable) {
-    if (gui_add_focus(ctx,widget)<0) return -1;
+static struct widget *gui_focus_remove(struct gui_context *ctx,struct widget *widget,int recursive,int blur) {
+  int p=gui_focus_search(ctx,widget);
+  int c=0;
+  if (recursive) {
+    while ((p+c<ctx->focusc)&&widget_is_ancestor(widget,ctx->focusv[p+c])) c++;
+  } else if ((p<ctx->focusc)&&(ctx->focusv[p]==widget)) {
+    c=1;
   }
-  int i=0;
-  for (;i<widget->childc;i++) {
-    if (gui_build_focus_ring(ctx,widget->childv[i])<0) return -1;
+  if (c<1) return 0;
+  struct widget *focus=0;
+  if ((ctx->focusp>=p+c)) ctx->focusp-=c;
+  else if (ctx->focusp>=p) {
+    focus=ctx->focusv[ctx->focusp];
+    ctx->focusp=-1;
+  }
+  ctx->focusc-=c;
+  memmove(ctx->focusv+p,ctx->focusv+p+c,sizeof(void*)*(ctx->focusc-p));
+  if (blur&&focus&&focus->type->focus) focus->type->focus(focus,0);
+  return focus;
+}
+
+/* Hooks for widget.c.
+ */
+ 
+void gui_focus_child_added(struct gui_context *ctx,struct widget *child) {
+  if (!gui_focus_tracks(ctx,child)) return;
+  gui_focus_insert(ctx,child,1);
+}
+
+void gui_focus_child_removing(struct gui_context *ctx,struct widget *child) {
+  if (!gui_focus_tracks(ctx,child)) return;
+  gui_focus_remove(ctx,child,1,1);
+}
+
+struct widget *gui_focus_child_moving(struct gui_context *ctx,struct widget *child) {
+  if (!gui_focus_tracks(ctx,child)) return 0;
+  return gui_focus_remove(ctx,child,1,0);
+}
+
+void gui_focus_child_moved(struct gui_context *ctx,struct widget *child,struct widget *focus) {
+  if (!gui_focus_tracks(ctx,child)) return;
+  gui_focus_insert(ctx,child,1);
+  if (focus) { // Focus came along for the ride. It never blurred, so don't tell it anything.
+    int p=gui_focus_search(ctx,focus);
+    if ((p<ctx->focusc)&&(ctx->focusv[p]==focus)) ctx->focusp=p;
+  }
+}
+
+void gui_focus_focusable_changed(struct gui_context *ctx,struct widget *widget) {
+  if (!gui_focus_tracks(ctx,widget)) return;
+  if (widget->focusable) gui_focus_insert(ctx,widget,0);
+  else gui_focus_remove(ctx,widget,0,1);
+}
+
+/* If nothing is focussed, focus the first thing in the ring.
+ */
+ 
+void gui_focus_default(struct gui_context *ctx) {
+  if ((ctx->focusp<0)&&ctx->focusc) {
+    ctx->focusp=0;
+    struct widget *focus=ctx->focusv[0];
+    if (focus->type->focus) focus->type->focus(focus,1);
   }
-  return 0;
 }
 
 /* Rebuild focus ring.
+ * Only needed when the active root changes, ie modals come or go.
  */
  
 void gui_rebuild_focus_ring(struct gui_context *ctx) {
   
-  // Yoink the previous focus if present.
+  // Note the previous focus if present. The ring is WEAK, so caller must ensure it's still alive.
   struct widget *pvfocus=0;
   if ((ctx->focusp>=0)&&(ctx->focusp<ctx->focusc)) {
-    pvfocus=ctx->focusv[ctx->focusp]; // HANDOFF, temporarily
-    ctx->focusc--;
-    memmove(ctx->focusv+ctx->focusp,ctx->focusv+ctx->focusp+1,sizeof(void*)*(ctx->focusc-ctx->focusp));
+    pvfocus=ctx->focusv[ctx->focusp];
   }
   ctx->focusp=-1;
+  ctx->focusc=0;
   
-  // Drop the previous ring.
-  while (ctx->focusc>0) {
-    ctx->focusc--;
-    widget_del(ctx->focusv[ctx->focusc]);
-  }
-  
-  // Call out to build the new ring.
-  struct widget *root=ctx->root;
-  if (ctx->modalc>0) root=ctx->modalv[ctx->modalc-1];
-  gui_build_focus_ring(ctx,root);
+  // Build the new ring.
+  struct widget *root=gui_focus_active_root(ctx);
+  if (root) gui_focus_insert(ctx,root,1);
   
   // If there was a focus before, either blur it or update our (focusp).
   if (pvfocus) {
@@ -73,15 +197,9 @@ void gui_rebuild_focus_ring(struct gui_context *ctx) {
     } else { // Not focusable anymore, probly was dropped. Tell it.
       if (pvfocus->type->focus) pvfocus->type->focus(pvfocus,0);
     }
-    widget_del(pvfocus);
   }
   
-  // If we don't now have a focus, use the first thing in the ring.
-  if ((ctx->focusp<0)&&ctx->focusc) {
-    ctx->focusp=0;
-    struct widget *focus=ctx->focusv[0];
-    if (focus->type->focus) focus->type->focus(focus,1);
-  }
+  gui_focus_default(ctx);
 }
 
 /* Public: Query focus or move relatively.
@@ -0,0 +1,115 @@
+/* gui_idle.c
+ * Resumable jobs that run in whatever time is left over after each frame.
+ * Jobs take turns round-robin, so one huge job doesn't starve the others.
+ */
+
+#include "gui_internal.h"
+
+/* Add job.
+ */
+
+int gui_add_idle_job(struct widget *widget,int (*cb)(struct widget *widget,void *userdata),void *userdata) {
+  if (!widget||!widget->ctx||!cb) return -1;
+  struct gui_context *ctx=widget->ctx;
+  if (ctx->idlec>=ctx->idlea) {
+    int na=ctx->idlea+8;
+    if (na>INT_MAX/sizeof(struct idle_job)) return -1;
+    void *nv=realloc(ctx->idlev,sizeof(struct idle_job)*na);
+    if (!nv) return -1;
+    ctx->idlev=nv;
+    ctx->idlea=na;
+  }
+  if (widget_ref(widget)<0) return -1;
+  struct idle_job *job=ctx->idlev+ctx->idlec++;
+  memset(job,0,sizeof(struct idle_job));
+  job->widget=widget;
+  job->cb=cb;
+  job->userdata=userdata;
+  if (ctx->taskid_next<1) ctx->taskid_next=1;
+  job->taskid=ctx->taskid_next++;
+  return job->taskid;
+}
+
+/* Remove job by index, calling its cleanup.
+ */
+
+static void gui_idle_remove(struct gui_context *ctx,int p) {
+  struct idle_job tmp=ctx->idlev[p];
+  ctx->idlec--;
+  memmove(ctx->idlev+p,ctx->idlev+p+1,sizeof(struct idle_job)*(ctx->idlec-p));
+  if (ctx->idlep>p) ctx->idlep--;
+  if (tmp.cb_cleanup) tmp.cb_cleanup(tmp.widget,tmp.userdata);
+  widget_del(tmp.widget);
+}
+
+static int gui_idle_find(const struct gui_context *ctx,int taskid) {
+  int i=ctx->idlec;
+  while (i-->0) if (ctx->idlev[i].taskid==taskid) return i;
+  return -1;
+}
+
+/* Cancel, or set cleanup. gui_cancel_task and gui_set_task_cleanup call these when the taskid isn't a deferred task.
+ */
+
+int gui_idle_cancel(struct gui_context *ctx,int taskid) {
+  int p=gui_idle_find(ctx,taskid);
+  if (p<0) return -1;
+  gui_idle_remove(ctx,p);
+  return 0;
+}
+
+int gui_idle_set_cleanup(struct gui_context *ctx,int taskid,void (*cb_cleanup)(struct widget *widget,void *userdata)) {
+  int p=gui_idle_find(ctx,taskid);
+  if (p<0) return -1;
+  ctx->idlev[p].cb_cleanup=cb_cleanup;
+  return 0;
+}
+
+/* Delete all jobs at context cleanup.
+ */
+
+void gui_idle_cleanup(struct gui_context *ctx) {
+  while (ctx->idlec>0) gui_idle_remove(ctx,ctx->idlec-1);
+  if (ctx->idlev) free(ctx->idlev);
+  ctx->idlev=0;
+  ctx->idlea=0;
+}
+
+/* Check budget.
+ */
+
+int gui_idle_yield(struct gui_context *ctx) {
+  if (!ctx) return 1;
+  return (gui_now_real()>=ctx->idle_deadline);
+}
+
+/* Run jobs until the budget is spent.
+ */
+
+int gui_run_idle(struct gui_context *ctx,double budget_s) {
+  if (!ctx) return -1;
+  if (ctx->idlec<1) return 0;
+  if (budget_s<=0.0) return 1;
+  double now=gui_now_real();
+  ctx->idle_deadline=now+budget_s;
+  while ((ctx->idlec>0)&&(now<ctx->idle_deadline)) {
+    if ((ctx->idlep<0)||(ctx->idlep>=ctx->idlec)) ctx->idlep=0;
+    struct idle_job *job=ctx->idlev+ctx->idlep;
+
+    // The job might be cancelled, or others added, while it runs. Hold the widget, and find the job again after by taskid.
+    int taskid=job->taskid;
+    struct widget *widget=job->widget;
+    if (widget_ref(widget)<0) return -1;
+    int err=job->cb(widget,job->userdata);
+    widget_del(widget);
+
+    int p=gui_idle_find(ctx,taskid);
+    if (p>=0) {
+      if (err<=0) gui_idle_remove(ctx,p);
+      else ctx->idlep=p+1;
+    }
+    now=gui_now_real();
+  }
+  ctx->idle_deadline=0.0;
+  return (ctx->idlec>0)?1:0;
+}
@@ -6,6 +6,7 @@
 #include "lib/image/image.h"
 #include "lib/font/font.h"
 #include "lib/text/text.h"
+#include "lib/pool/pool.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -16,6 +17,24 @@
 /* Context.
  ****************************************************************************/
 
+#define GUI_MIRROR_CLICKABLE 0x01
+#define GUI_MIRROR_RAWMOUSE  0x02
+#define GUI_MIRROR_PROXY     0x04
+
+// Geometry of the active tree in preorder, structure-of-arrays. See gui_mirror.c.
+struct gui_mirror {
+  int *xv,*yv,*wv,*hv; // Bounds in global space.
+  int *endv; // Index just past each widget's subtree.
+  int *parentv; // -1 for the root.
+  uint8_t *flagv; // GUI_MIRROR_*
+  struct widget **widgetv; // WEAK
+  int c,a;
+  struct widget *root; // WEAK. Which tree we reflect; we rebuild if the active one changes.
+  int dirty;
+};
+
+#define GUI_SCALE_LIMIT 8 /* delegate.ui_scale */
+
 struct gui_context {
   struct gui_delegate delegate;
   volatile int terminate; // Per WM or client request.
@@ -25,6 +44,9 @@ struct gui_context {
   struct widget *root;
   int render_soon;
   int tree_changed; // Widgets set nonzero any time a widget is added, removed, or order changed.
+  int pack_depth; // widget_pack() refreshes transforms when the outermost call completes.
+  int focus; // Window focus, per WM. Starts true.
+  int visible; // Window visibility, per WM. Starts true. We don't render while false.
   double double_click_interval; // s
   
   // First in the list is our default.
@@ -39,8 +61,9 @@ struct gui_context {
   struct widget **modalv; // STRONG
   int modalc,modala;
   
-  // Focus ring.
-  struct widget **focusv; // STRONG
+  // Focus ring: Every focusable widget under the root or top modal, in tree order.
+  // Maintained incrementally as children are added and removed. See gui_focus.c.
+  struct widget **focusv; // WEAK
   int focusc,focusa,focusp;
   
   uint8_t modifiers;
@@ -60,13 +83,74 @@ struct gui_context {
   } *deferredv;
   int deferredc,deferreda;
   int taskid_next;
+  
+  // Idle jobs, see gui_idle.c. They share (taskid_next) with deferred tasks.
+  struct idle_job {
+    int taskid;
+    struct widget *widget; // STRONG
+    int (*cb)(struct widget *widget,void *userdata);
+    void (*cb_cleanup)(struct widget *widget,void *userdata);
+    void *userdata;
+  } *idlev;
+  int idlec,idlea,idlep;
+  double idle_deadline; // Real time, only valid during gui_run_idle.
+  
+  // Tasks posted from other threads. See gui_post.c.
+  struct gui_post *posthead;
+  int wakefd[2]; // Pipe. Readable when something was posted. (-1,-1) if pipe() failed; posts still work, just not wake.
+  
+  struct pool *pool; // Created on first use.
+  
+  struct gui_mirror mirror;
+  
+  struct gui_slab *slab; // STRONG. Widget allocator, see gui_slab.c.
 };
 
 extern struct gui_context *gui_global_context;
 
 // If the current focus remains in the ring, it will remain focussed.
 // Otherwise we blur the current and focus the first thing in the ring (or nothing, if the ring is empty).
+// Walks the whole tree; only necessary when the root or top modal changes.
 void gui_rebuild_focus_ring(struct gui_context *ctx);
+void gui_focus_default(struct gui_context *ctx);
+
+// widget.c calls these. (removing) must be called while (child) is still attached.
+void gui_focus_child_added(struct gui_context *ctx,struct widget *child);
+void gui_focus_child_removing(struct gui_context *ctx,struct widget *child);
+struct widget *gui_focus_child_moving(struct gui_context *ctx,struct widget *child); // => WEAK focus if it's in (child), for moved.
+void gui_focus_child_moved(struct gui_context *ctx,struct widget *child,struct widget *focus);
+void gui_focus_focusable_changed(struct gui_context *ctx,struct widget *widget);
+
+int gui_post_init(struct gui_context *ctx);
+int gui_post_update(struct gui_context *ctx); // Run anything posted. UI thread only.
+void gui_post_cleanup(struct gui_context *ctx); // Call cleanups without running, and close the pipe.
+
+int gui_idle_cancel(struct gui_context *ctx,int taskid);
+int gui_idle_set_cleanup(struct gui_context *ctx,int taskid,void (*cb_cleanup)(struct widget *widget,void *userdata));
+void gui_idle_cleanup(struct gui_context *ctx);
+
+void gui_mirror_cleanup(struct gui_mirror *mirror);
+void gui_mirror_patch(struct gui_mirror *mirror,struct widget *widget); // After its transform or flags changed.
+struct widget *gui_mirror_hit(struct gui_context *ctx,int x,int y,uint8_t flag); // Innermost widget at (x,y) with (flag), in the active tree.
+
+/* The slab belongs to the context, but lives until its last object is freed too.
+ * gui_slab_release drops the context's hold, and frees it only if nothing is allocated.
+ */
+struct gui_slab *gui_slab_new();
+void gui_slab_release(struct gui_slab *slab);
+void *gui_slab_alloc(struct gui_slab *slab,int size);
+void gui_slab_free(struct gui_slab *slab,void *obj,int size);
+
+/* Fonts compiled into the program, generated at build time by src/tool/mkfont.
+ * gui_get_named_font checks these before going to the filesystem.
+ */
+struct gui_embedded_font {
+  const char *name;
+  int w,h,stride; // Whole image. (w,h) are multiples of (16,7).
+  const void *a1;
+};
+extern const struct gui_embedded_font gui_embedded_fontv[];
+extern const int gui_embedded_fontc;
 
 void gui_cb_close();
 void gui_cb_resize(int w,int h);
@@ -76,5 +160,6 @@ void gui_cb_key(int keycode,int value,int codepoint);
 void gui_cb_mmotion(int x,int y);
 void gui_cb_mbutton(int btnid,int value);
 void gui_cb_mwheel(int dx,int dy);
+void gui_cb_visibility(int visible);
 
 #endif
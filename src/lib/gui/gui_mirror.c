@@ -0,0 +1,148 @@
+/* gui_mirror.c
+ * Packed copy of the active tree's geometry, for hit-testing.
+ * Widgets are listed in preorder, each with the index just past its subtree, so a miss skips the whole subtree without touching it.
+ * Structural changes mark it dirty and we rebuild on demand. Pack and scroll patch the bounds in place.
+ */
+
+#include "gui_internal.h"
+
+/* Cleanup.
+ */
+
+void gui_mirror_cleanup(struct gui_mirror *mirror) {
+  if (mirror->xv) free(mirror->xv);
+  if (mirror->yv) free(mirror->yv);
+  if (mirror->wv) free(mirror->wv);
+  if (mirror->hv) free(mirror->hv);
+  if (mirror->endv) free(mirror->endv);
+  if (mirror->parentv) free(mirror->parentv);
+  if (mirror->flagv) free(mirror->flagv);
+  if (mirror->widgetv) free(mirror->widgetv);
+  memset(mirror,0,sizeof(struct gui_mirror));
+}
+
+/* Grow.
+ */
+
+static int gui_mirror_require(struct gui_mirror *mirror,int c) {
+  if (c<=mirror->a) return 0;
+  int na=(c+256)&~255;
+  if (na>INT_MAX/sizeof(void*)) return -1;
+  #define _(name,type) { \
+    void *nv=realloc(mirror->name,sizeof(type)*na); \
+    if (!nv) return -1; \
+    mirror->name=nv; \
+  }
+  _(xv,int)
+  _(yv,int)
+  _(wv,int)
+  _(hv,int)
+  _(endv,int)
+  _(parentv,int)
+  _(flagv,uint8_t)
+  _(widgetv,void*)
+  #undef _
+  mirror->a=na;
+  return 0;
+}
+
+/* Rebuild.
+ */
+
+static uint8_t gui_mirror_flags(const struct widget *widget) {
+  uint8_t flags=0;
+  if (widget->clickable) flags|=GUI_MIRROR_CLICKABLE;
+  if (widget->rawmouse) flags|=GUI_MIRROR_RAWMOUSE;
+  if (widget->proxyto) flags|=GUI_MIRROR_PROXY;
+  return flags;
+}
+
+static int gui_mirror_count(const struct widget *widget) {
+  int c=1,i=widget->childc;
+  while (i-->0) c+=gui_mirror_count(widget->childv[i]);
+  return c;
+}
+
+static int gui_mirror_add(struct gui_mirror *mirror,struct widget *widget,int parentp) {
+  int p=mirror->c++;
+  mirror->xv[p]=widget->absx;
+  mirror->yv[p]=widget->absy;
+  mirror->wv[p]=widget->w;
+  mirror->hv[p]=widget->h;
+  mirror->parentv[p]=parentp;
+  mirror->flagv[p]=gui_mirror_flags(widget);
+  mirror->widgetv[p]=widget;
+  widget->mirrorp=p;
+  int i=0;
+  for (;i<widget->childc;i++) gui_mirror_add(mirror,widget->childv[i],p);
+  mirror->endv[p]=mirror->c;
+  return 0;
+}
+
+static int gui_mirror_rebuild(struct gui_mirror *mirror,struct widget *root) {
+  mirror->c=0;
+  mirror->root=root;
+  mirror->dirty=0;
+  if (!root) return 0;
+  if (gui_mirror_require(mirror,gui_mirror_count(root))<0) {
+    mirror->dirty=1;
+    return -1;
+  }
+  return gui_mirror_add(mirror,root,-1);
+}
+
+/* Patch one widget after its transform changed.
+ */
+
+void gui_mirror_patch(struct gui_mirror *mirror,struct widget *widget) {
+  if (mirror->dirty) return;
+  int p=widget->mirrorp;
+  if ((p<0)||(p>=mirror->c)||(mirror->widgetv[p]!=widget)) return;
+  mirror->xv[p]=widget->absx;
+  mirror->yv[p]=widget->absy;
+  mirror->wv[p]=widget->w;
+  mirror->hv[p]=widget->h;
+  mirror->flagv[p]=gui_mirror_flags(widget);
+}
+
+/* Hit test.
+ * Same result the old recursive search gave: The first qualifying widget in postorder, among subtrees containing the point.
+ * In preorder terms: A later hit replaces (best) only if it's inside (best)'s subtree, and once we're past that subtree, we're done.
+ */
+
+static int gui_mirror_qualifies(const struct gui_mirror *mirror,int p,uint8_t flag) {
+  if (mirror->flagv[p]&GUI_MIRROR_PROXY) {
+    // Proxies are rare. Check the live target rather than trying to mirror its state too.
+    const struct widget *target=mirror->widgetv[p]->proxyto;
+    if (!target||!target->parent) return 0;
+    if (flag==GUI_MIRROR_CLICKABLE) return target->clickable;
+    return target->rawmouse;
+  }
+  return (mirror->flagv[p]&flag)?1:0;
+}
+
+struct widget *gui_mirror_hit(struct gui_context *ctx,int x,int y,uint8_t flag) {
+  struct gui_mirror *mirror=&ctx->mirror;
+  struct widget *root=ctx->root;
+  if (ctx->modalc>0) root=ctx->modalv[ctx->modalc-1];
+  if (mirror->dirty||(mirror->root!=root)) {
+    if (gui_mirror_rebuild(mirror,root)<0) return 0;
+  }
+  const int *xv=mirror->xv,*yv=mirror->yv,*wv=mirror->wv,*hv=mirror->hv,*endv=mirror->endv;
+  int best=-1,limit=mirror->c;
+  int p=0;
+  while (p<limit) {
+    int dx=x-xv[p],dy=y-yv[p];
+    if ((dx<0)||(dy<0)||(dx>=wv[p])||(dy>=hv[p])) {
+      p=endv[p];
+      continue;
+    }
+    if (gui_mirror_qualifies(mirror,p,flag)) {
+      best=p;
+      limit=endv[p];
+    }
+    p++;
+  }
+  if (best<0) return 0;
+  return mirror->widgetv[best];
+}
@@ -0,0 +1,230 @@
+/* gui_post.c
+ * Tasks posted from other threads.
+ * Producers push onto a lock-free stack. The UI thread takes the whole stack at once, reverses it, and runs in order.
+ * When a push finds the stack empty, it writes a byte to our pipe, which wakes gui_clock_tick.
+ */
+
+#include "gui_internal.h"
+#include <fcntl.h>
+#include <errno.h>
+
+struct gui_post {
+  struct gui_post *next;
+  struct widget *widget; // STRONG, handed off by the poster.
+  void (*cb)(struct widget *widget,void *userdata);
+  void (*cb_cleanup)(struct widget *widget,void *userdata);
+  void *userdata;
+};
+
+/* Open the pipe.
+ */
+
+int gui_post_init(struct gui_context *ctx) {
+  ctx->wakefd[0]=ctx->wakefd[1]=-1;
+  if (pipe(ctx->wakefd)<0) {
+    ctx->wakefd[0]=ctx->wakefd[1]=-1;
+    return -1;
+  }
+  int i=2; while (i-->0) {
+    fcntl(ctx->wakefd[i],F_SETFL,fcntl(ctx->wakefd[i],F_GETFL)|O_NONBLOCK);
+    fcntl(ctx->wakefd[i],F_SETFD,FD_CLOEXEC);
+  }
+  return 0;
+}
+
+/* Take everything from the queue, oldest first.
+ */
+
+static struct gui_post *gui_post_take_all(struct gui_context *ctx) {
+  struct gui_post *lifo=__atomic_exchange_n(&ctx->posthead,0,__ATOMIC_ACQUIRE);
+  struct gui_post *fifo=0;
+  while (lifo) {
+    struct gui_post *next=lifo->next;
+    lifo->next=fifo;
+    fifo=lifo;
+    lifo=next;
+  }
+  return fifo;
+}
+
+/* Drain the wake pipe.
+ * Must happen before taking the queue: A push that lands between the two then leaves a spare byte, not a lost one.
+ */
+
+static void gui_post_drain_pipe(struct gui_context *ctx) {
+  if (ctx->wakefd[0]<0) return;
+  char tmp[64];
+  while (read(ctx->wakefd[0],tmp,sizeof(tmp))>0) ;
+}
+
+/* Run posted tasks, on the UI thread.
+ * Drain even when the queue looks empty: A producer writes its byte after its post lands, so we may have taken the post already.
+ * Left in the pipe, that byte would wake every later tick immediately.
+ */
+
+int gui_post_update(struct gui_context *ctx) {
+  gui_post_drain_pipe(ctx);
+  if (!__atomic_load_n(&ctx->posthead,__ATOMIC_RELAXED)) return 0;
+  struct gui_post *post=gui_post_take_all(ctx);
+  while (post) {
+    struct gui_post *next=post->next;
+    post->cb(post->widget,post->userdata);
+    if (post->cb_cleanup) post->cb_cleanup(post->widget,post->userdata);
+    widget_del(post->widget);
+    free(post);
+    post=next;
+  }
+  return 0;
+}
+
+/* Cleanup at context deletion. Call only the cleanups.
+ */
+
+void gui_post_cleanup(struct gui_context *ctx) {
+  struct gui_post *post=gui_post_take_all(ctx);
+  while (post) {
+    struct gui_post *next=post->next;
+    if (post->cb_cleanup) post->cb_cleanup(post->widget,post->userdata);
+    widget_del(post->widget);
+    free(post);
+    post=next;
+  }
+  if (ctx->wakefd[0]>=0) close(ctx->wakefd[0]);
+  if (ctx->wakefd[1]>=0) close(ctx->wakefd[1]);
+  ctx->wakefd[0]=ctx->wakefd[1]=-1;
+}
+
+/* Push a filled-in post, from any thread.
+ * Once the exchange succeeds, (post) belongs to the UI thread and may already be gone. Only look at (head) after.
+ */
+
+static void gui_post_push(struct gui_context *ctx,struct gui_post *post) {
+  struct gui_post *head=__atomic_load_n(&ctx->posthead,__ATOMIC_RELAXED);
+  do {
+    post->next=head;
+  } while (!__atomic_compare_exchange_n(&ctx->posthead,&head,post,1,__ATOMIC_RELEASE,__ATOMIC_RELAXED));
+
+  // Only the push that made the queue nonempty needs to wake anyone.
+  if (!head&&(ctx->wakefd[1]>=0)) {
+    char dummy=0;
+    while ((write(ctx->wakefd[1],&dummy,1)<0)&&(errno==EINTR)) ;
+  }
+}
+
+/* Post, from any thread.
+ */
+
+int gui_post_from_thread(
+  struct gui_context *ctx,
+  struct widget *widget,
+  void (*cb)(struct widget *widget,void *userdata),
+  void (*cb_cleanup)(struct widget *widget,void *userdata),
+  void *userdata
+) {
+  if (!ctx||!cb) return -1;
+  struct gui_post *post=malloc(sizeof(struct gui_post));
+  if (!post) return -1;
+  post->widget=widget;
+  post->cb=cb;
+  post->cb_cleanup=cb_cleanup;
+  post->userdata=userdata;
+  gui_post_push(ctx,post);
+  return 0;
+}
+
+/* Background jobs on the shared pool.
+ * The pool reports completion on a worker thread, and we forward it to the UI thread as a post.
+ * That post is allocated when the job starts, so completion can't fail.
+ */
+
+struct gui_background {
+  struct gui_context *ctx; // WEAK
+  struct widget *widget; // STRONG, handed off to (post) at completion.
+  struct gui_post *post; // STRONG until completion, then the UI thread owns it.
+  int (*cb)(void *userdata);
+  void (*cb_done)(struct widget *widget,int jobid,int status,void *userdata);
+  void *userdata;
+  int jobid;
+  int status;
+  int delivered;
+};
+
+static int gui_background_cb(void *userdata) {
+  struct gui_background *bg=userdata;
+  return bg->cb(bg->userdata);
+}
+
+static void gui_background_cb_deliver(struct widget *widget,void *userdata) {
+  struct gui_background *bg=userdata;
+  bg->delivered=1;
+  if (bg->cb_done) bg->cb_done(widget,bg->jobid,bg->status,bg->userdata);
+}
+
+static void gui_background_cb_cleanup(struct widget *widget,void *userdata) {
+  struct gui_background *bg=userdata;
+  // Context is being deleted before we got to run. Still report, as cancelled, so the client can free things.
+  if (!bg->delivered&&bg->cb_done) bg->cb_done(widget,bg->jobid,POOL_CANCELLED,bg->userdata);
+  free(bg);
+}
+
+static void gui_background_cb_done(int jobid,int status,void *userdata) {
+  struct gui_background *bg=userdata;
+  bg->jobid=jobid;
+  bg->status=status;
+  struct gui_post *post=bg->post;
+  bg->post=0;
+  post->widget=bg->widget;
+  post->cb=gui_background_cb_deliver;
+  post->cb_cleanup=gui_background_cb_cleanup;
+  post->userdata=bg;
+  gui_post_push(bg->ctx,post);
+}
+
+struct pool *gui_get_pool(struct gui_context *ctx) {
+  if (!ctx) return 0;
+  if (!ctx->pool) {
+    if (!(ctx->pool=pool_new(ctx->delegate.worker_count))) return 0;
+  }
+  return ctx->pool;
+}
+
+int gui_run_in_background(
+  struct gui_context *ctx,
+  struct widget *widget,
+  int (*cb)(void *userdata),
+  void (*cb_done)(struct widget *widget,int jobid,int status,void *userdata),
+  void *userdata
+) {
+  if (!cb) return -1;
+  struct pool *pool=gui_get_pool(ctx);
+  if (!pool) return -1;
+  struct gui_background *bg=calloc(1,sizeof(struct gui_background));
+  if (!bg) return -1;
+  if (!(bg->post=malloc(sizeof(struct gui_post)))) {
+    free(bg);
+    return -1;
+  }
+  if (widget&&(widget_ref(widget)<0)) {
+    free(bg->post);
+    free(bg);
+    return -1;
+  }
+  bg->ctx=ctx;
+  bg->widget=widget;
+  bg->cb=cb;
+  bg->cb_done=cb_done;
+  bg->userdata=userdata;
+  int jobid=pool_submit(pool,gui_background_cb,gui_background_cb_done,bg);
+  if (jobid<0) {
+    widget_del(widget);
+    free(bg->post);
+    free(bg);
+    return -1;
+  }
+  return jobid;
+}
+
+void gui_cancel_background(struct gui_context *ctx,int jobid) {
+  if (!ctx||!ctx->pool) return;
+  pool_cancel(ctx->pool,jobid);
+}
@@ -0,0 +1,120 @@
+/* gui_slab.c
+ * Small-object allocator for widgets.
+ * Objects are rounded up to a power-of-two size class, and each class keeps a free list threaded through its empty slots.
+ * Slots come from chunks that we never return to the system until the slab dies.
+ * Widgets churn a lot (menus, dialogs), and this keeps them from scattering across the heap.
+ * Anything bigger than our largest class goes straight to calloc.
+ *
+ * A client may hold a widget past gui_context_del, so the slab isn't part of the context.
+ * Each widget points to its slab, which counts what's allocated, and outlives the context until that count reaches zero.
+ */
+
+#include "gui_internal.h"
+
+#define GUI_SLAB_CHUNK_SIZE 8192
+#define GUI_SLAB_MIN_SHIFT 6 /* Smallest class is 64 bytes... */
+#define GUI_SLAB_CLASS_COUNT 5 /* ...and largest 1024. */
+
+struct gui_slab_chunk {
+  struct gui_slab_chunk *next;
+  double align; // Forces the header to a 16-byte multiple on every platform I care about.
+};
+
+struct gui_slab {
+  struct gui_slab_class {
+    void *free; // Next free slot; each free slot begins with a pointer to the next.
+    struct gui_slab_chunk *chunks;
+  } classv[GUI_SLAB_CLASS_COUNT];
+  int livec; // Slots allocated and not yet freed.
+  int released; // The context is gone. Whoever frees the last slot, frees the slab.
+};
+
+/* Delete, unconditionally.
+ */
+
+static void gui_slab_del(struct gui_slab *slab) {
+  int i=GUI_SLAB_CLASS_COUNT;
+  while (i-->0) {
+    struct gui_slab_class *class=slab->classv+i;
+    while (class->chunks) {
+      struct gui_slab_chunk *chunk=class->chunks;
+      class->chunks=chunk->next;
+      free(chunk);
+    }
+  }
+  free(slab);
+}
+
+/* New and release.
+ */
+
+struct gui_slab *gui_slab_new() {
+  return calloc(1,sizeof(struct gui_slab));
+}
+
+void gui_slab_release(struct gui_slab *slab) {
+  if (!slab) return;
+  if (slab->livec>0) slab->released=1;
+  else gui_slab_del(slab);
+}
+
+/* Size class for an object size, or -1 if too big.
+ */
+
+static int gui_slab_class(int size) {
+  int classp=0,classsize=1<<GUI_SLAB_MIN_SHIFT;
+  while (classp<GUI_SLAB_CLASS_COUNT) {
+    if (size<=classsize) return classp;
+    classp++;
+    classsize<<=1;
+  }
+  return -1;
+}
+
+/* Allocate, zeroed.
+ */
+
+void *gui_slab_alloc(struct gui_slab *slab,int size) {
+  if (size<1) return 0;
+  int classp=gui_slab_class(size);
+  if (classp<0) return calloc(1,size);
+  if (!slab||(slab->livec>=INT_MAX)) return 0;
+  struct gui_slab_class *class=slab->classv+classp;
+  int classsize=1<<(GUI_SLAB_MIN_SHIFT+classp);
+  if (!class->free) {
+    int objc=(GUI_SLAB_CHUNK_SIZE-sizeof(struct gui_slab_chunk))/classsize;
+    if (objc<1) objc=1;
+    struct gui_slab_chunk *chunk=malloc(sizeof(struct gui_slab_chunk)+objc*classsize);
+    if (!chunk) return 0;
+    chunk->next=class->chunks;
+    class->chunks=chunk;
+    // Thread the new slots in address order, it's a little friendlier to the cache.
+    char *slot=(char*)(chunk+1)+(objc-1)*classsize;
+    while (objc-->0) {
+      *(void**)slot=class->free;
+      class->free=slot;
+      slot-=classsize;
+    }
+  }
+  void *obj=class->free;
+  class->free=*(void**)obj;
+  memset(obj,0,classsize);
+  slab->livec++;
+  return obj;
+}
+
+/* Free. (size) must be what you allocated with.
+ */
+
+void gui_slab_free(struct gui_slab *slab,void *obj,int size) {
+  if (!obj) return;
+  int classp=gui_slab_class(size);
+  if (classp<0) {
+    free(obj);
+    return;
+  }
+  struct gui_slab_class *class=slab->classv+classp;
+  *(void**)obj=class->free;
+  class->free=obj;
+  if ((--(slab->livec)<=0)&&slab->released) gui_slab_del(slab);
+}
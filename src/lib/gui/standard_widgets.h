@@ -78,7 +78,7 @@ extern const struct widget_type widget_type_separator;
 
 struct widget_args_separator {
   char orient; // 'x' or 'y'
-  int size; // Initial width or height of the left or top half, in pixels. Ignored if zero.
+  int size; // Initial width or height of the left or top half, in 1x pixels (see gui_scale). Ignored if zero.
   int pct; // (size) but a percentage. Ignored if zero.
 };
 
@@ -134,7 +134,7 @@ struct widget_args_packer {
   int reverse; // Left-to-right or top-to-bottom by default; nonzero here to reverse it.
   int majoralign; // (-2,-1,0,1) = fill, left/top, center, right/bottom
   int minoralign; // Alignments are not affected by (reverse).
-  int spacing; // Pixels between children along the major axis.
+  int spacing; // Pixels between children along the major axis, at 1x. We apply the UI scale.
 };
 
 /* Mark a specific child as accepting (>0) or rejecting (<0) excess space, when using (majoralign==-2).
@@ -215,15 +215,155 @@ int widget_field_delete(struct widget *widget);
 int widget_field_backspace(struct widget *widget);
 int widget_field_insert_codepoint(struct widget *widget,int codepoint);
 
+/* Every edit above is recorded for undo, with runs of typing merged into one step. Ctrl+Z and Ctrl+Y or Shift+Ctrl+Z.
+ * Setting the text clears the history.
+ */
+int widget_field_undo(struct widget *widget);
+int widget_field_redo(struct widget *widget);
+
 /* textedit: Edit text with scrolling.
+ * The text lives in a doc (lib/doc/doc.h), which can be huge. We only look at the lines in view.
+ * Positions are byte offsets in the doc, 64-bit.
  ********************************************************************************/
  
 extern const struct widget_type widget_type_textedit;
 
+struct doc;
+
 struct widget_args_textedit {
-  int TODO;
+  struct doc *doc; // We retain it. Null to start with an empty one.
+  struct font *font;
+  void *userdata;
+  int wrap; // Nonzero to break long lines at our width instead of scrolling horizontally.
+  
+  // Called after every change made through the widget: (rmc) bytes at (p) were replaced by (addc).
+  void (*cb_postedit)(struct widget *widget,int64_t p,int64_t rmc,int64_t addc);
+};
+
+/* Change the doc only through the widget, or set it again after changing it yourself.
+ * The widget has no idea otherwise, and will show stale lines.
+ */
+struct doc *widget_textedit_get_doc(const struct widget *widget); // WEAK
+int widget_textedit_set_doc(struct widget *widget,struct doc *doc);
+int widget_textedit_set_font(struct widget *widget,struct font *font);
+int widget_textedit_get_wrap(const struct widget *widget);
+int widget_textedit_set_wrap(struct widget *widget,int wrap); // Fails, or turns itself off later, if the doc has more than INT_MAX lines.
+void *widget_textedit_get_userdata(const struct widget *widget);
+int widget_textedit_set_userdata(struct widget *widget,void *userdata);
+int64_t widget_textedit_get_selection(int64_t *p,const struct widget *widget); // => c
+int widget_textedit_set_selection(struct widget *widget,int64_t p,int64_t c); // (c<0) to extend to the end. Scrolls into view.
+int widget_textedit_select_word(struct widget *widget,int64_t p);
+
+/* Editing operations, same idea as field's.
+ * move_cursor is by codepoints (dx) and rows (dy), which are lines unless wrapping. move_to_edge is -1,1 for the line's start or end, -2,2 for the document's.
+ * replace is the general case, and the others all come through it.
+ */
+int widget_textedit_move_cursor(struct widget *widget,int dx,int dy);
+int widget_textedit_move_to_edge(struct widget *widget,int d);
+int widget_textedit_delete(struct widget *widget);
+int widget_textedit_backspace(struct widget *widget);
+int widget_textedit_insert_codepoint(struct widget *widget,int codepoint);
+int widget_textedit_replace(struct widget *widget,int64_t p,int64_t c,const char *src,int srcc);
+
+/* Undo and redo, same as field's. History is bounded at (limit) bytes, dropping the oldest edits. Zero for a default.
+ */
+int widget_textedit_undo(struct widget *widget);
+int widget_textedit_redo(struct widget *widget);
+int widget_textedit_set_undo_limit(struct widget *widget,int64_t limit);
+
+/* list: Scrollable column of rows, drawn on demand by a data source.
+ * Rows are not widgets. We only ever measure and render the visible ones, so a million rows is fine.
+ * Row heights are either fixed (rowh) or measured once per row at reload and indexed for O(log n) lookup.
+ *******************************************************************************/
+
+extern const struct widget_type widget_type_list;
+
+struct widget_args_list {
+  int rowh; // Fixed height of every row. Zero for variable height, then (cb_measure) is required.
+  void *userdata;
+  int (*cb_count)(struct widget *widget,void *userdata); // REQUIRED
+  int (*cb_measure)(struct widget *widget,int row,void *userdata); // => height in pixels.
+
+  // REQUIRED. (dst) is the row's bounds, render yourself at (0,0) in it. Highlight for selection is already drawn.
+  void (*cb_render)(struct widget *widget,struct image *dst,int row,int selected,void *userdata);
+
+  void (*cb_select)(struct widget *widget,int row,void *userdata); // Selection changed by the user. (row) may be -1.
+  void (*cb_activate)(struct widget *widget,int row,void *userdata); // Enter or double-click.
 };
 
+void *widget_list_get_userdata(const struct widget *widget);
+
+/* Call reload when the row count changes, or everything changes. For variable heights, this measures every row.
+ * If just one row changed, row_changed is much cheaper.
+ */
+int widget_list_reload(struct widget *widget);
+int widget_list_row_changed(struct widget *widget,int row);
+
+int widget_list_count_rows(const struct widget *widget);
+int widget_list_get_selection(const struct widget *widget); // -1 if none
+int widget_list_set_selection(struct widget *widget,int row); // Scrolls it into view too. (row<0) to select nothing.
+int widget_list_scroll_to(struct widget *widget,int row);
+int widget_list_row_at(const struct widget *widget,int y); // (y) in widget's local space. -1 if no row there.
+
+/* tree: Expandable hierarchy of text rows.
+ * Nodes are not widgets. Children are requested from you the first time a node expands, not before.
+ * Only the visible rows are tracked, and expand/collapse touch only the affected rows.
+ *******************************************************************************/
+
+extern const struct widget_type widget_type_tree;
+
+struct widget_tree_node;
+
+struct widget_args_tree {
+  struct font *font;
+  void *userdata;
+
+  // Called once per node, the first time it expands. Add its children with widget_tree_add_node(widget,node,...).
+  // It's fine to add no children; the node then shows no expander.
+  int (*cb_expand)(struct widget *widget,struct widget_tree_node *node,void *userdata);
+
+  void (*cb_select)(struct widget *widget,struct widget_tree_node *node,void *userdata); // (node) may be null.
+  void (*cb_activate)(struct widget *widget,struct widget_tree_node *node,void *userdata); // Enter or double-click. Default toggles expansion.
+};
+
+/* Add a node as the last child of (parent), or at the top level if null.
+ * (expandable) nonzero if it might have children; we'll call cb_expand for it when the user asks.
+ * Returns WEAK node, which lives as long as the widget.
+ */
+struct widget_tree_node *widget_tree_add_node(
+  struct widget *widget,
+  struct widget_tree_node *parent,
+  const char *label,int labelc,
+  int expandable,
+  void *userdata
+);
+
+/* Sort children of (node), or the top level if null: Expandable first, then by label.
+ * Only while it's collapsed, eg at the end of cb_expand.
+ */
+int widget_tree_sort_children(struct widget *widget,struct widget_tree_node *node);
+
+int widget_tree_expand(struct widget *widget,struct widget_tree_node *node,int expand); // Expanding also expands ancestors.
+
+void *widget_tree_get_userdata(const struct widget *widget);
+struct widget_tree_node *widget_tree_get_selection(const struct widget *widget);
+int widget_tree_count_rows(const struct widget *widget); // Visible rows only.
+
+struct widget_tree_node *widget_tree_node_get_parent(const struct widget_tree_node *node);
+int widget_tree_node_get_label(void *dstpp,const struct widget_tree_node *node);
+void *widget_tree_node_get_userdata(const struct widget_tree_node *node);
+int widget_tree_node_count_children(const struct widget_tree_node *node); // Zero until loaded.
+struct widget_tree_node *widget_tree_node_get_child(const struct widget_tree_node *node,int p);
+
+/* With the fs unit, a tree can browse the filesystem.
+ * Add a top-level node whose label is a directory path, and use widget_tree_expand_directory as (cb_expand).
+ * Node paths are their ancestors' labels joined.
+ */
+#if USE_fs
+int widget_tree_node_get_path(char *dst,int dsta,const struct widget_tree_node *node);
+int widget_tree_expand_directory(struct widget *widget,struct widget_tree_node *node,void *userdata);
+#endif
+
 /* checkbox: Button with togglable state.
  * Should this include a text label? For now I'm sayng no.
  ************************************************************************/
@@ -21,10 +21,10 @@ void widget_del(struct widget *widget) {
       child->parentuse=0;
       widget_del(child);
     }
-    free(widget->childv);
+    if (widget->childv!=widget->childv_inline) free(widget->childv);
   }
   if (widget->type->del) widget->type->del(widget);
-  free(widget);
+  gui_slab_free(widget->slab,widget,widget->type->objlen);
 }
 
 /* Retain.
@@ -46,8 +46,10 @@ struct widget *widget_new(
   const void *args,int argslen
 ) {
   if (!ctx||!type) return 0;
-  struct widget *widget=calloc(1,type->objlen);
+  if (type->objlen<(int)sizeof(struct widget)) return 0;
+  struct widget *widget=gui_slab_alloc(ctx->slab,type->objlen);
   if (!widget) return 0;
+  widget->slab=ctx->slab;
   widget->refc=1;
   widget->type=type;
   widget->ctx=ctx;
@@ -91,21 +93,32 @@ int widget_childv_insert(struct widget *parent,int p,struct widget *child) {
     if (p>pvp) p--; // Rephrase (p) to be the index after removal.
     if (p==pvp) return 0; // Two possible redundant positions.
     // It copies more than necessary, but to keep things neat, do a full remove then a full insert:
+    struct widget *focus=gui_focus_child_moving(parent->ctx,child);
     memmove(parent->childv+pvp,parent->childv+pvp+1,sizeof(void*)*(parent->childc-1-pvp));
     memmove(parent->childv+p+1,parent->childv+p,sizeof(void*)*(parent->childc-1-p));
     parent->childv[p]=child;
+    gui_focus_child_moved(parent->ctx,child,focus);
     parent->ctx->tree_changed=1;
+    parent->ctx->mirror.dirty=1;
     return 0;
   }
   
   // If (child) already has a parent, it's an error. Do not remove from the existing, caller must do that manually.
   if (child->parent) return -1;
   
-  if (parent->childc>=parent->childa) {
+  if (!parent->childv) {
+    parent->childv=parent->childv_inline;
+    parent->childa=WIDGET_CHILDV_INLINE;
+  } else if (parent->childc>=parent->childa) {
     int na=parent->childa+8;
     if (na>INT_MAX/sizeof(void*)) return -1;
-    void *nv=realloc(parent->childv,sizeof(void*)*na);
-    if (!nv) return -1;
+    void *nv;
+    if (parent->childv==parent->childv_inline) {
+      if (!(nv=malloc(sizeof(void*)*na))) return -1;
+      memcpy(nv,parent->childv,sizeof(void*)*parent->childc);
+    } else {
+      if (!(nv=realloc(parent->childv,sizeof(void*)*na))) return -1;
+    }
     parent->childv=nv;
     parent->childa=na;
   }
@@ -115,7 +128,10 @@ int widget_childv_insert(struct widget *parent,int p,struct widget *child) {
   parent->childc++;
   child->parent=parent;
   child->parentuse=0;
+  widget_refresh_transform(child);
+  gui_focus_child_added(parent->ctx,child);
   parent->ctx->tree_changed=1;
+  parent->ctx->mirror.dirty=1;
   return 0;
 }
 
@@ -129,12 +145,14 @@ int widget_childv_remove(struct widget *parent,struct widget *child) {
 int widget_childv_remove_at(struct widget *parent,int p) {
   if (!parent||(p<0)||(p>=parent->childc)) return -1;
   struct widget *child=parent->childv[p];
+  gui_focus_child_removing(parent->ctx,child);
   parent->childc--;
   memmove(parent->childv+p,parent->childv+p+1,sizeof(void*)*(parent->childc-p));
   child->parent=0;
   child->parentuse=0;
   widget_del(child);
   parent->ctx->tree_changed=1;
+  parent->ctx->mirror.dirty=1;
   return 0;
 }
 
@@ -158,6 +176,19 @@ int widget_is_ancestor(const struct widget *ancestor,const struct widget *descen
     if (ancestor==descendant) return 1;
     descendant=descendant->parent;
   }
+  return 0;
+}
+
+/* Change focusability.
+ */
+ 
+int widget_set_focusable(struct widget *widget,int focusable) {
+  if (!widget) return -1;
+  focusable=focusable?1:0;
+  if (focusable==widget->focusable) return 0;
+  widget->focusable=focusable;
+  gui_focus_focusable_changed(widget->ctx,widget);
+  return 0;
 }
 
 /* Get root.
@@ -169,49 +200,90 @@ struct widget *widget_get_root(struct widget *widget) {
   return widget;
 }
 
+/* Refresh cached transform.
+ */
+ 
+static void widget_refresh_transform_1(struct widget *widget) {
+  const struct widget *parent=widget->parent;
+  int cx,cy,cw,ch;
+  if (parent) {
+    widget->absx=parent->absx-parent->scrollx+widget->x;
+    widget->absy=parent->absy-parent->scrolly+widget->y;
+    cx=parent->clipx;
+    cy=parent->clipy;
+    cw=parent->clipw;
+    ch=parent->cliph;
+  } else {
+    widget->absx=widget->x;
+    widget->absy=widget->y;
+    cx=widget->absx;
+    cy=widget->absy;
+    cw=widget->w;
+    ch=widget->h;
+  }
+  // Intersect my bounds with the parent's clip.
+  int l=widget->absx,t=widget->absy,r=widget->absx+widget->w,b=widget->absy+widget->h;
+  if (l<cx) l=cx;
+  if (t<cy) t=cy;
+  if (r>cx+cw) r=cx+cw;
+  if (b>cy+ch) b=cy+ch;
+  widget->clipx=l;
+  widget->clipy=t;
+  widget->clipw=(r>l)?(r-l):0;
+  widget->cliph=(b>t)?(b-t):0;
+  gui_mirror_patch(&widget->ctx->mirror,widget);
+  struct widget **childp=widget->childv;
+  int i=widget->childc;
+  for (;i-->0;childp++) widget_refresh_transform_1(*childp);
+}
+
+void widget_refresh_transform(struct widget *widget) {
+  if (!widget) return;
+  widget_refresh_transform_1(widget);
+}
+
+/* Set scroll.
+ */
+ 
+void widget_set_scroll(struct widget *widget,int x,int y) {
+  if (!widget) return;
+  if ((x==widget->scrollx)&&(y==widget->scrolly)) return;
+  widget->scrollx=x;
+  widget->scrolly=y;
+  struct widget **childp=widget->childv;
+  int i=widget->childc;
+  for (;i-->0;childp++) widget_refresh_transform_1(*childp);
+}
+
 /* Transform coords.
  */
 
 void widget_coords_global_from_local(int *x,int *y,const struct widget *widget) {
   if (!widget) return;
-  do {
-    (*x)+=widget->x-widget->scrollx;
-    (*y)+=widget->y-widget->scrolly;
-  } while (widget=widget->parent);
+  (*x)+=widget->absx-widget->scrollx;
+  (*y)+=widget->absy-widget->scrolly;
 }
 
 void widget_coords_local_from_global(int *x,int *y,const struct widget *widget) {
   if (!widget) return;
-  do {
-    (*x)-=widget->x-widget->scrollx;
-    (*y)-=widget->y-widget->scrolly;
-  } while (widget=widget->parent);
+  (*x)-=widget->absx-widget->scrollx;
+  (*y)-=widget->absy-widget->scrolly;
 }
 
 int widget_point_in_bounds(const struct widget *widget,int x,int y) {
-  widget_coords_local_from_global(&x,&y,widget);
+  if (!widget) return 0;
+  x-=widget->absx;
+  y-=widget->absy;
   if ((x<0)||(y<0)||(x>=widget->w)||(y>=widget->h)) return 0;
   return 1;
 }
 
 void widget_get_clip(int *x,int *y,int *w,int *h,const struct widget *widget) {
   if (!widget) return;
-  *x=widget->x;
-  *y=widget->y;
-  *w=widget->w;
-  *h=widget->h;
-  if (*x<0) { (*w)+=(*x); *x=0; }
-  if (*y<0) { (*h)+=(*y); *y=0; }
-  while (widget=widget->parent) {
-    (*x)+=widget->x-widget->scrollx;
-    (*y)+=widget->y-widget->scrolly;
-    if (*x<0) { (*w)+=(*x); *x=0; }
-    if (*y<0) { (*h)+=(*y); *y=0; }
-    int pr=widget->x+widget->w;
-    int pb=widget->y+widget->h;
-    if (*x>pr-*w) (*w)=pr-(*x);
-    if (*y>pb-*h) (*h)=pb-(*y);
-  }
+  *x=widget->clipx;
+  *y=widget->clipy;
+  *w=widget->clipw;
+  *h=widget->cliph;
 }
 
 /* Render children.
@@ -291,6 +363,7 @@ void widget_measure(int *w,int *h,struct widget *widget,int maxw,int maxh) {
 
 void widget_pack(struct widget *widget) {
   if (!widget) return;
+  widget->ctx->pack_depth++;
   if (widget->type->pack) {
     widget->type->pack(widget);
   } else {
@@ -311,6 +384,7 @@ void widget_pack(struct widget *widget) {
       widget_pack(child);
     }
   }
+  if (!--(widget->ctx->pack_depth)) widget_refresh_transform(widget);
 }
 
 /* Set proxy.
@@ -322,5 +396,6 @@ int widget_set_proxy(struct widget *proxy,struct widget *target) {
   if (target&&(widget_ref(target)<0)) return -1;
   widget_del(proxy->proxyto);
   proxy->proxyto=target;
+  gui_mirror_patch(&proxy->ctx->mirror,proxy);
   return 0;
 }
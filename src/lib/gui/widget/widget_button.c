@@ -40,8 +40,8 @@ static int _button_init(struct widget *widget,const void *args,int argslen) {
   if (!WIDGET->font) {
     if (widget_button_set_font(widget,gui_get_default_font(widget->ctx))<0) return -1;
   }
-  widget->padx=5;
-  widget->pady=2;
+  widget->padx=gui_scale(widget->ctx,5);
+  widget->pady=gui_scale(widget->ctx,2);
   widget->focusable=1;
   widget->clickable=1;
   return 0;
@@ -52,7 +52,7 @@ static int _button_init(struct widget *widget,const void *args,int argslen) {
  
 static void _button_measure(int *w,int *h,struct widget *widget,int maxw,int maxh) {
   *w=WIDGET->stringw+(widget->padx<<1);
-  *h=WIDGET->stringh+(widget->pady<<1)+EXTRA_PAD_TOP;
+  *h=WIDGET->stringh+(widget->pady<<1)+gui_scale(widget->ctx,EXTRA_PAD_TOP);
 }
 
 /* Render.
@@ -69,7 +69,7 @@ static void _button_render(struct widget *widget,struct image *dst) {
   // Text label.
   if (WIDGET->textc) {
     int stringx=(widget->w>>1)-(WIDGET->stringw>>1);
-    int stringy=(widget->h>>1)-(WIDGET->stringh>>1)+EXTRA_PAD_TOP;
+    int stringy=(widget->h>>1)-(WIDGET->stringh>>1)+gui_scale(widget->ctx,EXTRA_PAD_TOP);
     font_set_color_normal(WIDGET->font,reversecolor?0xffffffff:0x00000000);
     font_render_string(dst,stringx,stringy,WIDGET->font,WIDGET->text,WIDGET->textc);
   }
@@ -31,8 +31,8 @@ static int _checkbox_init(struct widget *widget,const void *args,int argslen) {
  */
  
 static void _checkbox_measure(int *w,int *h,struct widget *widget,int maxw,int maxh) {
-  *w=(widget->padx<<1)+CHECKBOXW;
-  *h=(widget->pady<<1)+CHECKBOXH;
+  *w=(widget->padx<<1)+gui_scale(widget->ctx,CHECKBOXW);
+  *h=(widget->pady<<1)+gui_scale(widget->ctx,CHECKBOXH);
 }
 
 /* Activate.
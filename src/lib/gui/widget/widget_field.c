@@ -16,16 +16,47 @@ struct widget_field {
   void (*cb_postedit)(struct widget *widget,const char *text,int textc,int editp);
   int dragging; // Nonzero while left mouse button held.
   double click_time;
+  struct font_line_index lineindex; // Only used when (textc>=WIDGET_FIELD_INDEX_THRESHOLD).
+  struct text_undo undo;
 };
 
 #define WIDGET ((struct widget_field*)widget)
 
+/* Below this length, plain measuring is fast enough that an index isn't worth keeping.
+ */
+#define WIDGET_FIELD_INDEX_THRESHOLD 4096
+
 /* Cleanup.
  */
  
 static void _field_del(struct widget *widget) {
   if (WIDGET->text) free(WIDGET->text);
   font_del(WIDGET->font);
+  font_line_index_cleanup(&WIDGET->lineindex);
+  text_undo_cleanup(&WIDGET->undo);
+}
+
+/* Geometry, through the line index if the text is long.
+ */
+ 
+static int widget_field_measure_prefix(struct widget *widget,int p) {
+  if (WIDGET->textc<WIDGET_FIELD_INDEX_THRESHOLD) return font_measure_string(WIDGET->font,WIDGET->text,p);
+  return font_line_index_measure(&WIDGET->lineindex,WIDGET->font,WIDGET->text,WIDGET->textc,p);
+}
+
+static int widget_field_locate(struct widget *widget,int x) {
+  if (WIDGET->textc<WIDGET_FIELD_INDEX_THRESHOLD) return font_locate_point(WIDGET->font,WIDGET->text,WIDGET->textc,x);
+  return font_line_index_locate(&WIDGET->lineindex,WIDGET->font,WIDGET->text,WIDGET->textc,x);
+}
+
+// Call after every edit, with the text already changed.
+static void widget_field_text_changed(struct widget *widget,int p,int rmc,int addc) {
+  font_line_index_replace(&WIDGET->lineindex,WIDGET->font,WIDGET->text,WIDGET->textc,p,rmc,addc);
+}
+
+// Call before every edit except undo and redo, once it's approved.
+static void widget_field_record(struct widget *widget,int p,int rmc,const char *add,int addc,int flags) {
+  if (text_undo_push(&WIDGET->undo,p,WIDGET->text+p,rmc,add,addc,flags)<0) text_undo_clear(&WIDGET->undo);
 }
 
 /* Init.
@@ -45,8 +76,8 @@ static int _field_init(struct widget *widget,const void *args,int argslen) {
   WIDGET->fgcolor=        wm_pixel_from_rgbx(0x000000ff);
   WIDGET->highlight_color=wm_pixel_from_rgbx(0x40c0ffff);
   WIDGET->cursor_color=   wm_pixel_from_rgbx(0x000000ff);
-  widget->padx=5;
-  widget->pady=3;
+  widget->padx=gui_scale(widget->ctx,5);
+  widget->pady=gui_scale(widget->ctx,3);
   widget->focusable=1;
   widget->rawmouse=1;
   WIDGET->selw=-1;
@@ -75,8 +106,9 @@ static void _field_render(struct widget *widget,struct image *image) {
       p+=c;
       c=-c;
     }
-    WIDGET->selx=font_measure_string(WIDGET->font,WIDGET->text,p)+widget->padx;
-    WIDGET->selw=c?font_measure_string(WIDGET->font,WIDGET->text+p,c):0;
+    int x=widget_field_measure_prefix(widget,p);
+    WIDGET->selx=x+widget->padx;
+    WIDGET->selw=c?(widget_field_measure_prefix(widget,p+c)-x):0;
   }
   
   // If there's a selected range, fill it.
@@ -88,9 +120,21 @@ static void _field_render(struct widget *widget,struct image *image) {
     image_fill_rect(image,WIDGET->selx,widget->pady,1,widget->h-(widget->pady<<1),WIDGET->cursor_color);
   }
   
-  // The text.
+  // The text. Stop after the last glyph that shows; long lines can go on for megabytes past our right edge.
+  int textc=WIDGET->textc;
+  if (textc>=WIDGET_FIELD_INDEX_THRESHOLD) {
+    struct text_decoder decoder={
+      .v=WIDGET->text,
+      .c=WIDGET->textc,
+      .p=widget_field_locate(widget,widget->w-widget->padx),
+      .encoding=widget->ctx->encoding,
+    };
+    int codepoint;
+    text_decoder_read(&codepoint,&decoder);
+    textc=decoder.p;
+  }
   font_set_color_normal(WIDGET->font,WIDGET->fgcolor);
-  font_render_string(image,widget->padx,widget->pady,WIDGET->font,WIDGET->text,WIDGET->textc);
+  font_render_string(image,widget->padx,widget->pady,WIDGET->font,WIDGET->text,textc);
   
   // Outer frame.
   image_frame_rect(image,0,0,widget->w,widget->h,0x00000000);
@@ -113,6 +157,12 @@ static int _field_key(struct widget *widget,int keycode,int value,int codepoint)
    * Tempting to say (&&!codepoint) here, but some like Enter and Escape usually do have codepoints.
    */
   if (value) switch (keycode) {
+    case 0x0007001c: if (widget->ctx->modifiers&GUI_MOD_CTL) { widget_field_redo(widget); return 1; } break; // Y
+    case 0x0007001d: if (widget->ctx->modifiers&GUI_MOD_CTL) { // Z
+        if (widget->ctx->modifiers&GUI_MOD_SHIFT) widget_field_redo(widget);
+        else widget_field_undo(widget);
+        return 1;
+      } break;
     case 0x00070028: break; // Enter
     case 0x00070029: break; // Escape
     case 0x0007002a: widget_field_backspace(widget); return 1; // Backspace
@@ -151,7 +201,7 @@ static int _field_key(struct widget *widget,int keycode,int value,int codepoint)
 static int _field_mmotion(struct widget *widget,int mx,int my) {
   if (WIDGET->dragging) {
     widget_coords_local_from_global(&mx,&my,widget);
-    int p=font_locate_point(WIDGET->font,WIDGET->text,WIDGET->textc,mx-widget->padx);
+    int p=widget_field_locate(widget,mx-widget->padx);
     if (p<0) p=0; else if (p>WIDGET->textc) p=WIDGET->textc;
     // The obvious thing would be to anchor where the drag started, then update only (selc).
     // But I want the dragging end to be (selp) and the anchor (selp+selc), so if you Shift-Arrow after, your leading end remains operative.
@@ -185,7 +235,7 @@ static int _field_mbutton(struct widget *widget,int btnid,int value,int mx,int m
   
   // Where at?
   widget_coords_local_from_global(&mx,&my,widget);
-  int p=font_locate_point(WIDGET->font,WIDGET->text,WIDGET->textc,mx-widget->padx);
+  int p=widget_field_locate(widget,mx-widget->padx);
   if ((p<0)||(p>WIDGET->textc)) return 0; // font won't do this but let's be safe.
   
   // Double click?
@@ -246,6 +296,8 @@ int widget_field_set_text(struct widget *widget,const char *src,int srcc) {
   WIDGET->text=nv;
   WIDGET->textc=srcc;
   WIDGET->texta=srcc;
+  font_line_index_invalidate(&WIDGET->lineindex);
+  text_undo_clear(&WIDGET->undo);
   WIDGET->selp=WIDGET->textc;
   WIDGET->selc=0;
   WIDGET->selw=-1;
@@ -260,6 +312,8 @@ int widget_field_handoff_text(struct widget *widget,char *src,int srcc) {
   WIDGET->text=src;
   WIDGET->textc=srcc;
   WIDGET->texta=srcc;
+  font_line_index_invalidate(&WIDGET->lineindex);
+  text_undo_clear(&WIDGET->undo);
   WIDGET->selp=WIDGET->textc;
   WIDGET->selc=0;
   WIDGET->selw=-1;
@@ -272,6 +326,8 @@ int widget_field_set_font(struct widget *widget,struct font *font) {
   if (font_ref(font)<0) return -1;
   font_del(WIDGET->font);
   WIDGET->font=font;
+  font_line_index_invalidate(&WIDGET->lineindex);
+  WIDGET->selw=-1;
   widget->ctx->render_soon=1;
   return 0;
 }
@@ -437,8 +493,10 @@ static int widget_field_delete_selection(struct widget *widget) {
     if (err) return err;
   }
   
+  widget_field_record(widget,p,c,0,0,0);
   WIDGET->textc-=c;
   memmove(WIDGET->text+p,WIDGET->text+p+c,WIDGET->textc-p);
+  widget_field_text_changed(widget,p,c,0);
   WIDGET->selp=p;
   WIDGET->selc=0;
   WIDGET->selw=-1;
@@ -466,8 +524,11 @@ int widget_field_delete(struct widget *widget) {
     if (err) return err;
   }
 
+  widget_field_record(widget,WIDGET->selp,rmc,0,0,TEXT_UNDO_TYPING);
   WIDGET->textc-=rmc;
   memmove(WIDGET->text+WIDGET->selp,WIDGET->text+WIDGET->selp+rmc,WIDGET->textc-WIDGET->selp);
+  widget_field_text_changed(widget,WIDGET->selp,rmc,0);
+  WIDGET->selw=-1;
   widget->ctx->render_soon=1;
   
   if (WIDGET->cb_postedit) WIDGET->cb_postedit(widget,WIDGET->text,WIDGET->textc,WIDGET->selp);
@@ -493,8 +554,10 @@ int widget_field_backspace(struct widget *widget) {
     if (err) return err;
   }
   
+  widget_field_record(widget,p,c,0,0,TEXT_UNDO_TYPING);
   WIDGET->textc-=c;
   memmove(WIDGET->text+p,WIDGET->text+p+c,WIDGET->textc-p);
+  widget_field_text_changed(widget,p,c,0);
   WIDGET->selp=p;
   WIDGET->selw=-1;
   widget->ctx->render_soon=1;
@@ -513,29 +576,95 @@ int widget_field_insert_codepoint(struct widget *widget,int codepoint) {
   int encodedc=widget->ctx->encoding->write(encoded,sizeof(encoded),codepoint,widget->ctx->encoding->ctx);
   if ((encodedc<1)||(encodedc>sizeof(encoded))) return -1;
   
+  // Selection can run backward; the edit always goes forward.
+  int p=WIDGET->selp,c=WIDGET->selc;
+  if (c<0) {
+    p+=c;
+    c=-c;
+  }
+  
   if (WIDGET->cb_preedit) {
     int err=WIDGET->cb_preedit(
       widget,WIDGET->text,WIDGET->textc,
-      WIDGET->selp,WIDGET->selc,
+      p,c,
       encoded,encodedc
     );
     if (err) return err;
   }
   
+  widget_field_record(widget,p,c,encoded,encodedc,c?0:TEXT_UNDO_TYPING);
   struct text_encoder encoder={
     .v=WIDGET->text,
     .c=WIDGET->textc,
     .a=WIDGET->texta,
     .encoding=widget->ctx->encoding,
   };
-  if (text_encoder_replace_raw(&encoder,WIDGET->selp,WIDGET->selc,encoded,encodedc)<0) return -1;
+  if (text_encoder_replace_raw(&encoder,p,c,encoded,encodedc)<0) {
+    text_undo_clear(&WIDGET->undo);
+    return -1;
+  }
   WIDGET->text=encoder.v;
   WIDGET->textc=encoder.c;
   WIDGET->texta=encoder.a;
-  WIDGET->selp+=encodedc;
+  widget_field_text_changed(widget,p,c,encodedc);
+  WIDGET->selp=p+encodedc;
   WIDGET->selc=0;
   WIDGET->selw=-1;
   widget->ctx->render_soon=1;
   
   if (WIDGET->cb_postedit) WIDGET->cb_postedit(widget,WIDGET->text,WIDGET->textc,WIDGET->selp);
+  return 0;
+}
+
+/* Undo and redo.
+ * The journal gives us an edit to make, and it goes through (cb_preedit) like any other.
+ * If that's rejected, step the journal back where it was.
+ */
+
+static int widget_field_apply_history(struct widget *widget,const struct text_undo_edit *edit) {
+  if ((edit->p<0)||(edit->rmc<0)||(edit->p>WIDGET->textc-edit->rmc)) return -1;
+  if (WIDGET->cb_preedit) {
+    int err=WIDGET->cb_preedit(
+      widget,WIDGET->text,WIDGET->textc,
+      edit->p,edit->rmc,
+      edit->add,edit->addc
+    );
+    if (err) return err;
+  }
+  struct text_encoder encoder={
+    .v=WIDGET->text,
+    .c=WIDGET->textc,
+    .a=WIDGET->texta,
+    .encoding=widget->ctx->encoding,
+  };
+  if (text_encoder_replace_raw(&encoder,edit->p,edit->rmc,edit->add,edit->addc)<0) return -1;
+  WIDGET->text=encoder.v;
+  WIDGET->textc=encoder.c;
+  WIDGET->texta=encoder.a;
+  widget_field_text_changed(widget,edit->p,edit->rmc,edit->addc);
+  WIDGET->selp=edit->p+edit->addc;
+  WIDGET->selc=0;
+  WIDGET->selw=-1;
+  widget->ctx->render_soon=1;
+  
+  if (WIDGET->cb_postedit) WIDGET->cb_postedit(widget,WIDGET->text,WIDGET->textc,WIDGET->selp);
+  return 0;
+}
+
+int widget_field_undo(struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_field)) return -1;
+  struct text_undo_edit edit;
+  if (text_undo_undo(&edit,&WIDGET->undo)<=0) return 0;
+  int err=widget_field_apply_history(widget,&edit);
+  if (err) text_undo_redo(&edit,&WIDGET->undo);
+  return err;
+}
+
+int widget_field_redo(struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_field)) return -1;
+  struct text_undo_edit edit;
+  if (text_undo_redo(&edit,&WIDGET->undo)<=0) return 0;
+  int err=widget_field_apply_history(widget,&edit);
+  if (err) text_undo_undo(&edit,&WIDGET->undo);
+  return err;
 }
@@ -0,0 +1,392 @@
+/* widget_list.c
+ * Virtual list of rows. We never instantiate a widget per row; the data source draws each visible row on demand.
+ * Fixed-height lists are pure arithmetic.
+ * Variable-height lists keep a Fenwick tree of row heights, so row-at-y and y-of-row are both O(log n),
+ * and changing one row's height doesn't disturb the others.
+ */
+
+#include "lib/gui/gui_internal.h"
+
+#define LIST_SCROLLBAR_W 6
+#define LIST_WHEEL_ROWS 3
+#define LIST_DEFAULT_ROWH 16 /* Only for paging and wheel steps in variable-height lists. */
+
+struct widget_list {
+  struct widget hdr;
+  struct widget_args_list args;
+  int rowc;
+  int *heightv; // Fenwick tree of row heights, (rowc) long. Null if fixed-height.
+  int heighta;
+  int totalh;
+  int scroll; // Private, not (hdr.scrolly): We have no children and don't want the generic scroll applied to hit-testing.
+  int selrow; // -1 if none
+  int focus;
+  uint32_t highlight_color;
+  uint32_t scrollbar_color;
+  int scrollbarw; // LIST_SCROLLBAR_W at UI scale.
+  double click_time;
+  int click_row;
+};
+
+#define WIDGET ((struct widget_list*)widget)
+
+/* Cleanup.
+ */
+
+static void _list_del(struct widget *widget) {
+  if (WIDGET->heightv) free(WIDGET->heightv);
+}
+
+/* Fenwick tree primitives.
+ * All indices are row indices (0..rowc-1). "Prefix" of (p) is the sum of rows (0..p-1).
+ */
+
+static int list_prefix(const struct widget *widget,int p) {
+  if (!WIDGET->heightv) return p*WIDGET->args.rowh;
+  int sum=0;
+  for (;p>0;p&=p-1) sum+=WIDGET->heightv[p-1];
+  return sum;
+}
+
+static void list_adjust(struct widget *widget,int p,int d) {
+  for (;p<WIDGET->rowc;p|=p+1) WIDGET->heightv[p]+=d;
+}
+
+static int list_row_height(const struct widget *widget,int p) {
+  if ((p<0)||(p>=WIDGET->rowc)) return 0;
+  if (!WIDGET->heightv) return WIDGET->args.rowh;
+  return list_prefix(widget,p+1)-list_prefix(widget,p);
+}
+
+/* Row containing content-space (y), or (rowc) if past the end.
+ */
+
+static int list_row_at_content_y(const struct widget *widget,int y) {
+  if (y<0) return 0;
+  if (!WIDGET->heightv) {
+    if (WIDGET->args.rowh<1) return WIDGET->rowc;
+    int row=y/WIDGET->args.rowh;
+    return (row<WIDGET->rowc)?row:WIDGET->rowc;
+  }
+  int mask=1;
+  while (mask<=WIDGET->rowc>>1) mask<<=1;
+  int p=0;
+  for (;mask;mask>>=1) {
+    int q=p+mask;
+    if (q>WIDGET->rowc) continue;
+    if (WIDGET->heightv[q-1]<=y) {
+      y-=WIDGET->heightv[q-1];
+      p=q;
+    }
+  }
+  return p;
+}
+
+/* Measure every row and rebuild the index, for variable-height lists.
+ * O(n) measure calls, and only at reload.
+ */
+
+static int list_rebuild_index(struct widget *widget) {
+  if (WIDGET->args.rowh>0) {
+    WIDGET->totalh=WIDGET->rowc*WIDGET->args.rowh;
+    return 0;
+  }
+  if (WIDGET->rowc>WIDGET->heighta) {
+    if (WIDGET->rowc>INT_MAX/sizeof(int)) return -1;
+    void *nv=realloc(WIDGET->heightv,sizeof(int)*WIDGET->rowc);
+    if (!nv) return -1;
+    WIDGET->heightv=nv;
+    WIDGET->heighta=WIDGET->rowc;
+  }
+  if (!WIDGET->heightv) return 0;
+  int i=0;
+  for (;i<WIDGET->rowc;i++) {
+    int h=WIDGET->args.cb_measure(widget,i,WIDGET->args.userdata);
+    if (h<0) h=0;
+    WIDGET->heightv[i]=h;
+  }
+  // Linear-time Fenwick construction: Each node pushes its sum up to its parent.
+  for (i=0;i<WIDGET->rowc;i++) {
+    int parent=i|(i+1);
+    if (parent<WIDGET->rowc) WIDGET->heightv[parent]+=WIDGET->heightv[i];
+  }
+  WIDGET->totalh=list_prefix(widget,WIDGET->rowc);
+  return 0;
+}
+
+/* Clamp scroll to the content.
+ */
+
+static void list_clamp_scroll(struct widget *widget) {
+  int limit=WIDGET->totalh-widget->h;
+  if (WIDGET->scroll>limit) WIDGET->scroll=limit;
+  if (WIDGET->scroll<0) WIDGET->scroll=0;
+}
+
+/* Init.
+ */
+
+static int _list_init(struct widget *widget,const void *args,int argslen) {
+  if (!args||(argslen!=sizeof(struct widget_args_list))) return -1; // args required
+  WIDGET->args=*(const struct widget_args_list*)args;
+  if (!WIDGET->args.cb_count||!WIDGET->args.cb_render) return -1;
+  if ((WIDGET->args.rowh<1)&&!WIDGET->args.cb_measure) return -1;
+  widget->bgcolor=        wm_pixel_from_rgbx(0xffffffff);
+  WIDGET->highlight_color=wm_pixel_from_rgbx(0x40c0ffff);
+  WIDGET->scrollbar_color=wm_pixel_from_rgbx(0x808080ff);
+  WIDGET->scrollbarw=gui_scale(widget->ctx,LIST_SCROLLBAR_W);
+  widget->focusable=1;
+  widget->rawmouse=1;
+  WIDGET->selrow=-1;
+  WIDGET->click_row=-1;
+  if (widget_list_reload(widget)<0) return -1;
+  return 0;
+}
+
+/* Measure.
+ * We'd like to show everything, but don't ask for more than the parent's estimate.
+ */
+
+static void _list_measure(int *w,int *h,struct widget *widget,int maxw,int maxh) {
+  int wanth=WIDGET->totalh+(widget->pady<<1);
+  if (wanth>maxh) wanth=maxh;
+  if (wanth>*h) *h=wanth;
+}
+
+/* Pack.
+ */
+
+static void _list_pack(struct widget *widget) {
+  list_clamp_scroll(widget);
+}
+
+/* Render.
+ */
+
+static void _list_render(struct widget *widget,struct image *dst) {
+  if ((dst->pixelsize!=32)||(dst->stride&3)||!dst->writeable) return;
+  int roww=widget->w;
+  int scrollbar=(WIDGET->totalh>widget->h);
+  if (scrollbar) roww-=WIDGET->scrollbarw;
+  if (roww<1) return;
+
+  /* Visit only the rows that intersect our bounds.
+   * Each row gets its own slice of (dst), clipped the same way widget_render_children does it.
+   */
+  int stridewords=dst->stride>>2;
+  int row=list_row_at_content_y(widget,WIDGET->scroll);
+  int y=list_prefix(widget,row)-WIDGET->scroll;
+  for (;(row<WIDGET->rowc)&&(y<widget->h);row++) {
+    int rowh=list_row_height(widget,row);
+    int ry=y+dst->y0,rh=rowh;
+    int rx=dst->x0,rw=roww;
+    int x0=0,y0=0;
+    y+=rowh;
+    if (rx<0) { x0=rx; rw+=rx; rx=0; }
+    if (ry<0) { y0=ry; rh+=ry; ry=0; }
+    if (rx>dst->w-rw) rw=dst->w-rx;
+    if (ry>dst->h-rh) rh=dst->h-ry;
+    if ((rw<1)||(rh<1)) continue;
+    struct image sub={
+      .v=((uint32_t*)dst->v)+stridewords*ry+rx,
+      .w=rw,
+      .h=rh,
+      .stride=dst->stride,
+      .pixelsize=32,
+      .writeable=1,
+      .x0=x0,
+      .y0=y0,
+    };
+    int selected=(row==WIDGET->selrow);
+    if (selected) image_fill_rect(&sub,0,0,roww,rowh,WIDGET->highlight_color);
+    WIDGET->args.cb_render(widget,&sub,row,selected,WIDGET->args.userdata);
+  }
+
+  // Scroll bar, just an indicator.
+  if (scrollbar) {
+    int thumbh=(int)(((int64_t)widget->h*widget->h)/WIDGET->totalh);
+    if (thumbh<WIDGET->scrollbarw) thumbh=WIDGET->scrollbarw;
+    int range=WIDGET->totalh-widget->h;
+    int thumby=(int)(((int64_t)WIDGET->scroll*(widget->h-thumbh))/range);
+    image_fill_rect(dst,roww+gui_get_scale(widget->ctx),thumby,WIDGET->scrollbarw-2*gui_get_scale(widget->ctx),thumbh,WIDGET->scrollbar_color);
+  }
+
+  if (WIDGET->focus) {
+    image_frame_rect_dotted(dst,0,0,widget->w,widget->h,0x00000000);
+  }
+}
+
+/* Focus.
+ */
+
+static void _list_focus(struct widget *widget,int focus) {
+  WIDGET->focus=focus;
+  widget->ctx->render_soon=1;
+}
+
+/* Change selection, with optional callback.
+ */
+
+static void list_select(struct widget *widget,int row) {
+  if (row>=WIDGET->rowc) row=WIDGET->rowc-1;
+  if (row<0) row=-1;
+  if (row==WIDGET->selrow) return;
+  WIDGET->selrow=row;
+  if (row>=0) widget_list_scroll_to(widget,row);
+  widget->ctx->render_soon=1;
+  if (WIDGET->args.cb_select) WIDGET->args.cb_select(widget,row,WIDGET->args.userdata);
+}
+
+/* Keystroke.
+ */
+
+static int _list_key(struct widget *widget,int keycode,int value,int codepoint) {
+  if (!value) return 0;
+  int pagerows=widget->h/((WIDGET->args.rowh>0)?WIDGET->args.rowh:gui_scale(widget->ctx,LIST_DEFAULT_ROWH));
+  if (pagerows<1) pagerows=1;
+  switch (keycode) {
+    case 0x00070028: { // Enter
+        if ((WIDGET->selrow>=0)&&WIDGET->args.cb_activate) {
+          WIDGET->args.cb_activate(widget,WIDGET->selrow,WIDGET->args.userdata);
+        }
+      } return 1;
+    case 0x0007004a: list_select(widget,0); return 1; // Home
+    case 0x0007004b: list_select(widget,(WIDGET->selrow<0)?0:(WIDGET->selrow-pagerows)); return 1; // Page Up
+    case 0x0007004d: list_select(widget,WIDGET->rowc-1); return 1; // End
+    case 0x0007004e: list_select(widget,(WIDGET->selrow<0)?0:(WIDGET->selrow+pagerows)); return 1; // Page Down
+    case 0x00070051: list_select(widget,WIDGET->selrow+1); return 1; // Down
+    case 0x00070052: list_select(widget,(WIDGET->selrow<0)?0:(WIDGET->selrow-1)); return 1; // Up
+  }
+  return 0;
+}
+
+/* Mouse.
+ */
+
+static int _list_mbutton(struct widget *widget,int btnid,int value,int mx,int my) {
+  if (btnid!=1) return 0;
+  if (!value) return 1;
+  gui_focus_widget(widget->ctx,widget);
+  widget_coords_local_from_global(&mx,&my,widget);
+  int row=widget_list_row_at(widget,my);
+  if (row<0) return 1;
+  double now=gui_now_real();
+  if ((row==WIDGET->click_row)&&(now-WIDGET->click_time<=widget->ctx->double_click_interval)) {
+    WIDGET->click_row=-1;
+    if (WIDGET->args.cb_activate) WIDGET->args.cb_activate(widget,row,WIDGET->args.userdata);
+    return 1;
+  }
+  WIDGET->click_time=now;
+  WIDGET->click_row=row;
+  list_select(widget,row);
+  return 1;
+}
+
+static int _list_mwheel(struct widget *widget,int dx,int dy,int mx,int my) {
+  if (!dy) return 0;
+  int step=LIST_WHEEL_ROWS*((WIDGET->args.rowh>0)?WIDGET->args.rowh:gui_scale(widget->ctx,LIST_DEFAULT_ROWH));
+  int pv=WIDGET->scroll;
+  WIDGET->scroll+=dy*step;
+  list_clamp_scroll(widget);
+  if (WIDGET->scroll!=pv) widget->ctx->render_soon=1;
+  return 1;
+}
+
+/* Type definition.
+ */
+
+const struct widget_type widget_type_list={
+  .name="list",
+  .objlen=sizeof(struct widget_list),
+  .autorender=1,
+  .del=_list_del,
+  .init=_list_init,
+  .measure=_list_measure,
+  .pack=_list_pack,
+  .render=_list_render,
+  .focus=_list_focus,
+  .key=_list_key,
+  .mbutton=_list_mbutton,
+  .mwheel=_list_mwheel,
+};
+
+/* Public accessors.
+ */
+
+void *widget_list_get_userdata(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_list)) return 0;
+  return WIDGET->args.userdata;
+}
+
+int widget_list_reload(struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_list)) return -1;
+  int rowc=WIDGET->args.cb_count(widget,WIDGET->args.userdata);
+  if (rowc<0) rowc=0;
+  WIDGET->rowc=rowc;
+  if (list_rebuild_index(widget)<0) {
+    WIDGET->rowc=0;
+    WIDGET->totalh=0;
+    return -1;
+  }
+  if (WIDGET->selrow>=WIDGET->rowc) WIDGET->selrow=-1;
+  list_clamp_scroll(widget);
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+int widget_list_row_changed(struct widget *widget,int row) {
+  if (!widget||(widget->type!=&widget_type_list)) return -1;
+  if ((row<0)||(row>=WIDGET->rowc)) return -1;
+  if (WIDGET->heightv) {
+    int h=WIDGET->args.cb_measure(widget,row,WIDGET->args.userdata);
+    if (h<0) h=0;
+    int d=h-list_row_height(widget,row);
+    if (d) {
+      list_adjust(widget,row,d);
+      WIDGET->totalh+=d;
+      list_clamp_scroll(widget);
+    }
+  }
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+int widget_list_count_rows(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_list)) return 0;
+  return WIDGET->rowc;
+}
+
+int widget_list_get_selection(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_list)) return -1;
+  return WIDGET->selrow;
+}
+
+int widget_list_set_selection(struct widget *widget,int row) {
+  if (!widget||(widget->type!=&widget_type_list)) return -1;
+  if (row>=WIDGET->rowc) return -1;
+  if (row<0) row=-1;
+  WIDGET->selrow=row;
+  if (row>=0) widget_list_scroll_to(widget,row);
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+int widget_list_scroll_to(struct widget *widget,int row) {
+  if (!widget||(widget->type!=&widget_type_list)) return -1;
+  if ((row<0)||(row>=WIDGET->rowc)) return -1;
+  int top=list_prefix(widget,row);
+  int bottom=top+list_row_height(widget,row);
+  if (top<WIDGET->scroll) WIDGET->scroll=top;
+  else if (bottom>WIDGET->scroll+widget->h) WIDGET->scroll=bottom-widget->h;
+  list_clamp_scroll(widget);
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+int widget_list_row_at(const struct widget *widget,int y) {
+  if (!widget||(widget->type!=&widget_type_list)) return -1;
+  if ((y<0)||(y>=widget->h)) return -1;
+  int row=list_row_at_content_y(widget,y+WIDGET->scroll);
+  if (row>=WIDGET->rowc) return -1;
+  return row;
+}
@@ -14,7 +14,7 @@ struct widget_menu {
  */
  
 static void _menu_del(struct widget *widget) {
-  gui_remove_modal(widget->ctx,WIDGET->content);
+  if (widget->ctx==gui_global_context) gui_remove_modal(widget->ctx,WIDGET->content); // Not if we outlived it.
   font_del(WIDGET->font);
   widget_del(WIDGET->content);
 }
@@ -35,8 +35,8 @@ static int _menubar_init(struct widget *widget,const void *args,int argslen) {
     if (font_ref(font)<0) return -1;
     WIDGET->font=font;
   }
-  widget->padx=5; // Between items, and the left edge.
-  widget->pady=6; // Total extra space divided between top and bottom.
+  widget->padx=gui_scale(widget->ctx,5); // Between items, and the left edge.
+  widget->pady=gui_scale(widget->ctx,6); // Total extra space divided between top and bottom.
   WIDGET->linecolor=wm_pixel_from_rgbx(0x000000ff);
   widget->bgcolor=wm_pixel_from_rgbx(0xc0c0c0ff);
   return 0;
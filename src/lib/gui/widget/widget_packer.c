@@ -28,6 +28,7 @@ static int _packer_init(struct widget *widget,const void *args,int argslen) {
 
   if (argslen==sizeof(struct widget_args_packer)) {
     WIDGET->args=*(const struct widget_args_packer*)args;
+    WIDGET->args.spacing=gui_scale(widget->ctx,WIDGET->args.spacing);
   } else {
     WIDGET->args.orientation='y';
     WIDGET->args.reverse=0;
@@ -24,7 +24,7 @@ static int _separator_init(struct widget *widget,const void *args,int argslen) {
   if (args&&(argslen==sizeof(struct widget_args_separator))) {
     const struct widget_args_separator *ARGS=args;
     WIDGET->orient=ARGS->orient;
-    WIDGET->size=ARGS->size;
+    WIDGET->size=gui_scale(widget->ctx,ARGS->size);
     WIDGET->pct=ARGS->pct;
   }
   if (!WIDGET->orient) WIDGET->orient='x';
@@ -34,7 +34,7 @@ static int _separator_init(struct widget *widget,const void *args,int argslen) {
   if ((WIDGET->size<0)||(WIDGET->pct<0)) return -1;
   if (!widget_spawn(widget,&widget_type_dummy,0,0)) return -1;
   if (!widget_spawn(widget,&widget_type_dummy,0,0)) return -1;
-  WIDGET->barw=5;
+  WIDGET->barw=gui_scale(widget->ctx,5);
   WIDGET->linecolor=wm_pixel_from_rgbx(0x404040ff);
   return 0;
 }
@@ -1,42 +1,1438 @@
+/* widget_textedit.c
+ * Multi-line text editor over a doc.
+ * We only ever look at the visible lines, so the cost of a frame doesn't depend on the document's size.
+ * Rows are rendered into a cache of our own size, and each slot remembers which row of which line it shows.
+ * Edits and selection changes mark just the affected slots dirty.
+ * Render works out which row belongs in each slot, moves cached rows that are already drawn somewhere else, and draws the rest.
+ * So scrolling, or an edit that adds or removes lines, only draws what's newly exposed.
+ *
+ * With soft wrap, each line is one or more rows, and a font_wrap_index knows how many.
+ * Visible lines are measured as we draw them. When the width changes, an idle job measures the rest.
+ *
+ * Without wrap, a long line gets a font_line_index, and we only ever read the part of it we're measuring or showing.
+ * So typing in a megabyte of minified script costs the same as anywhere else.
+ *
+ * A new doc's newlines get counted in the background. Until that's done, we only learn about lines as far as we look,
+ * so the first frame of a huge file costs what's on screen, not a pass over the whole thing.
+ */
+
 #include "lib/gui/gui_internal.h"
+#include "lib/doc/doc.h"
+#include "lib/serial/serial.h"
+
+#define TEXTEDIT_WHEEL_ROWS 3
+#define TEXTEDIT_STEP_LIMIT 8 /* Longest encoded codepoint we might step over, with room to spare. */
+#define TEXTEDIT_LONG_LINE 4096 /* Lines at least this long get a font_line_index, same as widget_field. */
+#define TEXTEDIT_LINE_INDEX_LIMIT 256 /* Long lines we keep an index for. More than a screenful, so render doesn't churn them. */
+#define TEXTEDIT_LINE_LOOKAHEAD 1024 /* Lines to learn about beyond the one we need, while the count is incomplete. */
+
+// Identifies one visual row: (sub) is the row within (line). Lines past the end of the doc are blank.
+struct textedit_slot {
+  int64_t line; // <0 if not drawn.
+  int sub;
+};
+
+// Index of the long line starting at (ls).
+struct textedit_line_index {
+  int64_t ls;
+  struct font_line_index index;
+};
 
 struct widget_textedit {
   struct widget hdr;
+  struct doc *doc; // STRONG, never null after init.
+  struct font *font;
+  uint32_t fgcolor;
+  uint32_t highlight_color;
+  uint32_t cursor_color;
+  int focus;
+  int64_t selp,selc; // Same as widget_field: (selp) is the business end, and (selc) may be negative.
+  int64_t linec; // Lines we know of. The true count if the doc has counted them all, otherwise maybe short.
+  int censusjob; // Background job counting the doc's newlines, or zero.
+  int64_t topline; // First visible line.
+  int topsub; // First visible row of (topline), always zero without wrap.
+  int scrollx; // Private, not (hdr.scrollx): We have no children and don't want the generic scroll applied to hit-testing. Always zero with wrap.
+  int goalx; // Horizontal position for Up and Down to aim at, or <0 to take it from the cursor.
+  int rowh;
+  uint32_t *cachev; // Rendered rows, (cachew) by (slotc*rowh).
+  int cachew;
+  uint32_t cachebg; // (hdr.bgcolor) when the cache was drawn.
+  struct textedit_slot *slotv; // Row rendered in each cache slot.
+  struct textedit_slot *wantv; // Scratch for render: Row that belongs in each slot.
+  int *srcv; // Scratch for render: Slot that already has it, or -1.
+  int slotc;
+  char *scratch; // Lines that span pieces get copied here.
+  int scratcha;
+  struct textedit_line_index *lineindexv; // Most recently used first.
+  int lineindexc,lineindexa;
+  int wrap;
+  int wrapw; // Width (wrapindex) was measured at, or zero to measure again.
+  struct font_wrap_index wrapindex; // One entry per line we know of, only while (wrap).
+  int *breakv; // Row breaks of the last line we looked at.
+  int breaka;
+  int wrapjob; // Idle job measuring stale lines, or zero.
+  struct text_undo undo;
+  void *userdata;
+  void (*cb_postedit)(struct widget *widget,int64_t p,int64_t rmc,int64_t addc);
+  int dragging;
+  double click_time;
 };
 
 #define WIDGET ((struct widget_textedit*)widget)
 
 /* Cleanup.
  */
- 
+
 static void _textedit_del(struct widget *widget) {
+  doc_del(WIDGET->doc);
+  font_del(WIDGET->font);
+  if (WIDGET->cachev) free(WIDGET->cachev);
+  if (WIDGET->slotv) free(WIDGET->slotv);
+  if (WIDGET->wantv) free(WIDGET->wantv);
+  if (WIDGET->srcv) free(WIDGET->srcv);
+  if (WIDGET->scratch) free(WIDGET->scratch);
+  if (WIDGET->lineindexv) {
+    while (WIDGET->lineindexc-->0) font_line_index_cleanup(&WIDGET->lineindexv[WIDGET->lineindexc].index);
+    free(WIDGET->lineindexv);
+  }
+  font_wrap_index_cleanup(&WIDGET->wrapindex);
+  if (WIDGET->breakv) free(WIDGET->breakv);
+  text_undo_cleanup(&WIDGET->undo);
+}
+
+/* Line geometry.
+ * A line's end is the position of its LF, or the end of the document.
+ * Short lines we scan. Past TEXTEDIT_LONG_LINE we ask where the next line starts instead, so a long line costs the same as a short one.
+ */
+
+static int64_t textedit_line_end(struct widget *widget,int64_t line,int64_t ls) {
+  int64_t p=ls,limit=ls+TEXTEDIT_LONG_LINE;
+  while (p<limit) {
+    const char *src;
+    int srcc=doc_get_segment(&src,WIDGET->doc,p);
+    if (srcc<1) return p;
+    if (srcc>limit-p) srcc=limit-p;
+    const char *lf=memchr(src,0x0a,srcc);
+    if (lf) return p+(lf-src);
+    p+=srcc;
+  }
+  int64_t next=doc_offset_from_line(WIDGET->doc,line+1);
+  char lf=0;
+  if ((next>ls)&&(doc_read(&lf,1,WIDGET->doc,next-1)==1)&&(lf==0x0a)) return next-1;
+  return doc_get_length(WIDGET->doc);
+}
+
+static void textedit_line_bounds(int64_t *ls,int64_t *le,struct widget *widget,int64_t line) {
+  *ls=doc_offset_from_line(WIDGET->doc,line);
+  *le=textedit_line_end(widget,line,*ls);
+}
+
+/* Learn about lines through (line), or all of them if there's fewer, and return how many we know of.
+ * Until the background count is done, the doc counts only as far as we ask, and a little beyond so we don't ask every time.
+ * With wrap, the index grows to cover the new lines, stale at one row each.
+ * If it can't, wrap turns off.
+ */
+
+static void textedit_drop_wrap(struct widget *widget);
+
+static int64_t textedit_require_lines(struct widget *widget,int64_t line) {
+  if (line<WIDGET->linec) return WIDGET->linec;
+  int64_t linec;
+  if (doc_lines_counted(WIDGET->doc)) linec=doc_get_line_count(WIDGET->doc);
+  else linec=doc_get_line_count_upto(WIDGET->doc,line+TEXTEDIT_LINE_LOOKAHEAD);
+  if (linec<=WIDGET->linec) return WIDGET->linec;
+  if (WIDGET->wrap) {
+    if ((linec>INT_MAX)||(font_wrap_index_replace(&WIDGET->wrapindex,WIDGET->linec,0,linec-WIDGET->linec)<0)) {
+      textedit_drop_wrap(widget);
+    }
+  }
+  WIDGET->linec=linec;
+  return linec;
+}
+
+/* Contiguous text of (ls..le), usually straight out of the doc. A whole line, or a window of a long one.
+ * Valid until the next edit or the next call.
+ */
+
+static int textedit_line_text(const char **dstpp,struct widget *widget,int64_t ls,int64_t le) {
+  int64_t len=le-ls;
+  if (len>INT_MAX) len=INT_MAX;
+  if (len<1) {
+    *dstpp="";
+    return 0;
+  }
+  if (doc_get_segment(dstpp,WIDGET->doc,ls)>=len) return len;
+  if (len>WIDGET->scratcha) {
+    void *nv=realloc(WIDGET->scratch,len);
+    if (!nv) return 0;
+    WIDGET->scratch=nv;
+    WIDGET->scratcha=len;
+  }
+  *dstpp=WIDGET->scratch;
+  return doc_read(WIDGET->scratch,len,WIDGET->doc,ls);
+}
+
+/* Indexes of long lines, without wrap.
+ * We keep the few most recently used, keyed by where the line starts, and edits patch them. See textedit_line_index_edit.
+ * Building reads the line a segment at a time, never copying it whole.
+ * Returns null if this isn't a long line or we can't index it, and then the caller reads the whole line like any other.
+ */
+
+static void textedit_drop_line_index(struct widget *widget,int p) {
+  font_line_index_cleanup(&WIDGET->lineindexv[p].index);
+  WIDGET->lineindexc--;
+  memmove(WIDGET->lineindexv+p,WIDGET->lineindexv+p+1,sizeof(struct textedit_line_index)*(WIDGET->lineindexc-p));
+}
+
+static void textedit_drop_line_indexes(struct widget *widget) {
+  while (WIDGET->lineindexc>0) textedit_drop_line_index(widget,WIDGET->lineindexc-1);
+}
+
+static int textedit_build_line_index(struct font_line_index *index,struct widget *widget,int64_t ls,int len) {
+  int p=0;
+  while (p<len) {
+    char tmp[256]; // Segments too short to make progress, eg the seam between pieces, get read across into here.
+    const char *src;
+    int srcc=doc_get_segment(&src,WIDGET->doc,ls+p);
+    if (srcc>len-p) srcc=len-p;
+    if ((srcc<sizeof(tmp))&&(p+srcc<len)) {
+      srcc=doc_read(tmp,sizeof(tmp),WIDGET->doc,ls+p);
+      if (srcc>len-p) srcc=len-p;
+      src=tmp;
+    }
+    if (srcc<1) return -1;
+    if ((p=font_line_index_build_window(index,WIDGET->font,src,srcc,p,len))<0) return -1;
+  }
+  return 0;
+}
+
+static struct font_line_index *textedit_require_line_index(struct widget *widget,int64_t ls,int64_t le) {
+  if (WIDGET->wrap||(le-ls<TEXTEDIT_LONG_LINE)) return 0;
+  int len=(le-ls>INT_MAX)?INT_MAX:(le-ls);
+
+  // Take it out of the list if we have it, or make room for it.
+  struct textedit_line_index entry={0};
+  int p=0;
+  while ((p<WIDGET->lineindexc)&&(WIDGET->lineindexv[p].ls!=ls)) p++;
+  if (p<WIDGET->lineindexc) {
+    entry=WIDGET->lineindexv[p];
+    if (!p&&entry.index.c&&(entry.index.srcc==len)) return &WIDGET->lineindexv[0].index;
+    WIDGET->lineindexc--;
+    memmove(WIDGET->lineindexv+p,WIDGET->lineindexv+p+1,sizeof(struct textedit_line_index)*(WIDGET->lineindexc-p));
+  } else if (WIDGET->lineindexc>=TEXTEDIT_LINE_INDEX_LIMIT) {
+    entry=WIDGET->lineindexv[--WIDGET->lineindexc]; // Least recently used. Keep its memory, the build starts over.
+    entry.index.c=0;
+  } else if (WIDGET->lineindexc>=WIDGET->lineindexa) {
+    int na=WIDGET->lineindexa+16;
+    void *nv=realloc(WIDGET->lineindexv,sizeof(struct textedit_line_index)*na);
+    if (!nv) return 0;
+    WIDGET->lineindexv=nv;
+    WIDGET->lineindexa=na;
+  }
+
+  // Build if it's new or stale, then put it in front.
+  entry.ls=ls;
+  if (!entry.index.c||(entry.index.srcc!=len)) {
+    if (textedit_build_line_index(&entry.index,widget,ls,len)<0) {
+      font_line_index_cleanup(&entry.index);
+      return 0;
+    }
+  }
+  memmove(WIDGET->lineindexv+1,WIDGET->lineindexv,sizeof(struct textedit_line_index)*WIDGET->lineindexc);
+  WIDGET->lineindexv[0]=entry;
+  WIDGET->lineindexc++;
+  return &WIDGET->lineindexv[0].index;
+}
+
+/* Horizontal position of (p) in the line (ls..le), when there's no wrap.
+ */
+
+static int textedit_measure_in_line(struct widget *widget,int64_t ls,int64_t le,int64_t p) {
+  const char *src;
+  struct font_line_index *index=textedit_require_line_index(widget,ls,le);
+  if (index) {
+    int spanp;
+    int x=font_line_index_span_p(&spanp,index,p-ls);
+    int srcc=textedit_line_text(&src,widget,ls+spanp,p);
+    return x+font_measure_string(WIDGET->font,src,srcc);
+  }
+  int srcc=textedit_line_text(&src,widget,ls,le);
+  return font_measure_string(WIDGET->font,src,(p-ls<srcc)?(p-ls):srcc);
+}
+
+/* Break the text of (line) into rows, leaving the breaks in (breakv), and return the row count.
+ * Without wrap, it's always one row.
+ * Having measured, we record the count in the wrap index.
+ */
+
+static int textedit_row_breaks(struct widget *widget,int64_t line,const char *src,int srcc) {
+  if (!WIDGET->wrap) return 1;
+  int rowc=font_wrap_line(WIDGET->breakv,WIDGET->breaka,WIDGET->font,src,srcc,WIDGET->wrapw);
+  if (rowc-1>WIDGET->breaka) {
+    int na=(rowc+63)&~63;
+    if (na<=INT_MAX/sizeof(int)) {
+      void *nv=realloc(WIDGET->breakv,sizeof(int)*na);
+      if (nv) {
+        WIDGET->breakv=nv;
+        WIDGET->breaka=na;
+      }
+    }
+    rowc=font_wrap_line(WIDGET->breakv,WIDGET->breaka,WIDGET->font,src,srcc,WIDGET->wrapw);
+    if (rowc-1>WIDGET->breaka) rowc=WIDGET->breaka+1; // Out of memory. Whatever doesn't fit, runs off the last row.
+  }
+  textedit_require_lines(widget,line);
+  if (WIDGET->wrap) font_wrap_index_set(&WIDGET->wrapindex,line,rowc);
+  return rowc;
+}
+
+// Offset and length in the line's text of row (sub), from the last textedit_row_breaks.
+static void textedit_row_span(int *segp,int *segc,struct widget *widget,int sub,int rowc,int srcc) {
+  int a=(sub>0)?WIDGET->breakv[sub-1]:0;
+  int z=(sub<rowc-1)?WIDGET->breakv[sub]:srcc;
+  *segp=a;
+  *segc=z-a;
+}
+
+/* How many rows in (line), measuring it if we only have a guess.
+ */
+
+static int textedit_line_rows(struct widget *widget,int64_t line) {
+  textedit_require_lines(widget,line);
+  if (!WIDGET->wrap) return 1;
+  int stale=0;
+  int rowc=font_wrap_index_get(&stale,&WIDGET->wrapindex,line);
+  if (!stale) return (rowc<1)?1:rowc;
+  int64_t ls,le;
+  textedit_line_bounds(&ls,&le,widget,line);
+  const char *src;
+  int srcc=textedit_line_text(&src,widget,ls,le);
+  return textedit_row_breaks(widget,line,src,srcc);
+}
+
+/* Conversion between lines and absolute rows.
+ * Without wrap they're the same thing.
+ * We only count rows of the lines we know of. Rows past those are clamped to the last one,
+ * but line_from_row learns more lines first, so it's only clamped at the real end.
+ */
+
+static int64_t textedit_count_rows(struct widget *widget) {
+  if (WIDGET->wrap) return WIDGET->wrapindex.rowc;
+  return WIDGET->linec;
+}
+
+static int64_t textedit_row_from_line(struct widget *widget,int64_t line,int sub) {
+  textedit_require_lines(widget,line);
+  if (WIDGET->wrap) return font_wrap_index_row_from_line(&WIDGET->wrapindex,line)+sub;
+  return line;
+}
+
+static int64_t textedit_line_from_row(int *sub,struct widget *widget,int64_t row) {
+  if (row<0) row=0;
+  if (WIDGET->wrap) {
+    while (row>=WIDGET->wrapindex.rowc) {
+      int64_t linec=WIDGET->linec;
+      if (textedit_require_lines(widget,linec)<=linec) break;
+      if (!WIDGET->wrap) break;
+    }
+    if (WIDGET->wrap) return font_wrap_index_line_from_row(sub,&WIDGET->wrapindex,row);
+  }
+  *sub=0;
+  int64_t linec=textedit_require_lines(widget,row);
+  return (row<linec)?row:(linec-1);
+}
+
+/* Where (p) shows up: Its line, the row within that line, and horizontal position in the row not counting scroll or padding.
+ * A position right at a break belongs to the row starting there.
+ */
+
+static void textedit_position(int64_t *line,int *sub,int *x,struct widget *widget,int64_t p) {
+  *line=doc_line_from_offset(WIDGET->doc,p);
+  int64_t ls,le;
+  textedit_line_bounds(&ls,&le,widget,*line);
+  if (p>le) p=le;
+  if (!WIDGET->wrap) {
+    *sub=0;
+    *x=textedit_measure_in_line(widget,ls,le,p);
+    return;
+  }
+  const char *src;
+  int srcc=textedit_line_text(&src,widget,ls,le);
+  int rowc=textedit_row_breaks(widget,*line,src,srcc);
+  int off=(p-ls<srcc)?(p-ls):srcc;
+  int s=0;
+  while ((s<rowc-1)&&(WIDGET->breakv[s]<=off)) s++;
+  int segp,segc;
+  textedit_row_span(&segp,&segc,widget,s,rowc,srcc);
+  *sub=s;
+  *x=font_measure_string(WIDGET->font,src+segp,off-segp);
+}
+
+/* Position nearest (x) in row (sub) of the line at (ls), whose text and breaks we've just fetched.
+ * Past the end of a row that isn't the line's last, we stop before the final character, otherwise we'd be on the next row.
+ */
+
+static int64_t textedit_locate_in_row(struct widget *widget,int64_t ls,const char *src,int srcc,int sub,int rowc,int x) {
+  int segp,segc;
+  textedit_row_span(&segp,&segc,widget,sub,rowc,srcc);
+  int p=segp+font_locate_point(WIDGET->font,src+segp,segc,x);
+  if ((sub<rowc-1)&&(segc>0)&&(p>=segp+segc)) {
+    struct text_decoder decoder={.v=src,.c=segp+segc,.p=segp+segc,.encoding=widget->ctx->encoding};
+    int codepoint;
+    if (text_decoder_unread(&codepoint,&decoder)>0) p=decoder.p;
+  }
+  return ls+p;
+}
+
+/* Position nearest (x) in row (sub) of (line), which is (ls..le).
+ * Long lines without wrap only read the bit around (x).
+ */
+
+static int64_t textedit_locate_in_line(struct widget *widget,int64_t line,int64_t ls,int64_t le,int sub,int x) {
+  const char *src;
+  struct font_line_index *index=textedit_require_line_index(widget,ls,le);
+  if (index) {
+    int spanp,spanc;
+    int spanx=font_line_index_span_x(&spanp,&spanc,index,x);
+    int srcc=textedit_line_text(&src,widget,ls+spanp,ls+spanp+spanc);
+    return ls+spanp+font_locate_point(WIDGET->font,src,srcc,x-spanx);
+  }
+  int srcc=textedit_line_text(&src,widget,ls,le);
+  int rowc=textedit_row_breaks(widget,line,src,srcc);
+  if (sub>=rowc) sub=rowc-1;
+  return textedit_locate_in_row(widget,ls,src,srcc,sub,rowc,x);
+}
+
+/* Step one codepoint forward (d>0) or backward from (p).
+ * Returns the new position, or (p) if there's nothing that way.
+ */
+
+static int64_t textedit_step(int *codepoint,struct widget *widget,int64_t p,int d) {
+  char tmp[TEXTEDIT_STEP_LIMIT];
+  struct text_decoder decoder={.v=tmp,.encoding=widget->ctx->encoding};
+  int cp;
+  if (!codepoint) codepoint=&cp;
+  if (d>0) {
+    decoder.c=doc_read(tmp,sizeof(tmp),WIDGET->doc,p);
+    if (text_decoder_read(codepoint,&decoder)<1) return p;
+    return p+decoder.p;
+  }
+  int64_t start=p-TEXTEDIT_STEP_LIMIT;
+  if (start<0) start=0;
+  decoder.c=decoder.p=doc_read(tmp,p-start,WIDGET->doc,start);
+  if (text_decoder_unread(codepoint,&decoder)<1) return p;
+  return start+decoder.p;
+}
+
+/* Mark cached rows dirty.
+ */
+
+static void textedit_invalidate_all(struct widget *widget) {
+  int i=WIDGET->slotc;
+  while (i-->0) WIDGET->slotv[i].line=-1;
+}
+
+static void textedit_invalidate_lines(struct widget *widget,int64_t a,int64_t z) {
+  int i=WIDGET->slotc;
+  while (i-->0) {
+    if ((WIDGET->slotv[i].line>=a)&&(WIDGET->slotv[i].line<=z)) WIDGET->slotv[i].line=-1;
+  }
+}
+
+// Every line touched by the range (p..p+c), which may be empty.
+static void textedit_invalidate_range(struct widget *widget,int64_t p,int64_t c) {
+  if (c<0) {
+    p+=c;
+    c=-c;
+  }
+  int64_t a=doc_line_from_offset(WIDGET->doc,p);
+  int64_t z=c?doc_line_from_offset(WIDGET->doc,p+c):a;
+  textedit_invalidate_lines(widget,a,z);
+}
+
+/* Lines (line..z) were replaced by (line..z+d), and everything after moved by (d) lines.
+ * Renumber the cached rows below, so render can move them instead of drawing again, and dirty the replaced ones.
+ */
+
+static void textedit_lines_moved(struct widget *widget,int64_t line,int64_t z,int64_t d) {
+  int i=WIDGET->slotc;
+  while (i-->0) {
+    struct textedit_slot *slot=WIDGET->slotv+i;
+    if (slot->line<line) continue;
+    if (slot->line<=z) slot->line=-1;
+    else slot->line+=d;
+  }
+}
+
+/* Scroll.
+ * Vertical only changes where we start, and render moves the rows already drawn.
+ * Horizontal changes every row.
+ */
+
+static int textedit_count_full_rows(const struct widget *widget) {
+  if (WIDGET->rowh<1) return 1;
+  int c=widget->h/WIDGET->rowh;
+  return (c<1)?1:c;
+}
+
+static void textedit_set_top(struct widget *widget,int64_t line,int sub) {
+  int fullrows=textedit_count_full_rows(widget);
+  if (line<0) {
+    line=0;
+    sub=0;
+  }
+  int64_t linec=textedit_require_lines(widget,line+fullrows);
+  if (line>=linec) {
+    line=linec-1;
+    sub=INT_MAX;
+  }
+  if (sub<0) sub=0;
+  else {
+    int rowc=textedit_line_rows(widget,line);
+    if (sub>=rowc) sub=rowc-1;
+  }
+  // Don't scroll past the end. We know of at least (fullrows) lines after this one unless it's near the end, so that's exact when it matters.
+  int64_t limit=textedit_count_rows(widget)-fullrows;
+  if (limit<0) limit=0;
+  if (textedit_row_from_line(widget,line,sub)>limit) line=textedit_line_from_row(&sub,widget,limit);
+  if ((line==WIDGET->topline)&&(sub==WIDGET->topsub)) return;
+  WIDGET->topline=line;
+  WIDGET->topsub=sub;
+  widget->ctx->render_soon=1;
+}
+
+static void textedit_scroll_rows(struct widget *widget,int64_t d) {
+  int64_t row=textedit_row_from_line(widget,WIDGET->topline,WIDGET->topsub)+d;
+  if (row<0) row=0;
+  int sub;
+  int64_t line=textedit_line_from_row(&sub,widget,row);
+  textedit_set_top(widget,line,sub);
+}
+
+static void textedit_set_scrollx(struct widget *widget,int scrollx) {
+  if ((scrollx<0)||WIDGET->wrap) scrollx=0;
+  if (scrollx==WIDGET->scrollx) return;
+  WIDGET->scrollx=scrollx;
+  textedit_invalidate_all(widget);
+  widget->ctx->render_soon=1;
+}
+
+// Bring the business end of the selection into view.
+static void textedit_show_cursor(struct widget *widget) {
+  int64_t line;
+  int sub,x;
+  textedit_position(&line,&sub,&x,widget,WIDGET->selp);
+  int rowc=textedit_count_full_rows(widget);
+  int64_t row=textedit_row_from_line(widget,line,sub);
+  int64_t toprow=textedit_row_from_line(widget,WIDGET->topline,WIDGET->topsub);
+  if (row<toprow) textedit_set_top(widget,line,sub);
+  else if (row>=toprow+rowc) textedit_scroll_rows(widget,row-rowc+1-toprow);
+  if (WIDGET->wrap) return;
+  int textw=widget->w-(widget->padx<<1);
+  int glyphw=font_get_width(WIDGET->font);
+  if (x<WIDGET->scrollx) textedit_set_scrollx(widget,x-(textw>>2));
+  else if (x>WIDGET->scrollx+textw-glyphw) textedit_set_scrollx(widget,x-textw+(textw>>2));
+}
+
+/* Soft wrap.
+ * Whenever the width changes, every count in the index becomes a guess.
+ * Render measures the visible lines, and an idle job measures the rest, so scroll positions converge on the truth.
+ */
+
+static int textedit_wrap_idle(struct widget *widget,void *userdata) {
+  if (!WIDGET->wrap) {
+    WIDGET->wrapjob=0;
+    return 0;
+  }
+  int line=font_wrap_index_next_stale(&WIDGET->wrapindex,0);
+  int64_t ls=-1;
+  while (line>=0) {
+    if (ls<0) ls=doc_offset_from_line(WIDGET->doc,line);
+    int64_t le=textedit_line_end(widget,line,ls);
+    const char *src;
+    int srcc=textedit_line_text(&src,widget,ls,le);
+    font_wrap_index_set(&WIDGET->wrapindex,line,font_wrap_line(0,0,WIDGET->font,src,srcc,WIDGET->wrapw));
+    int next=font_wrap_index_next_stale(&WIDGET->wrapindex,line+1);
+    ls=(next==line+1)?(le+1):-1;
+    line=next;
+    if ((line>=0)&&gui_idle_yield(widget->ctx)) return 1;
+  }
+  WIDGET->wrapjob=0;
+  return 0;
+}
+
+static void textedit_start_wrap_job(struct widget *widget) {
+  if (WIDGET->wrapjob) return;
+  int taskid=gui_add_idle_job(widget,textedit_wrap_idle,0);
+  if (taskid>0) WIDGET->wrapjob=taskid;
+}
+
+static void textedit_require_wrap(struct widget *widget) {
+  if (!WIDGET->wrap) return;
+  int w=widget->w-(widget->padx<<1);
+  if (w<1) w=1;
+  if (w==WIDGET->wrapw) return;
+  WIDGET->wrapw=w;
+  font_wrap_index_invalidate(&WIDGET->wrapindex);
+  textedit_invalidate_all(widget);
+  textedit_start_wrap_job(widget);
+}
+
+// Start the index over, eg for a new doc. Fails if the doc has too many lines, then wrap must be off.
+static int textedit_reset_wrap(struct widget *widget) {
+  if (WIDGET->linec>INT_MAX) return -1;
+  if (font_wrap_index_reset(&WIDGET->wrapindex,WIDGET->linec)<0) return -1;
+  WIDGET->wrapw=0;
+  textedit_require_wrap(widget);
+  return 0;
+}
+
+// Turn wrap off without moving anything yet. Caller should clamp the top and show the cursor when it can.
+static void textedit_drop_wrap(struct widget *widget) {
+  WIDGET->wrap=0;
+  font_wrap_index_cleanup(&WIDGET->wrapindex);
+  if (WIDGET->wrapjob) {
+    gui_cancel_task(widget->ctx,WIDGET->wrapjob);
+    WIDGET->wrapjob=0;
+  }
+  WIDGET->topsub=0;
+  textedit_invalidate_all(widget);
+  widget->ctx->render_soon=1;
+}
+
+/* Change selection, redrawing only the lines whose highlight changes.
+ */
+
+static void textedit_select(struct widget *widget,int64_t p,int64_t c) {
+  int64_t len=doc_get_length(WIDGET->doc);
+  if (p<0) p=0; else if (p>len) p=len;
+  if (p+c<0) c=-p; else if (p+c>len) c=len-p;
+  if ((p==WIDGET->selp)&&(c==WIDGET->selc)) return;
+  textedit_invalidate_range(widget,WIDGET->selp,WIDGET->selc);
+  textedit_invalidate_range(widget,p,c);
+  WIDGET->selp=p;
+  WIDGET->selc=c;
+  widget->ctx->render_soon=1;
+}
+
+/* Count the doc's newlines on the pool.
+ * Until it's done, lookups count as they go. After, everything about lines is quick, and we learn the real line count.
+ */
+
+static int textedit_census_cb(void *userdata) {
+  return doc_census_run(userdata);
+}
+
+static void textedit_census_done(struct widget *widget,int jobid,int status,void *userdata) {
+  struct doc_census *census=userdata;
+  if (jobid==WIDGET->censusjob) {
+    WIDGET->censusjob=0;
+    if ((status>=0)&&(doc_census_get_doc(census)==WIDGET->doc)) {
+      doc_census_apply(census);
+      textedit_require_lines(widget,WIDGET->linec);
+      if (WIDGET->wrap&&WIDGET->wrapw) textedit_start_wrap_job(widget);
+      textedit_set_top(widget,WIDGET->topline,WIDGET->topsub);
+      widget->ctx->render_soon=1;
+    }
+  }
+  doc_census_del(census);
+}
+
+static void textedit_start_census(struct widget *widget) {
+  if (WIDGET->censusjob) {
+    gui_cancel_background(widget->ctx,WIDGET->censusjob);
+    WIDGET->censusjob=0;
+  }
+  if (doc_lines_counted(WIDGET->doc)) return;
+  struct doc_census *census=doc_census_new(WIDGET->doc,gui_get_pool(widget->ctx));
+  if (!census) return;
+  int jobid=gui_run_in_background(widget->ctx,widget,textedit_census_cb,textedit_census_done,census);
+  if (jobid<=0) {
+    doc_census_del(census);
+    return;
+  }
+  WIDGET->censusjob=jobid;
 }
 
 /* Init.
  */
- 
+
 static int _textedit_init(struct widget *widget,const void *args,int argslen) {
-  widget->bgcolor=0x40404040;
+  if (argslen==sizeof(struct widget_args_textedit)) {
+    const struct widget_args_textedit *ARGS=args;
+    if (ARGS->doc&&(widget_textedit_set_doc(widget,ARGS->doc)<0)) return -1;
+    if (ARGS->font&&(widget_textedit_set_font(widget,ARGS->font)<0)) return -1;
+    WIDGET->userdata=ARGS->userdata;
+    WIDGET->cb_postedit=ARGS->cb_postedit;
+    if (ARGS->wrap) WIDGET->wrap=1;
+  }
+  if (!WIDGET->doc&&!(WIDGET->doc=doc_new())) return -1;
+  if (!WIDGET->font&&(widget_textedit_set_font(widget,gui_get_default_font(widget->ctx))<0)) return -1;
+  widget->bgcolor=        wm_pixel_from_rgbx(0xffffffff);
+  WIDGET->fgcolor=        wm_pixel_from_rgbx(0x000000ff);
+  WIDGET->highlight_color=wm_pixel_from_rgbx(0x40c0ffff);
+  WIDGET->cursor_color=   wm_pixel_from_rgbx(0x000000ff);
+  widget->padx=gui_scale(widget->ctx,3);
+  widget->focusable=1;
+  widget->rawmouse=1;
+  WIDGET->goalx=-1;
+  if (WIDGET->wrap) {
+    WIDGET->wrap=0;
+    if (widget_textedit_set_wrap(widget,1)<0) return -1;
+  }
   return 0;
 }
 
+/* Measure.
+ */
+
+static void _textedit_measure(int *w,int *h,struct widget *widget,int maxw,int maxh) {
+  *w=font_get_width(WIDGET->font)*80+(widget->padx<<1);
+  *h=WIDGET->rowh*25;
+}
+
+/* Pack.
+ */
+
+static void _textedit_pack(struct widget *widget) {
+  textedit_require_wrap(widget);
+  textedit_set_top(widget,WIDGET->topline,WIDGET->topsub);
+}
+
+/* Resize the row cache to our bounds if needed, dropping everything in it.
+ */
+
+static int textedit_require_cache(struct widget *widget) {
+  if (WIDGET->rowh<1) return -1;
+  int slotc=(widget->h+WIDGET->rowh-1)/WIDGET->rowh;
+  if ((WIDGET->cachew==widget->w)&&(WIDGET->slotc==slotc)&&WIDGET->cachev) return 0;
+  if ((widget->w<1)||(slotc<1)) return -1;
+  if (slotc>INT_MAX/WIDGET->rowh) return -1;
+  if (widget->w>INT_MAX/sizeof(uint32_t)/(slotc*WIDGET->rowh)) return -1;
+  void *nv=malloc(sizeof(uint32_t)*widget->w*slotc*WIDGET->rowh);
+  void *nslotv=malloc(sizeof(struct textedit_slot)*slotc);
+  void *nwantv=malloc(sizeof(struct textedit_slot)*slotc);
+  void *nsrcv=malloc(sizeof(int)*slotc);
+  if (!nv||!nslotv||!nwantv||!nsrcv) {
+    if (nv) free(nv);
+    if (nslotv) free(nslotv);
+    if (nwantv) free(nwantv);
+    if (nsrcv) free(nsrcv);
+    return -1;
+  }
+  if (WIDGET->cachev) free(WIDGET->cachev);
+  if (WIDGET->slotv) free(WIDGET->slotv);
+  if (WIDGET->wantv) free(WIDGET->wantv);
+  if (WIDGET->srcv) free(WIDGET->srcv);
+  WIDGET->cachev=nv;
+  WIDGET->slotv=nslotv;
+  WIDGET->wantv=nwantv;
+  WIDGET->srcv=nsrcv;
+  WIDGET->cachew=widget->w;
+  WIDGET->slotc=slotc;
+  textedit_invalidate_all(widget);
+  return 0;
+}
+
+/* Draw one row's text, which starts at (srcx) in the row.
+ * Skip what's scrolled off the left, and stop after the last glyph that shows.
+ */
+
+static void textedit_render_text(struct image *row,struct widget *widget,int srcx,const char *src,int srcc) {
+  int x=widget->padx-WIDGET->scrollx+srcx;
+  int skip=WIDGET->scrollx-srcx;
+  int p=0;
+  if (skip>0) {
+    p=font_locate_point(WIDGET->font,src,srcc,skip);
+    int px=font_measure_string(WIDGET->font,src,p);
+    if (px>skip) {
+      struct text_decoder decoder={.v=src,.c=srcc,.p=p,.encoding=widget->ctx->encoding};
+      int codepoint;
+      text_decoder_unread(&codepoint,&decoder);
+      p=decoder.p;
+      px=font_measure_string(WIDGET->font,src,p);
+    }
+    x+=px;
+  }
+  struct text_decoder decoder={
+    .v=src,
+    .c=srcc,
+    .p=p+font_locate_point(WIDGET->font,src+p,srcc-p,row->w-x),
+    .encoding=widget->ctx->encoding,
+  };
+  int codepoint;
+  text_decoder_read(&codepoint,&decoder);
+  font_set_color_normal(WIDGET->font,WIDGET->fgcolor);
+  font_render_string(row,x,0,WIDGET->font,src+p,decoder.p-p);
+}
+
+/* Horizontal position of (p) in a row whose text we have from (srcp), at (srcx).
+ * Outside that is off screen, so the edges are close enough: (srcx) before it, and (limit) after.
+ */
+
+static int textedit_row_x(struct widget *widget,int64_t p,int64_t srcp,int srcx,const char *src,int srcc,int limit) {
+  if (p<=srcp) return srcx;
+  if (p>srcp+srcc) return limit;
+  return srcx+font_measure_string(WIDGET->font,src,p-srcp);
+}
+
+/* Draw one slot of the cache, for the row (rs..re).
+ * (rs<0) for a blank row past the end of the document.
+ * (src,srcc) is the row's text, or for a long line just the visible part, starting at (srcp) and (srcx) in the row.
+ * (last) if this is the line's last row, ie it ends at the LF.
+ */
+
+static void textedit_render_row(struct widget *widget,int slotp,int64_t rs,int64_t re,int64_t srcp,int srcx,const char *src,int srcc,int last) {
+  struct image row={
+    .v=WIDGET->cachev+slotp*WIDGET->rowh*WIDGET->cachew,
+    .w=WIDGET->cachew,
+    .h=WIDGET->rowh,
+    .stride=WIDGET->cachew<<2,
+    .pixelsize=32,
+    .writeable=1,
+  };
+  image_fill_rect(&row,0,0,row.w,row.h,widget->bgcolor);
+  if (rs<0) return;
+  int x0=widget->padx-WIDGET->scrollx;
+
+  // Selection, extending to the right edge if it continues beyond our text. Or the cursor if it's in this row.
+  int64_t a=WIDGET->selp,z=WIDGET->selp+WIDGET->selc;
+  if (a>z) { int64_t tmp=a; a=z; z=tmp; }
+  if (a<z) {
+    if ((z>rs)&&((a<re)||(last&&(a==re)))) {
+      int xa=textedit_row_x(widget,a,srcp,srcx,src,srcc,row.w-x0);
+      int xz=(z>re)?(row.w-x0):textedit_row_x(widget,z,srcp,srcx,src,srcc,row.w-x0);
+      image_fill_rect(&row,x0+xa,0,xz-xa,row.h,WIDGET->highlight_color);
+    }
+  } else if ((a>=rs)&&((a<re)||(last&&(a==re)))) {
+    image_fill_rect(&row,x0+textedit_row_x(widget,a,srcp,srcx,src,srcc,row.w-x0),0,1,row.h,WIDGET->cursor_color);
+  }
+
+  textedit_render_text(&row,widget,srcx,src,srcc);
+}
+
+/* Draw a long line, without wrap: Read just the part from the checkpoint left of our view to the one right of it.
+ * Left of the view includes the padding, so anything before what we read is off screen.
+ */
+
+static void textedit_render_long_line(struct widget *widget,int slotp,const struct font_line_index *index,int64_t ls,int64_t le) {
+  int ap,ac,zp,zc;
+  int ax=font_line_index_span_x(&ap,&ac,index,WIDGET->scrollx-widget->padx);
+  font_line_index_span_x(&zp,&zc,index,WIDGET->scrollx+widget->w);
+  int64_t z=ls+zp+zc+TEXTEDIT_STEP_LIMIT; // One more glyph than shows, in case it hangs in from the right.
+  if (z>le) z=le;
+  const char *src;
+  int srcc=textedit_line_text(&src,widget,ls+ap,z);
+  textedit_render_row(widget,slotp,ls,le,ls+ap,ax,src,srcc,1);
+}
+
+/* Copy the cache into (dst), which may be clipped: (x0,y0) say how far our origin sits outside it.
+ */
+
+static void textedit_blit(struct image *dst,struct widget *widget) {
+  int srcx=-dst->x0,srcy=-dst->y0;
+  int w=dst->w,h=dst->h;
+  if (w>WIDGET->cachew-srcx) w=WIDGET->cachew-srcx;
+  if (h>widget->h-srcy) h=widget->h-srcy;
+  if ((w<1)||(h<1)) return;
+  const uint32_t *src=WIDGET->cachev+srcy*WIDGET->cachew+srcx;
+  uint8_t *dstrow=dst->v;
+  for (;h-->0;src+=WIDGET->cachew,dstrow+=dst->stride) {
+    memcpy(dstrow,src,sizeof(uint32_t)*w);
+  }
+}
+
 /* Render.
+ * First list the row that belongs in each slot, then find any that are already drawn in another slot.
+ * Both lists are in order, so one pass matches them, and the sources move monotonically too:
+ * Copying the ones that move up in ascending order, then the ones that move down in descending order, never overwrites a source before it's read.
+ * Consecutive dirty rows find each line's start from the previous line's end, so drawing them all is one pass over the visible text.
  */
- 
+
+#define TEXTEDIT_SLOT_EQ(a,b) (((a).line==(b).line)&&((a).sub==(b).sub))
+#define TEXTEDIT_SLOT_LT(a,b) (((a).line<(b).line)||(((a).line==(b).line)&&((a).sub<(b).sub)))
+
 static void _textedit_render(struct widget *widget,struct image *dst) {
-  //image_fill_rect(dst,0,0,widget->w,widget->h,0);
-  //image_fill_rect(dst,10-widget->scrollx,10-widget->scrolly,90,40,0xffffffff);
-  //TODO
+  if ((dst->pixelsize!=32)||(dst->stride&3)||!dst->writeable) return;
+  if (textedit_require_cache(widget)<0) return;
+  if (widget->bgcolor!=WIDGET->cachebg) {
+    WIDGET->cachebg=widget->bgcolor;
+    textedit_invalidate_all(widget);
+  }
+  textedit_require_wrap(widget);
+  int64_t linec=textedit_require_lines(widget,WIDGET->topline+WIDGET->slotc); // Enough to fill every slot, even without wrap.
+  int slotc=WIDGET->slotc,i;
+  struct textedit_slot *slotv=WIDGET->slotv,*wantv=WIDGET->wantv;
+  int *srcv=WIDGET->srcv;
+
+  // What belongs where. Our top row might have been a guess, so clamp it once the line is measured.
+  if (WIDGET->topline<linec) {
+    int rowc=textedit_line_rows(widget,WIDGET->topline);
+    if (WIDGET->topsub>=rowc) WIDGET->topsub=rowc-1;
+  }
+  int64_t line=WIDGET->topline;
+  int sub=WIDGET->topsub;
+  for (i=0;i<slotc;i++) {
+    wantv[i].line=line;
+    wantv[i].sub=sub;
+    if ((line>=linec)||(++sub>=textedit_line_rows(widget,line))) {
+      line++;
+      sub=0;
+    }
+  }
+
+  // Where it already is.
+  int j=0;
+  for (i=0;i<slotc;i++) {
+    srcv[i]=-1;
+    if (TEXTEDIT_SLOT_EQ(slotv[i],wantv[i])) continue;
+    while ((j<slotc)&&((slotv[j].line<0)||TEXTEDIT_SLOT_LT(slotv[j],wantv[i]))) j++;
+    if ((j<slotc)&&TEXTEDIT_SLOT_EQ(slotv[j],wantv[i])) srcv[i]=j;
+  }
+
+  // Move it.
+  int rowsize=WIDGET->cachew*WIDGET->rowh;
+  for (i=0;i<slotc;i++) {
+    if (srcv[i]<=i) continue;
+    memcpy(WIDGET->cachev+i*rowsize,WIDGET->cachev+srcv[i]*rowsize,sizeof(uint32_t)*rowsize);
+    slotv[i]=wantv[i];
+  }
+  for (i=slotc;i-->0;) {
+    if ((srcv[i]<0)||(srcv[i]>=i)) continue;
+    memcpy(WIDGET->cachev+i*rowsize,WIDGET->cachev+srcv[i]*rowsize,sizeof(uint32_t)*rowsize);
+    slotv[i]=wantv[i];
+  }
+
+  // Draw the rest.
+  int64_t curline=-1,ls=-1,le=-1;
+  const char *src=0;
+  int srcc=0,rowc=1;
+  for (i=0;i<slotc;i++) {
+    if (TEXTEDIT_SLOT_EQ(slotv[i],wantv[i])) continue;
+    slotv[i]=wantv[i];
+    if (wantv[i].line>=linec) {
+      textedit_render_row(widget,i,-1,-1,-1,0,0,0,0);
+      continue;
+    }
+    if (wantv[i].line!=curline) {
+      if ((curline>=0)&&(wantv[i].line==curline+1)) ls=le+1;
+      else ls=doc_offset_from_line(WIDGET->doc,wantv[i].line);
+      curline=wantv[i].line;
+      le=textedit_line_end(widget,curline,ls);
+      struct font_line_index *index=textedit_require_line_index(widget,ls,le);
+      if (index) {
+        textedit_render_long_line(widget,i,index,ls,le);
+        continue;
+      }
+      srcc=textedit_line_text(&src,widget,ls,le);
+      rowc=textedit_row_breaks(widget,curline,src,srcc);
+    }
+    int segp,segc;
+    textedit_row_span(&segp,&segc,widget,wantv[i].sub,rowc,srcc);
+    textedit_render_row(widget,i,ls+segp,ls+segp+segc,ls+segp,0,src+segp,segc,wantv[i].sub>=rowc-1);
+  }
+  textedit_blit(dst,widget);
+}
+
+/* Focus.
+ */
+
+static void _textedit_focus(struct widget *widget,int focus) {
+  WIDGET->focus=focus;
+}
+
+/* Keystroke.
+ */
+
+static int _textedit_key(struct widget *widget,int keycode,int value,int codepoint) {
+  if (value) {
+    int ctl=(widget->ctx->modifiers&GUI_MOD_CTL);
+    switch (keycode) {
+      case 0x0007001c: if (ctl) { widget_textedit_redo(widget); return 1; } break; // Y
+      case 0x0007001d: if (ctl) { // Z
+          if (widget->ctx->modifiers&GUI_MOD_SHIFT) widget_textedit_redo(widget);
+          else widget_textedit_undo(widget);
+          return 1;
+        } break;
+      case 0x00070028: widget_textedit_insert_codepoint(widget,0x0a); return 1; // Enter
+      case 0x00070029: break; // Escape
+      case 0x0007002a: widget_textedit_backspace(widget); return 1; // Backspace
+      case 0x00070049: break; // Insert
+      case 0x0007004a: widget_textedit_move_to_edge(widget,ctl?-2:-1); return 1; // Home
+      case 0x0007004b: { // Page Up
+          int rowc=textedit_count_full_rows(widget);
+          textedit_scroll_rows(widget,-rowc);
+          widget_textedit_move_cursor(widget,0,-rowc);
+        } return 1;
+      case 0x0007004c: widget_textedit_delete(widget); return 1; // Delete
+      case 0x0007004d: widget_textedit_move_to_edge(widget,ctl?2:1); return 1; // End
+      case 0x0007004e: { // Page Down
+          int rowc=textedit_count_full_rows(widget);
+          textedit_scroll_rows(widget,rowc);
+          widget_textedit_move_cursor(widget,0,rowc);
+        } return 1;
+      case 0x0007004f: widget_textedit_move_cursor(widget,1,0); return 1; // Right
+      case 0x00070050: widget_textedit_move_cursor(widget,-1,0); return 1; // Left
+      case 0x00070051: widget_textedit_move_cursor(widget,0,1); return 1; // Down
+      case 0x00070052: widget_textedit_move_cursor(widget,0,-1); return 1; // Up
+    }
+  }
+  if (value&&codepoint) {
+    if (codepoint<0x20) {
+      // Reject C0. Enter is handled above, by keycode.
+    } else if ((codepoint>=0x7f)&&(codepoint<0xa0)) {
+      // Reject C1.
+    } else {
+      widget_textedit_insert_codepoint(widget,codepoint);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Document position nearest a point in local space.
+ */
+
+static int64_t textedit_locate(struct widget *widget,int x,int y) {
+  int64_t row=textedit_row_from_line(widget,WIDGET->topline,WIDGET->topsub)+((y<0)?-1:(y/WIDGET->rowh));
+  if (row<0) return 0;
+  int sub;
+  int64_t line=textedit_line_from_row(&sub,widget,row);
+  if (row>=textedit_count_rows(widget)) return doc_get_length(WIDGET->doc);
+  int64_t ls,le;
+  textedit_line_bounds(&ls,&le,widget,line);
+  return textedit_locate_in_line(widget,line,ls,le,sub,x-widget->padx+WIDGET->scrollx);
+}
+
+/* Mouse.
+ */
+
+static int _textedit_mmotion(struct widget *widget,int mx,int my) {
+  if (WIDGET->dragging) {
+    widget_coords_local_from_global(&mx,&my,widget);
+    int64_t p=textedit_locate(widget,mx,my);
+    // Same as widget_field: The dragging end is (selp) and the anchor (selp+selc).
+    int64_t anchor=WIDGET->selp+WIDGET->selc;
+    if (p!=WIDGET->selp) {
+      textedit_select(widget,p,anchor-p);
+      WIDGET->goalx=-1;
+      textedit_show_cursor(widget);
+    }
+  }
+  return 1;
+}
+
+static int _textedit_mbutton(struct widget *widget,int btnid,int value,int mx,int my) {
+  if (btnid!=1) return 0;
+  if (!value) {
+    WIDGET->dragging=0;
+    return 1;
+  }
+  gui_focus_widget(widget->ctx,widget);
+  widget_coords_local_from_global(&mx,&my,widget);
+  int64_t p=textedit_locate(widget,mx,my);
+  double now=gui_now_real();
+  if (now-WIDGET->click_time<=widget->ctx->double_click_interval) {
+    widget_textedit_select_word(widget,p);
+    return 1;
+  }
+  WIDGET->click_time=now;
+  textedit_select(widget,p,0);
+  WIDGET->goalx=-1;
+  WIDGET->dragging=1;
+  return 1;
+}
+
+static int _textedit_mwheel(struct widget *widget,int dx,int dy,int mx,int my) {
+  if (dy) textedit_scroll_rows(widget,dy*TEXTEDIT_WHEEL_ROWS);
+  if (dx) textedit_set_scrollx(widget,WIDGET->scrollx+dx*TEXTEDIT_WHEEL_ROWS*font_get_width(WIDGET->font));
+  return 1;
 }
 
 /* Type definition.
  */
- 
+
 const struct widget_type widget_type_textedit={
-  .name="texedit",
+  .name="textedit",
   .objlen=sizeof(struct widget_textedit),
   .del=_textedit_del,
   .init=_textedit_init,
+  .measure=_textedit_measure,
+  .pack=_textedit_pack,
   .render=_textedit_render,
-  .autorender=1,
+  .focus=_textedit_focus,
+  .key=_textedit_key,
+  .mmotion=_textedit_mmotion,
+  .mbutton=_textedit_mbutton,
+  .mwheel=_textedit_mwheel,
 };
+
+/* Public accessors.
+ */
+
+struct doc *widget_textedit_get_doc(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return 0;
+  return WIDGET->doc;
+}
+
+int widget_textedit_set_doc(struct widget *widget,struct doc *doc) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  if (doc_ref(doc)<0) return -1;
+  doc_del(WIDGET->doc);
+  WIDGET->doc=doc;
+  WIDGET->linec=0;
+  textedit_drop_line_indexes(widget);
+  textedit_start_census(widget);
+  WIDGET->selp=0;
+  WIDGET->selc=0;
+  WIDGET->topline=0;
+  WIDGET->topsub=0;
+  WIDGET->scrollx=0;
+  WIDGET->goalx=-1;
+  text_undo_clear(&WIDGET->undo);
+  if (WIDGET->wrap&&(textedit_reset_wrap(widget)<0)) widget_textedit_set_wrap(widget,0);
+  textedit_invalidate_all(widget);
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+int widget_textedit_set_font(struct widget *widget,struct font *font) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  if (font_ref(font)<0) return -1;
+  font_del(WIDGET->font);
+  WIDGET->font=font;
+  WIDGET->rowh=font_get_height(font);
+  WIDGET->goalx=-1;
+  WIDGET->wrapw=0;
+  textedit_drop_line_indexes(widget);
+  textedit_invalidate_all(widget);
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+int widget_textedit_get_wrap(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return 0;
+  return WIDGET->wrap;
+}
+
+int widget_textedit_set_wrap(struct widget *widget,int wrap) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  wrap=wrap?1:0;
+  if (wrap==WIDGET->wrap) return 0;
+  if (wrap) {
+    WIDGET->wrap=1;
+    if (textedit_reset_wrap(widget)<0) {
+      WIDGET->wrap=0;
+      return -1;
+    }
+    WIDGET->scrollx=0;
+  } else {
+    textedit_drop_wrap(widget);
+  }
+  WIDGET->goalx=-1;
+  textedit_invalidate_all(widget);
+  textedit_set_top(widget,WIDGET->topline,WIDGET->topsub);
+  textedit_show_cursor(widget);
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+void *widget_textedit_get_userdata(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return 0;
+  return WIDGET->userdata;
+}
+
+int widget_textedit_set_userdata(struct widget *widget,void *userdata) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  WIDGET->userdata=userdata;
+  return 0;
+}
+
+int64_t widget_textedit_get_selection(int64_t *p,const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return 0;
+  int64_t sp=WIDGET->selp,sc=WIDGET->selc;
+  if (sc<0) {
+    sp+=sc;
+    sc=-sc;
+  }
+  if (p) *p=sp;
+  return sc;
+}
+
+int widget_textedit_set_selection(struct widget *widget,int64_t p,int64_t c) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  int64_t len=doc_get_length(WIDGET->doc);
+  if (p<0) p=0; else if (p>len) p=len;
+  if ((c<0)||(p>len-c)) c=len-p;
+  textedit_select(widget,p,c);
+  WIDGET->goalx=-1;
+  textedit_show_cursor(widget);
+  return 0;
+}
+
+/* Words, by widget_field's definition.
+ */
+
+static int textedit_wordchar(int codepoint) {
+  if ((codepoint>=0x30)&&(codepoint<=0x39)) return 1;
+  if ((codepoint>=0x41)&&(codepoint<=0x5a)) return 1;
+  if ((codepoint>=0x61)&&(codepoint<=0x7a)) return 1;
+  return 0;
+}
+
+static int64_t textedit_step_word(struct widget *widget,int64_t p,int d) {
+  int lead=1;
+  for (;;) {
+    int codepoint;
+    int64_t np=textedit_step(&codepoint,widget,p,d);
+    if (np==p) return p;
+    if (textedit_wordchar(codepoint)) lead=0;
+    else if (!lead) return p;
+    p=np;
+  }
+}
+
+int widget_textedit_select_word(struct widget *widget,int64_t p) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  int64_t a=p,z=p;
+  for (;;) {
+    int codepoint;
+    int64_t np=textedit_step(&codepoint,widget,a,-1);
+    if ((np==a)||!textedit_wordchar(codepoint)) break;
+    a=np;
+  }
+  for (;;) {
+    int codepoint;
+    int64_t np=textedit_step(&codepoint,widget,z,1);
+    if ((np==z)||!textedit_wordchar(codepoint)) break;
+    z=np;
+  }
+  return widget_textedit_set_selection(widget,a,z-a);
+}
+
+/* Move cursor.
+ * With Shift, the new selection runs from the new cursor to the far end of the old selection.
+ */
+
+static void textedit_move_to(struct widget *widget,int64_t p) {
+  int64_t anchor=WIDGET->selp+WIDGET->selc;
+  if (widget->ctx->modifiers&GUI_MOD_SHIFT) textedit_select(widget,p,anchor-p);
+  else textedit_select(widget,p,0);
+  textedit_show_cursor(widget);
+}
+
+int widget_textedit_move_cursor(struct widget *widget,int dx,int dy) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  int shift=(widget->ctx->modifiers&GUI_MOD_SHIFT);
+
+  if (dy) {
+    int64_t line;
+    int sub,x;
+    textedit_position(&line,&sub,&x,widget,WIDGET->selp);
+    if (WIDGET->goalx<0) WIDGET->goalx=x;
+    int goalx=WIDGET->goalx;
+    line=textedit_line_from_row(&sub,widget,textedit_row_from_line(widget,line,sub)+dy);
+    int64_t ls,le;
+    textedit_line_bounds(&ls,&le,widget,line);
+    textedit_move_to(widget,textedit_locate_in_line(widget,line,ls,le,sub,goalx));
+    WIDGET->goalx=goalx;
+    return 0;
+  }
+
+  if (!dx) return 0;
+  WIDGET->goalx=-1;
+  if (WIDGET->selc&&!shift) {
+    // There was a selection. First move releases it and leaves cursor on the indicated edge.
+    int64_t p=WIDGET->selp;
+    if ((dx<0)&&(WIDGET->selc<0)) p+=WIDGET->selc;
+    else if ((dx>0)&&(WIDGET->selc>0)) p+=WIDGET->selc;
+    textedit_move_to(widget,p);
+  } else if (widget->ctx->modifiers&GUI_MOD_CTL) {
+    textedit_move_to(widget,textedit_step_word(widget,WIDGET->selp,dx));
+  } else {
+    textedit_move_to(widget,textedit_step(0,widget,WIDGET->selp,dx));
+  }
+  return 0;
+}
+
+int widget_textedit_move_to_edge(struct widget *widget,int d) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  WIDGET->goalx=-1;
+  if (d<=-2) {
+    textedit_move_to(widget,0);
+  } else if (d>=2) {
+    textedit_move_to(widget,doc_get_length(WIDGET->doc));
+  } else if (d) {
+    int64_t ls,le;
+    textedit_line_bounds(&ls,&le,widget,doc_line_from_offset(WIDGET->doc,WIDGET->selp));
+    textedit_move_to(widget,(d<0)?ls:le);
+  }
+  return 0;
+}
+
+/* Keep the long lines' indexes current after (c) bytes at (p) became (srcc) new ones.
+ * Edits before a line only move it. Edits within it, that don't add or remove an LF, patch it from a window around the edit.
+ * Anything else and we drop it, to build again if it's needed.
+ */
+
+static void textedit_line_index_edit(struct widget *widget,int64_t p,int64_t c,int srcc,int within) {
+  int i=WIDGET->lineindexc;
+  while (i-->0) {
+    struct textedit_line_index *entry=WIDGET->lineindexv+i;
+    struct font_line_index *index=&entry->index;
+    int64_t ls=entry->ls,le=ls+index->srcc;
+    if (p+c<ls) {
+      entry->ls+=srcc-c;
+      continue;
+    }
+    if (p>le) continue;
+    if (!within||(p<ls)||(p+c>le)) {
+      textedit_drop_line_index(widget,i);
+      continue;
+    }
+    int len=index->srcc-c+srcc;
+    int interval=index->interval?index->interval:FONT_LINE_INDEX_INTERVAL_DEFAULT;
+    int64_t a=p-(interval<<1),z=p+srcc+(interval<<1);
+    if (a<ls) a=ls;
+    if (z>ls+len) z=ls+len;
+    const char *src;
+    int winc=textedit_line_text(&src,widget,a,z);
+    font_line_index_replace_window(index,WIDGET->font,src,winc,a-ls,len,p-ls,c,srcc);
+    if (!index->c) textedit_drop_line_index(widget,i);
+  }
+}
+
+/* Edit.
+ * If the edit adds or removes an LF, every line below moves, and we renumber their cached rows instead of redrawing them.
+ * Everything comes through textedit_apply. Only undo and redo call it directly; the rest record themselves in (undo) first.
+ */
+
+static int textedit_apply(struct widget *widget,int64_t p,int64_t c,const char *src,int srcc) {
+  int64_t line=doc_line_from_offset(WIDGET->doc,p);
+  int64_t z=c?doc_line_from_offset(WIDGET->doc,p+c):line;
+  int64_t d=(srcc?sr_count_newlines(src,srcc):0)-(z-line);
+  textedit_require_lines(widget,z);
+  textedit_invalidate_range(widget,WIDGET->selp,WIDGET->selc);
+  if (doc_replace(WIDGET->doc,p,c,src,srcc)<0) return -1;
+  textedit_line_index_edit(widget,p,c,srcc,(z==line)&&!d);
+  WIDGET->linec+=d;
+  textedit_lines_moved(widget,line,z,d);
+  if (WIDGET->wrap&&(font_wrap_index_replace(&WIDGET->wrapindex,line,z-line+1,z-line+1+d)<0)) {
+    if (textedit_reset_wrap(widget)<0) widget_textedit_set_wrap(widget,0);
+    textedit_invalidate_all(widget);
+  }
+  WIDGET->selp=p+srcc;
+  WIDGET->selc=0;
+  WIDGET->goalx=-1;
+  textedit_invalidate_range(widget,WIDGET->selp,0);
+  textedit_set_top(widget,WIDGET->topline,WIDGET->topsub); // Clamp, in case we were looking at the end, or our top row moved.
+  textedit_show_cursor(widget);
+  widget->ctx->render_soon=1;
+  if (WIDGET->cb_postedit) WIDGET->cb_postedit(widget,p,c,srcc);
+  return 0;
+}
+
+/* Record the edit for undo, then make it.
+ * An edit too big for the journal clears it, and we don't bother copying out what it removes.
+ */
+
+static int textedit_edit(struct widget *widget,int64_t p,int64_t c,const char *src,int srcc,int flags) {
+  if (!src) srcc=0; else if (srcc<0) { srcc=0; while (src[srcc]) srcc++; }
+  if ((p<0)||(c<0)||(p>doc_get_length(WIDGET->doc)-c)) return -1;
+  int64_t limit=(WIDGET->undo.limit>0)?WIDGET->undo.limit:TEXT_UNDO_DEFAULT_LIMIT;
+  if ((c>INT_MAX)||(c+srcc>limit)) {
+    text_undo_clear(&WIDGET->undo);
+  } else {
+    if (c>WIDGET->scratcha) {
+      void *nv=realloc(WIDGET->scratch,c);
+      if (!nv) return -1;
+      WIDGET->scratch=nv;
+      WIDGET->scratcha=c;
+    }
+    int rmc=doc_read(WIDGET->scratch,c,WIDGET->doc,p);
+    if (text_undo_push(&WIDGET->undo,p,WIDGET->scratch,rmc,src,srcc,flags)<0) text_undo_clear(&WIDGET->undo);
+  }
+  if (textedit_apply(widget,p,c,src,srcc)<0) {
+    text_undo_clear(&WIDGET->undo);
+    return -1;
+  }
+  return 0;
+}
+
+int widget_textedit_replace(struct widget *widget,int64_t p,int64_t c,const char *src,int srcc) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  return textedit_edit(widget,p,c,src,srcc,0);
+}
+
+int widget_textedit_insert_codepoint(struct widget *widget,int codepoint) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  char encoded[4];
+  int encodedc=widget->ctx->encoding->write(encoded,sizeof(encoded),codepoint,widget->ctx->encoding->ctx);
+  if ((encodedc<1)||(encodedc>sizeof(encoded))) return -1;
+  int64_t p=WIDGET->selp,c=WIDGET->selc;
+  if (c<0) {
+    p+=c;
+    c=-c;
+  }
+  return textedit_edit(widget,p,c,encoded,encodedc,c?0:TEXT_UNDO_TYPING);
+}
+
+int widget_textedit_delete(struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  int64_t p=WIDGET->selp,c=WIDGET->selc;
+  if (c<0) {
+    p+=c;
+    c=-c;
+  } else if (!c) {
+    c=textedit_step(0,widget,p,1)-p;
+    if (!c) return 0;
+    return textedit_edit(widget,p,c,0,0,TEXT_UNDO_TYPING);
+  }
+  return textedit_edit(widget,p,c,0,0,0);
+}
+
+int widget_textedit_backspace(struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  int64_t p=WIDGET->selp,c=WIDGET->selc;
+  if (c<0) {
+    p+=c;
+    c=-c;
+  } else if (!c) {
+    p=textedit_step(0,widget,p,-1);
+    c=WIDGET->selp-p;
+    if (!c) return 0;
+    return textedit_edit(widget,p,c,0,0,TEXT_UNDO_TYPING);
+  }
+  return textedit_edit(widget,p,c,0,0,0);
+}
+
+/* Undo and redo.
+ * If the edit fails, step the journal back where it was.
+ */
+
+int widget_textedit_undo(struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  struct text_undo_edit edit;
+  if (text_undo_undo(&edit,&WIDGET->undo)<=0) return 0;
+  if (textedit_apply(widget,edit.p,edit.rmc,edit.add,edit.addc)<0) {
+    text_undo_redo(&edit,&WIDGET->undo);
+    return -1;
+  }
+  return 0;
+}
+
+int widget_textedit_redo(struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  struct text_undo_edit edit;
+  if (text_undo_redo(&edit,&WIDGET->undo)<=0) return 0;
+  if (textedit_apply(widget,edit.p,edit.rmc,edit.add,edit.addc)<0) {
+    text_undo_undo(&edit,&WIDGET->undo);
+    return -1;
+  }
+  return 0;
+}
+
+int widget_textedit_set_undo_limit(struct widget *widget,int64_t limit) {
+  if (!widget||(widget->type!=&widget_type_textedit)) return -1;
+  WIDGET->undo.limit=limit;
+  return 0;
+}
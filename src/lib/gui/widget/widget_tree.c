@@ -0,0 +1,645 @@
+/* widget_tree.c
+ * Expandable hierarchy of text rows.
+ * Nodes are cheap structs, not widgets, and their children are only requested when first expanded.
+ * The visible rows live in one flat array in display order.
+ * Expanding a node splices its visible descendants in after it, and collapsing cuts them back out.
+ * Children added to a visible parent are held as a pending run, and spliced in all at once when something next looks at the rows.
+ * Nothing ever walks the whole tree.
+ */
+
+#include "lib/gui/gui_internal.h"
+#if USE_fs
+  #include "opt/fs/fs.h"
+#endif
+
+#define TREE_INDENT_GLYPHS 2
+#define TREE_WHEEL_ROWS 3
+#define TREE_SCROLLBAR_W 6
+
+struct widget_tree_node {
+  struct widget_tree_node *parent; // WEAK, null for top-level nodes.
+  struct widget_tree_node **childv; // STRONG
+  int childc,childa;
+  char *label;
+  int labelc;
+  void *userdata;
+  int depth;
+  int expandable; // Nonzero if it might have children. We don't know until it's loaded.
+  int loaded; // Nonzero once (cb_expand) has been called.
+  int expanded;
+};
+
+struct widget_tree {
+  struct widget hdr;
+  struct widget_args_tree args;
+  struct font *font;
+  struct widget_tree_node top; // Invisible container for the top-level nodes, depth -1.
+  struct widget_tree_node **rowv; // WEAK, visible nodes in display order.
+  int rowc,rowa;
+  struct widget_tree_node *pendparent; // WEAK. Its last (pendc) children belong at (pendrow) but aren't in (rowv) yet.
+  int pendrow,pendc; // (rowa) already has room for them.
+  int rowh;
+  int scroll; // Private, like widget_list.
+  int selrow;
+  int focus;
+  uint32_t fgcolor;
+  uint32_t highlight_color;
+  uint32_t scrollbar_color;
+  int scrollbarw; // TREE_SCROLLBAR_W at UI scale.
+  double click_time;
+  int click_row;
+};
+
+#define WIDGET ((struct widget_tree*)widget)
+
+/* Node primitives.
+ */
+
+static void tree_node_cleanup(struct widget_tree_node *node) {
+  if (node->childv) {
+    while (node->childc-->0) {
+      struct widget_tree_node *child=node->childv[node->childc];
+      tree_node_cleanup(child);
+      free(child);
+    }
+    free(node->childv);
+  }
+  if (node->label) free(node->label);
+}
+
+static int tree_node_childv_require(struct widget_tree_node *node) {
+  if (node->childc<node->childa) return 0;
+  int na=node->childa+16;
+  if (na<node->childa<<1) na=node->childa<<1; // Directories with 100k entries are a thing. Grow geometrically.
+  if (na>INT_MAX/sizeof(void*)) return -1;
+  void *nv=realloc(node->childv,sizeof(void*)*na);
+  if (!nv) return -1;
+  node->childv=nv;
+  node->childa=na;
+  return 0;
+}
+
+/* Row list primitives.
+ */
+
+static int tree_rowv_require(struct widget *widget,int addc) {
+  if (addc<1) return 0;
+  if (WIDGET->rowc>INT_MAX-addc) return -1;
+  int na=WIDGET->rowc+addc;
+  if (na<=WIDGET->rowa) return 0;
+  if (na<WIDGET->rowa<<1) na=WIDGET->rowa<<1;
+  if (na>INT_MAX/sizeof(void*)) return -1;
+  void *nv=realloc(WIDGET->rowv,sizeof(void*)*na);
+  if (!nv) return -1;
+  WIDGET->rowv=nv;
+  WIDGET->rowa=na;
+  return 0;
+}
+
+// How many rows would (node)'s descendants occupy, given the current expansion state?
+static int tree_count_visible_descendants(const struct widget_tree_node *node) {
+  if (!node->expanded) return 0;
+  int c=node->childc,i=node->childc;
+  while (i-->0) c+=tree_count_visible_descendants(node->childv[i]);
+  return c;
+}
+
+static struct widget_tree_node **tree_list_visible_descendants(struct widget_tree_node **dst,struct widget_tree_node *node) {
+  if (!node->expanded) return dst;
+  int i=0;
+  for (;i<node->childc;i++) {
+    *(dst++)=node->childv[i];
+    dst=tree_list_visible_descendants(dst,node->childv[i]);
+  }
+  return dst;
+}
+
+// End of (row)'s visible subtree, ie the next row not deeper than it.
+static int tree_subtree_end(const struct widget *widget,int row) {
+  int depth=WIDGET->rowv[row]->depth;
+  int p=row+1;
+  while ((p<WIDGET->rowc)&&(WIDGET->rowv[p]->depth>depth)) p++;
+  return p;
+}
+
+/* Splice the pending run of new children into the rows.
+ * Everything that reads rows, other than the const accessors, calls this first.
+ */
+
+static void tree_flush_rows(struct widget *widget) {
+  if (!WIDGET->pendc) return;
+  struct widget_tree_node *parent=WIDGET->pendparent;
+  int p=WIDGET->pendrow,c=WIDGET->pendc;
+  memmove(WIDGET->rowv+p+c,WIDGET->rowv+p,sizeof(void*)*(WIDGET->rowc-p));
+  memcpy(WIDGET->rowv+p,parent->childv+parent->childc-c,sizeof(void*)*c);
+  WIDGET->rowc+=c;
+  if (WIDGET->selrow>=p) WIDGET->selrow+=c;
+  WIDGET->pendparent=0;
+  WIDGET->pendc=0;
+}
+
+static int tree_find_row(const struct widget *widget,const struct widget_tree_node *node) {
+  int i=0;
+  for (;i<WIDGET->rowc;i++) if (WIDGET->rowv[i]==node) return i;
+  return -1;
+}
+
+// Is (node) displayed? That's every ancestor expanded.
+static int tree_node_is_visible(const struct widget_tree_node *node) {
+  for (node=node->parent;node;node=node->parent) if (!node->expanded) return 0;
+  return 1;
+}
+
+/* Scroll.
+ */
+
+static void tree_clamp_scroll(struct widget *widget) {
+  int limit=WIDGET->rowc*WIDGET->rowh-widget->h;
+  if (WIDGET->scroll>limit) WIDGET->scroll=limit;
+  if (WIDGET->scroll<0) WIDGET->scroll=0;
+}
+
+static void tree_scroll_to(struct widget *widget,int row) {
+  int top=row*WIDGET->rowh;
+  if (top<WIDGET->scroll) WIDGET->scroll=top;
+  else if (top+WIDGET->rowh>WIDGET->scroll+widget->h) WIDGET->scroll=top+WIDGET->rowh-widget->h;
+  tree_clamp_scroll(widget);
+}
+
+/* Expand or collapse the node at a given row.
+ * Selection follows its node.
+ */
+
+static int tree_expand_row(struct widget *widget,int row) {
+  struct widget_tree_node *node=WIDGET->rowv[row];
+  if (node->expanded||!node->expandable) return 0;
+  if (!node->loaded) {
+    node->loaded=1;
+    if (WIDGET->args.cb_expand) {
+      if (WIDGET->args.cb_expand(widget,node,WIDGET->args.userdata)<0) return -1;
+      // Callback may have modified the rows, if it was naughty and expanded something else. Don't trust (row).
+      tree_flush_rows(widget);
+      if ((row=tree_find_row(widget,node))<0) return -1;
+    }
+  }
+  node->expanded=1;
+  widget->ctx->render_soon=1; // Even with no rows to add, the expander changes.
+  int addc=tree_count_visible_descendants(node);
+  if (!addc) return 0;
+  if (tree_rowv_require(widget,addc)<0) {
+    node->expanded=0;
+    return -1;
+  }
+  memmove(WIDGET->rowv+row+1+addc,WIDGET->rowv+row+1,sizeof(void*)*(WIDGET->rowc-row-1));
+  tree_list_visible_descendants(WIDGET->rowv+row+1,node);
+  WIDGET->rowc+=addc;
+  if (WIDGET->selrow>row) WIDGET->selrow+=addc;
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+static int tree_collapse_row(struct widget *widget,int row) {
+  struct widget_tree_node *node=WIDGET->rowv[row];
+  if (!node->expanded) return 0;
+  node->expanded=0;
+  int end=tree_subtree_end(widget,row);
+  int rmc=end-row-1;
+  if (rmc>0) {
+    memmove(WIDGET->rowv+row+1,WIDGET->rowv+end,sizeof(void*)*(WIDGET->rowc-end));
+    WIDGET->rowc-=rmc;
+    if (WIDGET->selrow>=end) WIDGET->selrow-=rmc;
+    else if (WIDGET->selrow>row) WIDGET->selrow=row;
+  }
+  tree_clamp_scroll(widget);
+  widget->ctx->render_soon=1;
+  return 0;
+}
+
+/* Cleanup.
+ */
+
+static void _tree_del(struct widget *widget) {
+  tree_node_cleanup(&WIDGET->top);
+  if (WIDGET->rowv) free(WIDGET->rowv);
+  font_del(WIDGET->font);
+}
+
+/* Init.
+ */
+
+static int _tree_init(struct widget *widget,const void *args,int argslen) {
+  if (args&&(argslen==sizeof(struct widget_args_tree))) {
+    WIDGET->args=*(const struct widget_args_tree*)args;
+  }
+  struct font *font=WIDGET->args.font;
+  if (!font) font=gui_get_default_font(widget->ctx);
+  if (font_ref(font)<0) return -1;
+  WIDGET->font=font;
+  WIDGET->rowh=font_get_height(font)+gui_scale(widget->ctx,2);
+  WIDGET->top.depth=-1;
+  WIDGET->top.expandable=1;
+  WIDGET->top.loaded=1;
+  WIDGET->top.expanded=1;
+  widget->bgcolor=        wm_pixel_from_rgbx(0xffffffff);
+  WIDGET->fgcolor=        wm_pixel_from_rgbx(0x000000ff);
+  WIDGET->highlight_color=wm_pixel_from_rgbx(0x40c0ffff);
+  WIDGET->scrollbar_color=wm_pixel_from_rgbx(0x808080ff);
+  WIDGET->scrollbarw=gui_scale(widget->ctx,TREE_SCROLLBAR_W);
+  widget->focusable=1;
+  widget->rawmouse=1;
+  WIDGET->selrow=-1;
+  WIDGET->click_row=-1;
+  return 0;
+}
+
+/* Measure.
+ */
+
+static void _tree_measure(int *w,int *h,struct widget *widget,int maxw,int maxh) {
+  tree_flush_rows(widget);
+  int wanth=WIDGET->rowc*WIDGET->rowh+(widget->pady<<1);
+  if (wanth>maxh) wanth=maxh;
+  if (wanth>*h) *h=wanth;
+}
+
+/* Pack.
+ */
+
+static void _tree_pack(struct widget *widget) {
+  tree_flush_rows(widget);
+  tree_clamp_scroll(widget);
+}
+
+/* Render.
+ */
+
+static void _tree_render(struct widget *widget,struct image *dst) {
+  tree_flush_rows(widget);
+  int totalh=WIDGET->rowc*WIDGET->rowh;
+  int roww=widget->w;
+  int scrollbar=(totalh>widget->h);
+  if (scrollbar) roww-=WIDGET->scrollbarw;
+  int glyphw=font_get_width(WIDGET->font);
+  font_set_color_normal(WIDGET->font,WIDGET->fgcolor);
+  int row=WIDGET->scroll/WIDGET->rowh;
+  int y=row*WIDGET->rowh-WIDGET->scroll;
+  for (;(row<WIDGET->rowc)&&(y<widget->h);row++,y+=WIDGET->rowh) {
+    const struct widget_tree_node *node=WIDGET->rowv[row];
+    if (row==WIDGET->selrow) image_fill_rect(dst,0,y,roww,WIDGET->rowh,WIDGET->highlight_color);
+    int x=node->depth*glyphw*TREE_INDENT_GLYPHS+1;
+    if (node->expandable&&(!node->loaded||node->childc)) {
+      font_render_glyph(dst,x,y+1,WIDGET->font,node->expanded?'-':'+',WIDGET->fgcolor);
+    }
+    x+=glyphw*TREE_INDENT_GLYPHS;
+    font_render_string(dst,x,y+1,WIDGET->font,node->label,node->labelc);
+  }
+  if (scrollbar) {
+    int thumbh=(int)(((int64_t)widget->h*widget->h)/totalh);
+    if (thumbh<WIDGET->scrollbarw) thumbh=WIDGET->scrollbarw;
+    int thumby=(int)(((int64_t)WIDGET->scroll*(widget->h-thumbh))/(totalh-widget->h));
+    image_fill_rect(dst,roww+gui_get_scale(widget->ctx),thumby,WIDGET->scrollbarw-2*gui_get_scale(widget->ctx),thumbh,WIDGET->scrollbar_color);
+  }
+  if (WIDGET->focus) {
+    image_frame_rect_dotted(dst,0,0,widget->w,widget->h,0x00000000);
+  }
+}
+
+/* Focus.
+ */
+
+static void _tree_focus(struct widget *widget,int focus) {
+  WIDGET->focus=focus;
+  widget->ctx->render_soon=1;
+}
+
+/* Selection.
+ */
+
+static void tree_select(struct widget *widget,int row) {
+  if (row>=WIDGET->rowc) row=WIDGET->rowc-1;
+  if (row<0) row=-1;
+  if (row==WIDGET->selrow) return;
+  WIDGET->selrow=row;
+  if (row>=0) tree_scroll_to(widget,row);
+  widget->ctx->render_soon=1;
+  if (WIDGET->args.cb_select) WIDGET->args.cb_select(widget,(row>=0)?WIDGET->rowv[row]:0,WIDGET->args.userdata);
+}
+
+static void tree_activate(struct widget *widget,int row) {
+  struct widget_tree_node *node=WIDGET->rowv[row];
+  if (WIDGET->args.cb_activate) {
+    WIDGET->args.cb_activate(widget,node,WIDGET->args.userdata);
+  } else if (node->expanded) {
+    tree_collapse_row(widget,row);
+  } else {
+    tree_expand_row(widget,row);
+  }
+}
+
+/* Keystroke.
+ */
+
+static int _tree_key(struct widget *widget,int keycode,int value,int codepoint) {
+  if (!value) return 0;
+  tree_flush_rows(widget);
+  int pagerows=widget->h/WIDGET->rowh;
+  if (pagerows<1) pagerows=1;
+  int sel=WIDGET->selrow;
+  switch (keycode) {
+    case 0x00070028: if (sel>=0) tree_activate(widget,sel); return 1; // Enter
+    case 0x0007004a: tree_select(widget,0); return 1; // Home
+    case 0x0007004b: tree_select(widget,(sel<0)?0:(sel-pagerows)); return 1; // Page Up
+    case 0x0007004d: tree_select(widget,WIDGET->rowc-1); return 1; // End
+    case 0x0007004e: tree_select(widget,(sel<0)?0:(sel+pagerows)); return 1; // Page Down
+    case 0x00070051: tree_select(widget,sel+1); return 1; // Down
+    case 0x00070052: tree_select(widget,(sel<0)?0:(sel-1)); return 1; // Up
+    case 0x0007004f: { // Right: Expand, or if already expanded, step into it.
+        if (sel<0) return 1;
+        if (WIDGET->rowv[sel]->expanded) tree_select(widget,sel+1);
+        else tree_expand_row(widget,sel);
+      } return 1;
+    case 0x00070050: { // Left: Collapse, or if already collapsed, step out to the parent.
+        if (sel<0) return 1;
+        struct widget_tree_node *node=WIDGET->rowv[sel];
+        if (node->expanded) {
+          tree_collapse_row(widget,sel);
+        } else if (node->parent) {
+          int p=sel;
+          while ((p>0)&&(WIDGET->rowv[p]!=node->parent)) p--;
+          tree_select(widget,p);
+        }
+      } return 1;
+  }
+  return 0;
+}
+
+/* Mouse.
+ */
+
+static int _tree_mbutton(struct widget *widget,int btnid,int value,int mx,int my) {
+  if (btnid!=1) return 0;
+  if (!value) return 1;
+  tree_flush_rows(widget);
+  gui_focus_widget(widget->ctx,widget);
+  widget_coords_local_from_global(&mx,&my,widget);
+  if ((my<0)||(my>=widget->h)) return 1;
+  int row=(my+WIDGET->scroll)/WIDGET->rowh;
+  if ((row<0)||(row>=WIDGET->rowc)) return 1;
+  struct widget_tree_node *node=WIDGET->rowv[row];
+
+  // Clicking the expander toggles without selecting.
+  int glyphw=font_get_width(WIDGET->font);
+  int expx=node->depth*glyphw*TREE_INDENT_GLYPHS;
+  if ((mx>=expx)&&(mx<expx+glyphw*TREE_INDENT_GLYPHS)) {
+    if (node->expanded) tree_collapse_row(widget,row);
+    else tree_expand_row(widget,row);
+    return 1;
+  }
+
+  double now=gui_now_real();
+  if ((row==WIDGET->click_row)&&(now-WIDGET->click_time<=widget->ctx->double_click_interval)) {
+    WIDGET->click_row=-1;
+    tree_activate(widget,row);
+    return 1;
+  }
+  WIDGET->click_time=now;
+  WIDGET->click_row=row;
+  tree_select(widget,row);
+  return 1;
+}
+
+static int _tree_mwheel(struct widget *widget,int dx,int dy,int mx,int my) {
+  if (!dy) return 0;
+  tree_flush_rows(widget);
+  int pv=WIDGET->scroll;
+  WIDGET->scroll+=dy*TREE_WHEEL_ROWS*WIDGET->rowh;
+  tree_clamp_scroll(widget);
+  if (WIDGET->scroll!=pv) widget->ctx->render_soon=1;
+  return 1;
+}
+
+/* Type definition.
+ */
+
+const struct widget_type widget_type_tree={
+  .name="tree",
+  .objlen=sizeof(struct widget_tree),
+  .autorender=1,
+  .del=_tree_del,
+  .init=_tree_init,
+  .measure=_tree_measure,
+  .pack=_tree_pack,
+  .render=_tree_render,
+  .focus=_tree_focus,
+  .key=_tree_key,
+  .mbutton=_tree_mbutton,
+  .mwheel=_tree_mwheel,
+};
+
+/* Add node.
+ */
+
+struct widget_tree_node *widget_tree_add_node(
+  struct widget *widget,
+  struct widget_tree_node *parent,
+  const char *label,int labelc,
+  int expandable,
+  void *userdata
+) {
+  if (!widget||(widget->type!=&widget_type_tree)) return 0;
+  if (!parent) parent=&WIDGET->top;
+  if (!label) labelc=0; else if (labelc<0) { labelc=0; while (label[labelc]) labelc++; }
+  if (tree_node_childv_require(parent)<0) return 0;
+  struct widget_tree_node *node=calloc(1,sizeof(struct widget_tree_node));
+  if (!node) return 0;
+  if (!(node->label=malloc(labelc+1))) {
+    free(node);
+    return 0;
+  }
+  memcpy(node->label,label,labelc);
+  node->label[labelc]=0;
+  node->labelc=labelc;
+  node->userdata=userdata;
+  node->expandable=expandable;
+  node->parent=(parent==&WIDGET->top)?0:parent;
+  node->depth=parent->depth+1;
+  parent->childv[parent->childc++]=node;
+  parent->loaded=1;
+
+  /* If the parent is already expanded and visible, the new node goes in the row list too.
+   * It's the parent's last child, so its row is the end of the parent's visible subtree.
+   * We find that once per run of adds to the same parent, and splice the whole run in later. See tree_flush_rows.
+   * (During cb_expand, the parent is not expanded yet, so bulk population stays cheap).
+   */
+  if (parent->expanded&&((parent==&WIDGET->top)||tree_node_is_visible(parent))) {
+    if (parent!=WIDGET->pendparent) {
+      tree_flush_rows(widget);
+      int p;
+      if (parent==&WIDGET->top) p=WIDGET->rowc;
+      else if ((p=tree_find_row(widget,parent))<0) return node; // Inconsistent, shouldn't happen.
+      else p=tree_subtree_end(widget,p);
+      WIDGET->pendparent=parent;
+      WIDGET->pendrow=p;
+    }
+    if (tree_rowv_require(widget,WIDGET->pendc+1)<0) {
+      // Undo the append, so rows and children stay consistent.
+      parent->childc--;
+      tree_node_cleanup(node);
+      free(node);
+      if (!WIDGET->pendc) WIDGET->pendparent=0;
+      return 0;
+    }
+    WIDGET->pendc++;
+    widget->ctx->render_soon=1;
+  }
+  return node;
+}
+
+/* Sort a node's children, only legal while it's collapsed.
+ */
+
+static int tree_cmp_default(const void *a,const void *b) {
+  const struct widget_tree_node *A=*(const struct widget_tree_node**)a;
+  const struct widget_tree_node *B=*(const struct widget_tree_node**)b;
+  if (A->expandable&&!B->expandable) return -1;
+  if (!A->expandable&&B->expandable) return 1;
+  return strcmp(A->label,B->label);
+}
+
+int widget_tree_sort_children(struct widget *widget,struct widget_tree_node *node) {
+  if (!widget||(widget->type!=&widget_type_tree)) return -1;
+  if (!node) node=&WIDGET->top;
+  if (node->expanded&&(node!=&WIDGET->top)) return -1;
+  tree_flush_rows(widget);
+  if (node==&WIDGET->top) {
+    if (WIDGET->rowc!=node->childc) return -1; // Something expanded at the top level. Sort before expanding.
+    if (!node->childc) return 0;
+    qsort(node->childv,node->childc,sizeof(void*),tree_cmp_default);
+    memcpy(WIDGET->rowv,node->childv,sizeof(void*)*node->childc);
+    widget->ctx->render_soon=1;
+    return 0;
+  }
+  qsort(node->childv,node->childc,sizeof(void*),tree_cmp_default);
+  return 0;
+}
+
+/* Expand or collapse, public.
+ */
+
+int widget_tree_expand(struct widget *widget,struct widget_tree_node *node,int expand) {
+  if (!widget||(widget->type!=&widget_type_tree)||!node) return -1;
+  if (expand&&node->parent&&!node->parent->expanded) {
+    if (widget_tree_expand(widget,node->parent,1)<0) return -1;
+  }
+  tree_flush_rows(widget);
+  int row=tree_find_row(widget,node);
+  if (row<0) {
+    // Not visible. Record the state; rows will catch up when an ancestor is expanded.
+    if (expand) {
+      if (!node->expandable) return 0;
+      if (!node->loaded) {
+        node->loaded=1;
+        if (WIDGET->args.cb_expand&&(WIDGET->args.cb_expand(widget,node,WIDGET->args.userdata)<0)) return -1;
+      }
+      node->expanded=1;
+    } else {
+      node->expanded=0;
+    }
+    return 0;
+  }
+  if (expand) return tree_expand_row(widget,row);
+  return tree_collapse_row(widget,row);
+}
+
+/* Trivial accessors.
+ */
+
+void *widget_tree_get_userdata(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_tree)) return 0;
+  return WIDGET->args.userdata;
+}
+
+struct widget_tree_node *widget_tree_get_selection(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_tree)) return 0;
+  if ((WIDGET->selrow<0)||(WIDGET->selrow>=WIDGET->rowc)) return 0;
+  return WIDGET->rowv[WIDGET->selrow]; // (selrow) doesn't count pending rows yet, so this is right without flushing.
+}
+
+int widget_tree_count_rows(const struct widget *widget) {
+  if (!widget||(widget->type!=&widget_type_tree)) return 0;
+  return WIDGET->rowc+WIDGET->pendc;
+}
+
+struct widget_tree_node *widget_tree_node_get_parent(const struct widget_tree_node *node) {
+  if (!node) return 0;
+  return node->parent;
+}
+
+int widget_tree_node_get_label(void *dstpp,const struct widget_tree_node *node) {
+  if (!node) return 0;
+  if (dstpp) *(void**)dstpp=node->label;
+  return node->labelc;
+}
+
+void *widget_tree_node_get_userdata(const struct widget_tree_node *node) {
+  if (!node) return 0;
+  return node->userdata;
+}
+
+int widget_tree_node_count_children(const struct widget_tree_node *node) {
+  if (!node) return 0;
+  return node->childc;
+}
+
+struct widget_tree_node *widget_tree_node_get_child(const struct widget_tree_node *node,int p) {
+  if (!node||(p<0)||(p>=node->childc)) return 0;
+  return node->childv[p];
+}
+
+/* Directory listing, as a ready-made (cb_expand).
+ */
+#if USE_fs
+
+struct tree_directory_context {
+  struct widget *widget;
+  struct widget_tree_node *node;
+};
+
+static int tree_cb_directory_entry(const char *path,const char *base,char ftype,void *userdata) {
+  struct tree_directory_context *ctx=userdata;
+  if ((base[0]=='.')&&(!base[1]||((base[1]=='.')&&!base[2]))) return 0;
+  if (!ftype) ftype=file_get_type(path);
+  if (!widget_tree_add_node(ctx->widget,ctx->node,base,-1,(ftype=='d'),0)) return -1;
+  return 0;
+}
+
+int widget_tree_node_get_path(char *dst,int dsta,const struct widget_tree_node *node) {
+  if (!node) return -1;
+  if (!dst||(dsta<0)) dsta=0;
+  int dstc;
+  if (node->parent) {
+    if ((dstc=widget_tree_node_get_path(dst,dsta,node->parent))<0) return -1;
+    if (dstc>=dsta) return -1;
+    char tmp[1024];
+    if (dstc>=sizeof(tmp)) return -1;
+    memcpy(tmp,dst,dstc);
+    dstc=path_join(dst,dsta,tmp,dstc,node->label,node->labelc);
+  } else {
+    dstc=node->labelc;
+    if (dstc<=dsta) memcpy(dst,node->label,dstc);
+    if (dstc<dsta) dst[dstc]=0;
+  }
+  return dstc;
+}
+
+int widget_tree_expand_directory(struct widget *widget,struct widget_tree_node *node,void *userdata) {
+  if (!widget||(widget->type!=&widget_type_tree)||!node) return -1;
+  char path[1024];
+  int pathc=widget_tree_node_get_path(path,sizeof(path),node);
+  if ((pathc<1)||(pathc>=sizeof(path))) return -1;
+  struct tree_directory_context ctx={.widget=widget,.node=node};
+  if (dir_read(path,tree_cb_directory_entry,&ctx)<0) return -1;
+  return widget_tree_sort_children(widget,node);
+}
+
+#endif
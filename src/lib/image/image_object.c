@@ -35,11 +35,11 @@ int image_ref(struct image *image) {
 struct image *image_new_from_path(const char *path) {
   struct image *image=0;
   #if USE_fs
-    void *serial=0;
-    int serialc=file_read(&serial,path);
-    if (serialc>=0) {
-      image=image_new_decode(serial,serialc);
-      free(serial);
+    // Decoders take int lengths, and no sensible image file is 2 GB anyway.
+    struct file_map *map=file_map(path,FILE_MAP_SEQUENTIAL);
+    if (map) {
+      if (map->c<=INT_MAX) image=image_new_decode(map->v,map->c);
+      file_unmap(map);
     }
   #endif
   return image;
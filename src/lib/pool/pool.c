@@ -0,0 +1,403 @@
+#include "pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define POOL_THREAD_LIMIT 64
+
+/* Object definitions.
+ */
+
+struct pool_job {
+  int jobid;
+  volatile int cancel;
+  int (*cb)(void *userdata);
+  void (*cb_done)(int jobid,int status,void *userdata);
+  void *userdata;
+};
+
+struct pool_worker {
+  struct pool *pool; // WEAK
+  pthread_t thread;
+  int running; // Nonzero if (thread) needs joined.
+  pthread_mutex_t mutex; // Guards the deque only.
+  struct pool_job **jobv; // Ring buffer, WEAK. The pool's registry owns jobs.
+  int jobp,jobc,joba;
+};
+
+struct pool {
+  struct pool_worker *workerv;
+  int workerc;
+  pthread_mutex_t mutex; // Guards everything below, and sleeping.
+  pthread_cond_t cond;
+  int pendingc; // Jobs in any deque.
+  int terminate;
+  int jobid_next;
+  int rrp; // Next worker for submissions from outside the pool.
+  struct pool_job **jobv; // STRONG, every job not finished yet, sorted by jobid.
+  int jobc,joba;
+};
+
+static __thread struct pool_worker *pool_current_worker=0;
+static __thread struct pool_job *pool_current_job=0;
+
+/* Deque primitives. Caller must hold the worker's mutex.
+ */
+
+static int pool_worker_push(struct pool_worker *worker,struct pool_job *job) {
+  if (worker->jobc>=worker->joba) {
+    int na=worker->joba+32;
+    if (na>INT_MAX/sizeof(void*)) return -1;
+    struct pool_job **nv=malloc(sizeof(void*)*na);
+    if (!nv) return -1;
+    int i=0; for (;i<worker->jobc;i++) nv[i]=worker->jobv[(worker->jobp+i)%worker->joba];
+    if (worker->jobv) free(worker->jobv);
+    worker->jobv=nv;
+    worker->joba=na;
+    worker->jobp=0;
+  }
+  worker->jobv[(worker->jobp+worker->jobc)%worker->joba]=job;
+  worker->jobc++;
+  return 0;
+}
+
+// Owner takes from the back: Newest first, that's what's warm in cache.
+static struct pool_job *pool_worker_pop_back(struct pool_worker *worker) {
+  if (worker->jobc<1) return 0;
+  worker->jobc--;
+  return worker->jobv[(worker->jobp+worker->jobc)%worker->joba];
+}
+
+// Thieves take from the front: Oldest first, likely the biggest remaining chunk.
+static struct pool_job *pool_worker_pop_front(struct pool_worker *worker) {
+  if (worker->jobc<1) return 0;
+  struct pool_job *job=worker->jobv[worker->jobp];
+  worker->jobc--;
+  if (++(worker->jobp)>=worker->joba) worker->jobp=0;
+  return job;
+}
+
+/* Job registry. Caller must hold the pool's mutex.
+ */
+
+static int pool_job_search(const struct pool *pool,int jobid) {
+  int lo=0,hi=pool->jobc;
+  while (lo<hi) {
+    int ck=(lo+hi)>>1;
+    int q=pool->jobv[ck]->jobid;
+         if (jobid<q) hi=ck;
+    else if (jobid>q) lo=ck+1;
+    else return ck;
+  }
+  return -lo-1;
+}
+
+/* Find a job for this worker, own deque first then steal.
+ * Blocks until there's one, or returns null if we're terminating and nothing is left.
+ */
+
+static struct pool_job *pool_worker_next_job(struct pool_worker *worker) {
+  struct pool *pool=worker->pool;
+  for (;;) {
+    struct pool_job *job;
+    pthread_mutex_lock(&worker->mutex);
+    job=pool_worker_pop_back(worker);
+    pthread_mutex_unlock(&worker->mutex);
+    if (!job) {
+      int self=worker-pool->workerv;
+      int i=1; for (;i<pool->workerc;i++) {
+        struct pool_worker *victim=pool->workerv+(self+i)%pool->workerc;
+        pthread_mutex_lock(&victim->mutex);
+        job=pool_worker_pop_front(victim);
+        pthread_mutex_unlock(&victim->mutex);
+        if (job) break;
+      }
+    }
+    pthread_mutex_lock(&pool->mutex);
+    if (job) {
+      pool->pendingc--;
+      pthread_mutex_unlock(&pool->mutex);
+      return job;
+    }
+    // (pendingc) is raised along with the push, so if it's nonzero, something is sitting in a deque. Go look again.
+    while (!pool->pendingc&&!pool->terminate) pthread_cond_wait(&pool->cond,&pool->mutex);
+    if (!pool->pendingc) { // Terminating.
+      pthread_mutex_unlock(&pool->mutex);
+      return 0;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+  }
+}
+
+/* Run one job and retire it.
+ */
+
+static void pool_run_job(struct pool *pool,struct pool_job *job) {
+  int status=POOL_CANCELLED;
+  if (!job->cancel) {
+    pool_current_job=job;
+    status=job->cb(job->userdata);
+    pool_current_job=0;
+  }
+  if (job->cb_done) job->cb_done(job->jobid,status,job->userdata);
+  pthread_mutex_lock(&pool->mutex);
+  int p=pool_job_search(pool,job->jobid);
+  if (p>=0) {
+    pool->jobc--;
+    memmove(pool->jobv+p,pool->jobv+p+1,sizeof(void*)*(pool->jobc-p));
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  free(job);
+}
+
+/* Worker thread.
+ */
+
+static void *pool_worker_main(void *arg) {
+  struct pool_worker *worker=arg;
+  pool_current_worker=worker;
+  struct pool_job *job;
+  while ((job=pool_worker_next_job(worker))) {
+    pool_run_job(worker->pool,job);
+  }
+  pool_current_worker=0;
+  return 0;
+}
+
+/* Delete.
+ */
+
+void pool_del(struct pool *pool) {
+  if (!pool) return;
+  pthread_mutex_lock(&pool->mutex);
+  int i=pool->jobc;
+  while (i-->0) pool->jobv[i]->cancel=1;
+  pool->terminate=1;
+  pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+  // Workers drain their deques before exiting, so every (cb_done) gets called.
+  struct pool_worker *worker=pool->workerv;
+  for (i=pool->workerc;i-->0;worker++) {
+    if (worker->running) pthread_join(worker->thread,0);
+    pthread_mutex_destroy(&worker->mutex);
+    if (worker->jobv) free(worker->jobv);
+  }
+  free(pool->workerv);
+  if (pool->jobv) free(pool->jobv);
+  pthread_cond_destroy(&pool->cond);
+  pthread_mutex_destroy(&pool->mutex);
+  free(pool);
+}
+
+/* New.
+ */
+
+struct pool *pool_new(int threadc) {
+  if (threadc<1) {
+    long cpuc=sysconf(_SC_NPROCESSORS_ONLN);
+    threadc=(cpuc<1)?1:(cpuc>POOL_THREAD_LIMIT)?POOL_THREAD_LIMIT:(int)cpuc;
+  } else if (threadc>POOL_THREAD_LIMIT) {
+    threadc=POOL_THREAD_LIMIT;
+  }
+  struct pool *pool=calloc(1,sizeof(struct pool));
+  if (!pool) return 0;
+  if (!(pool->workerv=calloc(threadc,sizeof(struct pool_worker)))) {
+    free(pool);
+    return 0;
+  }
+  pthread_mutex_init(&pool->mutex,0);
+  pthread_cond_init(&pool->cond,0);
+  pool->jobid_next=1;
+  // Initialize all the workers before starting any, since they steal from each other.
+  pool->workerc=threadc;
+  int i=0; for (;i<threadc;i++) {
+    pool->workerv[i].pool=pool;
+    pthread_mutex_init(&pool->workerv[i].mutex,0);
+  }
+  for (i=0;i<threadc;i++) {
+    struct pool_worker *worker=pool->workerv+i;
+    if (pthread_create(&worker->thread,0,pool_worker_main,worker)) {
+      if (!i) {
+        pool_del(pool);
+        return 0;
+      }
+      break; // Fewer threads than asked is not fatal. The idle workers' deques just never get pushed to.
+    }
+    worker->running=1;
+  }
+  return pool;
+}
+
+/* Trivial accessors.
+ */
+
+int pool_get_thread_count(const struct pool *pool) {
+  if (!pool) return 0;
+  int c=0,i=pool->workerc;
+  while (i-->0) if (pool->workerv[i].running) c++;
+  return c;
+}
+
+int pool_cancelled() {
+  if (!pool_current_job) return 0;
+  return pool_current_job->cancel;
+}
+
+int pool_current_jobid() {
+  if (!pool_current_job) return 0;
+  return pool_current_job->jobid;
+}
+
+/* Submit job.
+ */
+
+int pool_submit(
+  struct pool *pool,
+  int (*cb)(void *userdata),
+  void (*cb_done)(int jobid,int status,void *userdata),
+  void *userdata
+) {
+  if (!pool||!cb) return -1;
+  struct pool_job *job=calloc(1,sizeof(struct pool_job));
+  if (!job) return -1;
+  job->cb=cb;
+  job->cb_done=cb_done;
+  job->userdata=userdata;
+
+  /* Register, choose a worker, and push, all under the pool's lock.
+   * A thief could take the job the moment it's pushed, but it will have to wait for us before dropping (pendingc).
+   */
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->terminate) {
+    pthread_mutex_unlock(&pool->mutex);
+    free(job);
+    return -1;
+  }
+  if (pool->jobc>=pool->joba) {
+    int na=pool->joba+64;
+    void *nv=0;
+    if ((na>INT_MAX/sizeof(void*))||!(nv=realloc(pool->jobv,sizeof(void*)*na))) {
+      pthread_mutex_unlock(&pool->mutex);
+      free(job);
+      return -1;
+    }
+    pool->jobv=nv;
+    pool->joba=na;
+  }
+  struct pool_worker *worker;
+  if (pool_current_worker&&(pool_current_worker->pool==pool)) {
+    worker=pool_current_worker;
+  } else {
+    do {
+      worker=pool->workerv+pool->rrp;
+      if (++(pool->rrp)>=pool->workerc) pool->rrp=0;
+    } while (!worker->running);
+  }
+  pthread_mutex_lock(&worker->mutex);
+  int err=pool_worker_push(worker,job);
+  pthread_mutex_unlock(&worker->mutex);
+  if (err<0) {
+    pthread_mutex_unlock(&pool->mutex);
+    free(job);
+    return -1;
+  }
+  if (pool->jobid_next<1) pool->jobid_next=1;
+  int jobid=job->jobid=pool->jobid_next++;
+  pool->jobv[pool->jobc++]=job; // jobids only increase, so appending keeps it sorted.
+  pool->pendingc++;
+  pthread_cond_signal(&pool->cond);
+  pthread_mutex_unlock(&pool->mutex);
+  return jobid;
+}
+
+/* Batch.
+ * Helpers and the caller all claim items from a shared counter until there's none left.
+ * The caller waits only for claimed items to finish, never for a helper to start, so a busy pool can't deadlock us.
+ * A helper that starts late finds nothing to do. That's why the batch is refcounted rather than on the caller's stack.
+ */
+
+struct pool_batch {
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int refc;
+  int c,nextp,donec;
+  int status;
+  int (*cb)(int p,void *userdata);
+  void *userdata;
+};
+
+static void pool_batch_release(struct pool_batch *batch) {
+  pthread_mutex_lock(&batch->mutex);
+  int refc=--(batch->refc);
+  pthread_mutex_unlock(&batch->mutex);
+  if (refc) return;
+  pthread_cond_destroy(&batch->cond);
+  pthread_mutex_destroy(&batch->mutex);
+  free(batch);
+}
+
+static void pool_batch_work(struct pool_batch *batch) {
+  pthread_mutex_lock(&batch->mutex);
+  while (batch->nextp<batch->c) {
+    int p=batch->nextp++;
+    pthread_mutex_unlock(&batch->mutex);
+    int err=batch->cb(p,batch->userdata);
+    pthread_mutex_lock(&batch->mutex);
+    if (err<0) batch->status=-1;
+    if (++(batch->donec)>=batch->c) pthread_cond_broadcast(&batch->cond);
+  }
+  pthread_mutex_unlock(&batch->mutex);
+}
+
+static int pool_batch_helper(void *userdata) {
+  pool_batch_work(userdata);
+  return 0;
+}
+
+static void pool_batch_helper_done(int jobid,int status,void *userdata) {
+  pool_batch_release(userdata);
+}
+
+int pool_run_batch(struct pool *pool,int c,int (*cb)(int p,void *userdata),void *userdata) {
+  if (!cb) return -1;
+  if (c<1) return 0;
+  struct pool_batch *batch=calloc(1,sizeof(struct pool_batch));
+  if (!batch) return -1;
+  pthread_mutex_init(&batch->mutex,0);
+  pthread_cond_init(&batch->cond,0);
+  batch->refc=1;
+  batch->c=c;
+  batch->cb=cb;
+  batch->userdata=userdata;
+  int helperc=pool_get_thread_count(pool);
+  if (helperc>c-1) helperc=c-1;
+  while (helperc-->0) {
+    pthread_mutex_lock(&batch->mutex);
+    batch->refc++;
+    pthread_mutex_unlock(&batch->mutex);
+    if (pool_submit(pool,pool_batch_helper,pool_batch_helper_done,batch)<0) {
+      pool_batch_release(batch);
+      break;
+    }
+  }
+  pool_batch_work(batch);
+  pthread_mutex_lock(&batch->mutex);
+  while (batch->donec<batch->c) pthread_cond_wait(&batch->cond,&batch->mutex);
+  int status=batch->status;
+  pthread_mutex_unlock(&batch->mutex);
+  pool_batch_release(batch);
+  return status;
+}
+
+/* Cancel job.
+ */
+
+void pool_cancel(struct pool *pool,int jobid) {
+  if (!pool) return;
+  pthread_mutex_lock(&pool->mutex);
+  int p=pool_job_search(pool,jobid);
+  if (p>=0) pool->jobv[p]->cancel=1;
+  pthread_mutex_unlock(&pool->mutex);
+}
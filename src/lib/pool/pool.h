@@ -0,0 +1,62 @@
+/* pool.h
+ * Shared pool of worker threads for background jobs.
+ * Each worker has its own deque: It takes its newest job first, and when empty steals the oldest job from a neighbor.
+ * Jobs submitted from inside a job land on the submitting worker's deque, so recursive work stays local.
+ *
+ * Jobs never touch the GUI directly. If you're using gui, gui_run_in_background() wraps this and delivers completion on the UI thread.
+ */
+
+#ifndef POOL_H
+#define POOL_H
+
+struct pool;
+
+/* Status reported to (cb_done) for jobs that were cancelled before they started.
+ * Jobs that run to completion report whatever they returned, even if cancelled midway.
+ */
+#define POOL_CANCELLED (-0x7fffffff)
+
+/* (threadc<1) for one per online CPU core.
+ * Deleting cancels all pending jobs, waits for running ones, and joins the threads.
+ * Every job's (cb_done) is called exactly once before pool_del returns.
+ * Never delete a pool from one of its own jobs.
+ */
+void pool_del(struct pool *pool);
+struct pool *pool_new(int threadc);
+
+int pool_get_thread_count(const struct pool *pool);
+
+/* Schedule a job and return its jobid, >0.
+ * (cb) runs on some worker thread. Its return value is passed to (cb_done), also on the worker thread.
+ * (cb_done) is optional.
+ */
+int pool_submit(
+  struct pool *pool,
+  int (*cb)(void *userdata),
+  void (*cb_done)(int jobid,int status,void *userdata),
+  void *userdata
+);
+
+/* Run (cb) for each (p) in (0..c-1), spread across the pool, and return when they're all done.
+ * The calling thread works too, so this is safe to call from inside a job, and with a null pool it just runs them all here.
+ * Returns <0 if any call did, otherwise zero.
+ */
+int pool_run_batch(struct pool *pool,int c,int (*cb)(int p,void *userdata),void *userdata);
+
+/* Ask a job to stop.
+ * If it hasn't started, it never will, and (cb_done) gets POOL_CANCELLED.
+ * If it's running, it's up to the job to check pool_cancelled() periodically and return early.
+ * Quietly ignores jobs that already finished.
+ */
+void pool_cancel(struct pool *pool,int jobid);
+
+/* Call from inside a job: Nonzero if somebody cancelled us.
+ * Outside of a job, always zero.
+ */
+int pool_cancelled();
+
+/* Call from inside a job: Our jobid, or zero if not in a job.
+ */
+int pool_current_jobid();
+
+#endif
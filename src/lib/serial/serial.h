@@ -74,6 +74,12 @@ int sr_decode_lines(
 #define SR_DECODE_LINES_STRIP_COMMENT    0x0004 /* Stop at '#'. Beware that we're not savvy to your tokenization. Don't use if you have string tokens. */
 #define SR_DECODE_LINES_INCLUDE_EMPTY    0x0008 /* By default we skip ones that are empty after stripping. Empties are not possible without stripping. */
 
+/* Newlines.
+ * Vectorized where the target allows. For counting across threads, cut the text yourself, eg doc_prepare_lines.
+ *****************************************************************************/
+
+int64_t sr_count_newlines(const void *src,int64_t srcc);
+
 /* Structured encoder.
  * Initialize to all zeroes.
  * It's safe to yoink (v) and skip cleanup.
@@ -16,11 +16,9 @@ int sr_decode_lines(
   
     // Read to EOF or thru the next LF.
     const char *line=(char*)decoder->v+decoder->p;
-    int linec=0;
-    while (decoder->p<decoder->c) {
-      decoder->p++;
-      if (line[linec++]==0x0a) break;
-    }
+    const char *nl=memchr(line,0x0a,decoder->c-decoder->p);
+    int linec=nl?(nl-line+1):(decoder->c-decoder->p);
+    decoder->p+=linec;
     lineno++;
     
     // If they asked for comment removal, do it.
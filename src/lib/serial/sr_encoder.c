@@ -91,7 +91,7 @@ int sr_encode_fmt(struct sr_encoder *encoder,const char *fmt,...) {
     va_start(vargs,fmt);
     int err=vsnprintf(DST+encoder->c,encoder->a-encoder->c,fmt,vargs);
     if ((err<0)||(err>=INT_MAX)) return encoder->ctx=-1;
-    if (encoder->c<=encoder->a-err) { // sic '<=', need room for vsnprintf's terminator.
+    if (encoder->c<encoder->a-err) { // Strictly less: vsnprintf needs room for its terminator, or it truncates.
       encoder->c+=err;
       return 0;
     }
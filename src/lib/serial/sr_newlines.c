@@ -0,0 +1,37 @@
+/* sr_newlines.c
+ * Counting LF in bulk.
+ * Compares 16 bytes at a time, so plain text goes at memory speed.
+ */
+
+#include "serial.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+/* Count.
+ */
+
+int64_t sr_count_newlines(const void *src,int64_t srcc) {
+  if (!src||(srcc<1)) return 0;
+  const uint8_t *SRC=src;
+  int64_t nlc=0,p=0;
+  #if defined(__SSE2__)
+    const __m128i klf=_mm_set1_epi8(0x0a),zero=_mm_setzero_si128();
+    // Each compare is 0 or -1 per byte. Subtract those from byte counters, and fold before they can wrap.
+    while (p<=srcc-16) {
+      int64_t blockc=(srcc-p)>>4;
+      if (blockc>255) blockc=255;
+      __m128i acc=zero;
+      for (;blockc-->0;p+=16) {
+        acc=_mm_sub_epi8(acc,_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(SRC+p)),klf));
+      }
+      __m128i sum=_mm_sad_epu8(acc,zero);
+      nlc+=_mm_cvtsi128_si32(sum)+_mm_cvtsi128_si32(_mm_unpackhi_epi64(sum,sum));
+    }
+  #endif
+  for (;p<srcc;p++) if (SRC[p]==0x0a) nlc++;
+  return nlc;
+}
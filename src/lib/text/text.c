@@ -98,25 +98,93 @@ void text_encoder_cleanup(struct text_encoder *encoder) {
   if (encoder->v) free(encoder->v);
 }
 
+/* Grow geometrically, so a long run of appends is linear overall.
+ * In gap mode, the text after the gap moves to the end of the new buffer, so the gap is all the new space.
+ */
+
 int text_encoder_require(struct text_encoder *encoder,int addc) {
   if (addc<=0) return 0;
   if (encoder->c>INT_MAX-addc) return -1;
   int na=encoder->c+addc;
   if (na<=encoder->a) return 0;
+  if ((encoder->a<INT_MAX>>1)&&(na<encoder->a<<1)) na=encoder->a<<1;
   if (na<INT_MAX-1024) na=(na+1024)&~1023;
-  void *nv=realloc(encoder->v,na);
+  char *nv=realloc(encoder->v,na);
   if (!nv) return -1;
+  if (encoder->gap) {
+    int tailc=encoder->c-encoder->gapp;
+    memmove(nv+na-tailc,nv+encoder->a-tailc,tailc);
+  }
   encoder->v=nv;
   encoder->a=na;
   return 0;
 }
 
+/* Gap mode.
+ */
+
+static void text_encoder_move_gap(struct text_encoder *encoder,int p) {
+  if (!encoder->gap) return;
+  int gapc=encoder->a-encoder->c;
+  if (p<encoder->gapp) {
+    memmove(encoder->v+p+gapc,encoder->v+p,encoder->gapp-p);
+  } else if (p>encoder->gapp) {
+    memmove(encoder->v+encoder->gapp,encoder->v+encoder->gapp+gapc,p-encoder->gapp);
+  }
+  encoder->gapp=p;
+}
+
+// Start of the text at (p), after moving the gap there.
+static const char *text_encoder_tail(struct text_encoder *encoder,int p) {
+  text_encoder_move_gap(encoder,p);
+  if (encoder->gap) return encoder->v+p+encoder->a-encoder->c;
+  return encoder->v+p;
+}
+
+int text_encoder_set_gap(struct text_encoder *encoder,int gap) {
+  if (!encoder) return -1;
+  if (gap) {
+    if (encoder->gap) return 0;
+    encoder->gap=1;
+    encoder->gapp=encoder->c; // Contiguous is gap mode with the gap at the end; nothing moves.
+  } else {
+    text_encoder_move_gap(encoder,encoder->c);
+    encoder->gap=0;
+  }
+  return 0;
+}
+
+int text_encoder_get_contiguous(void *dstpp,struct text_encoder *encoder) {
+  if (!encoder) return 0;
+  text_encoder_move_gap(encoder,encoder->c);
+  if (dstpp) *(char**)dstpp=encoder->v;
+  return encoder->c;
+}
+
+int text_encoder_get_segments(const char **a,int *ac,const char **b,int *bc,const struct text_encoder *encoder) {
+  if (!encoder) return 0;
+  if (encoder->gap&&(encoder->gapp<encoder->c)) {
+    if (a) *a=encoder->v;
+    if (ac) *ac=encoder->gapp;
+    if (b) *b=encoder->v+encoder->gapp+encoder->a-encoder->c;
+    if (bc) *bc=encoder->c-encoder->gapp;
+  } else {
+    if (a) *a=encoder->v;
+    if (ac) *ac=encoder->c;
+    if (b) *b=0;
+    if (bc) *bc=0;
+  }
+  return encoder->c;
+}
+
 int text_encoder_init_object(struct text_encoder *encoder,const struct text_encoding *encoding) {
   if (!encoder||!encoding) return -1;
   encoder->encoding=encoding;
   encoder->v=0;
   encoder->c=0;
   encoder->a=0;
+  encoder->gap=0;
+  encoder->gapp=0;
   return 0;
 }
 
@@ -131,7 +199,14 @@ int text_encoder_init_name(struct text_encoder *encoder,const char *name,int nam
 int text_encoder_replace_raw(struct text_encoder *encoder,int p,int c,const void *src,int srcc) {
   if ((p<0)||(c<0)||(p>encoder->c-c)) return -1;
   if (!src) srcc=0; else if (srcc<0) { srcc=0; while (((char*)src)[srcc]) srcc++; }
-  if (c==srcc) {
+  if (encoder->gap) {
+    // Put the gap right after the doomed range, back over it, then fill from the front.
+    if (text_encoder_require(encoder,srcc-c)<0) return -1;
+    text_encoder_move_gap(encoder,p+c);
+    memcpy(encoder->v+p,src,srcc);
+    encoder->gapp=p+srcc;
+    encoder->c+=srcc-c;
+  } else if (c==srcc) {
     memcpy(encoder->v+p,src,srcc);
   } else {
     if (text_encoder_require(encoder,srcc-c)<0) return -1;
@@ -143,6 +218,7 @@ int text_encoder_replace_raw(struct text_encoder *encoder,int p,int c,const void
 }
 
 int text_encoder_append(struct text_encoder *encoder,int codepoint) {
+  text_encoder_move_gap(encoder,encoder->c);
   int err=encoder->encoding->write(encoder->v+encoder->c,encoder->a-encoder->c,codepoint,encoder->encoding->ctx);
   if (err<1) return -1;
   if (encoder->c>encoder->a-err) {
@@ -150,6 +226,7 @@ int text_encoder_append(struct text_encoder *encoder,int codepoint) {
     if (encoder->encoding->write(encoder->v+encoder->c,encoder->a-encoder->c,codepoint,encoder->encoding->ctx)!=err) return -1;
   }
   encoder->c+=err;
+  if (encoder->gap) encoder->gapp=encoder->c;
   return err;
 }
 
@@ -166,7 +243,7 @@ int text_encoder_insert(struct text_encoder *encoder,int p,int codepoint) {
 int text_encoder_delete_forward(struct text_encoder *encoder,int p) {
   if ((p<0)||(p>=encoder->c)) return -1;
   int dummy;
-  int len=encoder->encoding->read(&dummy,encoder->v+encoder->c,encoder->a-encoder->c,encoder->encoding->ctx);
+  int len=encoder->encoding->read(&dummy,text_encoder_tail(encoder,p),encoder->c-p,encoder->encoding->ctx);
   if (len<1) len=1;
   if (text_encoder_replace_raw(encoder,p,len,0,0)<0) return -1;
   return p;
@@ -175,6 +252,7 @@ int text_encoder_delete_forward(struct text_encoder *encoder,int p) {
 int text_encoder_delete_backward(struct text_encoder *encoder,int p) {
   if ((p<=0)||(p>encoder->c)) return -1;
   int dummy;
+  text_encoder_move_gap(encoder,p);
   int len=encoder->encoding->unread(&dummy,encoder->v,p,encoder->encoding->ctx);
   if (len<1) len=1;
   p-=len;
@@ -4,11 +4,14 @@
  *  - Tolerate misencoded text.
  *  - Read backward.
  * Reading backward is especially tricky, because it must treat misencoded text the same way it would forward.
+ * Also an undo journal for text editors, at the bottom.
  */
  
 #ifndef TEXT_H
 #define TEXT_H
 
+#include <stdint.h>
+
 struct text_encoding {
   const char *name; // Lowercase C identifier, matches the object's name.
   const void *ctx; // eg table of codepoints, so table-based encodings can share their hooks.
@@ -108,6 +111,17 @@ int text_decoder_init_name(struct text_decoder *decoder,const char *src,int srcc
 int text_decoder_read(int *codepoint,struct text_decoder *decoder);
 int text_decoder_unread(int *codepoint,struct text_decoder *decoder);
 
+/* Read up to (codepointa) codepoints at once, returns how many we wrote, zero at the end.
+ * Exactly the same results as calling text_decoder_read in a loop, but quicker for long text.
+ * If (lenv) not null, it gets the encoded length of each codepoint, same as text_decoder_read's return.
+ */
+int text_decoder_read_many(int *codepointv,int *lenv,int codepointa,struct text_decoder *decoder);
+
+/* Length of the leading run of printable ASCII (0x20..0x7e) in (src).
+ * In utf8 and iso88591, each of those bytes is one codepoint, itself.
+ */
+int text_g0_run(const char *src,int srcc);
+
 /* Structured encoder.
  * These do require cleanup and are not safe to copy.
  * You can yoink the text from an encoder, and then either set it null or just don't clean up.
@@ -117,6 +131,8 @@ struct text_encoder {
   const struct text_encoding *encoding;
   char *v;
   int c,a;
+  int gap; // Nonzero for gap mode, see below.
+  int gapp; // Gap mode only: Text is (v,gapp), then (a-c) bytes of gap, then the rest.
 };
 
 void text_encoder_cleanup(struct text_encoder *encoder);
@@ -138,4 +154,59 @@ int text_encoder_insert(struct text_encoder *encoder,int p,int codepoint); // =>
 int text_encoder_delete_forward(struct text_encoder *encoder,int p); // => (p)
 int text_encoder_delete_backward(struct text_encoder *encoder,int p); // => (p) after the removal
 
+/* Gap mode, for big text edited near a cursor.
+ * All the spare space sits at the last edit, so typing or deleting there doesn't move the rest of the text.
+ * Growth is geometric in either mode.
+ * In gap mode, (v) is not contiguous! Use text_encoder_get_contiguous before reading or yoinking it directly,
+ * or text_encoder_get_segments to read it in place, eg for rendering.
+ * Leaving gap mode makes it contiguous.
+ */
+int text_encoder_set_gap(struct text_encoder *encoder,int gap);
+int text_encoder_get_contiguous(void *dstpp,struct text_encoder *encoder); // Moves the gap to the end, stays in gap mode.
+int text_encoder_get_segments(const char **a,int *ac,const char **b,int *bc,const struct text_encoder *encoder); // => total length
+
+/* Undo journal.
+ * Each edit is a record of its position, the bytes it removed, and the bytes it added, packed into chunks.
+ * We never see the text itself: Undo and redo give you an edit to apply, and cost only the size of that edit.
+ * Push with TEXT_UNDO_TYPING for single keystrokes, and adjacent ones of the same kind merge into one record.
+ * Past (limit) bytes, we drop the oldest chunks. A single edit bigger than (limit) clears the journal instead.
+ * Like text_encoder, zero is a valid initial state, and you must clean up.
+ **********************************************************************/
+
+#define TEXT_UNDO_TYPING 0x01
+
+#define TEXT_UNDO_DEFAULT_LIMIT (4<<20)
+
+struct text_undo {
+  struct text_undo_chunk *first,*last; // Private, see text_undo.c.
+  struct text_undo_chunk *chunk; // Holds the newest record that can be undone, or null if none.
+  int recp; // Offset of that record in (chunk).
+  int sealed; // Nonzero if the newest record must not take any more typing.
+  int64_t size; // Bytes allocated.
+  int64_t limit; // Zero for TEXT_UNDO_DEFAULT_LIMIT.
+};
+
+// Replace (rmc) bytes at (p) with (add,addc). (add) points into the journal, valid until the next call.
+struct text_undo_edit {
+  int64_t p;
+  int rmc;
+  const void *add;
+  int addc;
+};
+
+void text_undo_cleanup(struct text_undo *undo);
+void text_undo_clear(struct text_undo *undo);
+
+/* Record an edit you're making: (rm,rmc) at (p) replaced by (add,addc).
+ * Anything that was undone can't be redone after this.
+ */
+int text_undo_push(struct text_undo *undo,int64_t p,const void *rm,int rmc,const void *add,int addc,int flags);
+
+void text_undo_seal(struct text_undo *undo); // Next edit starts a new record, even if it's typing.
+
+/* Both return >0 and fill (edit) if there was something to undo or redo.
+ */
+int text_undo_undo(struct text_undo_edit *edit,struct text_undo *undo);
+int text_undo_redo(struct text_undo_edit *edit,struct text_undo *undo);
+
 #endif
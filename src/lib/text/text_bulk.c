@@ -0,0 +1,182 @@
+/* text_bulk.c
+ * Decode many codepoints per call, without an indirect call per character.
+ * Each encoding with a fast path gets a kernel here; anything else, and every irregular character, goes through the encoding's (read).
+ * Results must match text_decoder_read exactly, including misencoded bytes.
+ * Also text_g0_run, for callers that can skip decoding altogether when the text is plain ASCII.
+ */
+
+#include "text.h"
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+#endif
+
+#define SRC ((const uint8_t*)decoder->v)
+
+/* One codepoint the slow way.
+ */
+
+static inline int text_bulk_one(int *dstv,int *lenv,int dstc,struct text_decoder *decoder) {
+  int len=text_decoder_read(dstv+dstc,decoder);
+  if (lenv) lenv[dstc]=len;
+  return dstc+1;
+}
+
+static inline void text_bulk_lens(int *lenv,int c,int len) {
+  if (!lenv) return;
+  while (c-->0) *(lenv++)=len;
+}
+
+/* Bytes below 0x80 are themselves in both utf8 and iso88591.
+ * For iso88591, every byte is, so (all) skips the check.
+ */
+
+static int text_bulk_bytes(int *dstv,int *lenv,int dsta,struct text_decoder *decoder,int all) {
+  int dstc=0;
+  while ((dstc<dsta)&&(decoder->p<decoder->c)) {
+    const uint8_t *src=SRC+decoder->p;
+    int srcc=decoder->c-decoder->p;
+    if (srcc>dsta-dstc) srcc=dsta-dstc;
+    int runc=0;
+    #if defined(__SSE2__)
+      const __m128i zero=_mm_setzero_si128();
+      while (runc<=srcc-16) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(src+runc));
+        if (!all&&_mm_movemask_epi8(v)) break;
+        __m128i lo=_mm_unpacklo_epi8(v,zero),hi=_mm_unpackhi_epi8(v,zero);
+        __m128i *dst=(__m128i*)(dstv+dstc+runc);
+        _mm_storeu_si128(dst+0,_mm_unpacklo_epi16(lo,zero));
+        _mm_storeu_si128(dst+1,_mm_unpackhi_epi16(lo,zero));
+        _mm_storeu_si128(dst+2,_mm_unpacklo_epi16(hi,zero));
+        _mm_storeu_si128(dst+3,_mm_unpackhi_epi16(hi,zero));
+        runc+=16;
+      }
+    #endif
+    // Finish the run a byte at a time. Picks up the block where a vector found something, and the tail.
+    while ((runc<srcc)&&(all||!(src[runc]&0x80))) {
+      dstv[dstc+runc]=src[runc];
+      runc++;
+    }
+    text_bulk_lens(lenv?lenv+dstc:0,runc,1);
+    dstc+=runc;
+    decoder->p+=runc;
+    if ((runc<srcc)&&(dstc<dsta)) dstc=text_bulk_one(dstv,lenv,dstc,decoder);
+  }
+  return dstc;
+}
+
+/* 16-bit units, either order. Surrogates only matter for utf16; ucs2 passes them through as codepoints.
+ */
+
+static int text_bulk_16(int *dstv,int *lenv,int dsta,struct text_decoder *decoder,int be,int surrogates) {
+  int dstc=0;
+  while ((dstc<dsta)&&(decoder->p<decoder->c)) {
+    const uint8_t *src=SRC+decoder->p;
+    int unitc=(decoder->c-decoder->p)>>1;
+    if (unitc>dsta-dstc) unitc=dsta-dstc;
+    int runc=0;
+    #if defined(__SSE2__)
+      const __m128i zero=_mm_setzero_si128();
+      const __m128i kmask=_mm_set1_epi16((short)0xf800);
+      const __m128i ksurr=_mm_set1_epi16((short)0xd800);
+      while (runc<=unitc-8) {
+        __m128i v=_mm_loadu_si128((const __m128i*)(src+(runc<<1)));
+        if (be) v=_mm_or_si128(_mm_slli_epi16(v,8),_mm_srli_epi16(v,8));
+        if (surrogates) {
+          if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v,kmask),ksurr))) break;
+        }
+        __m128i *dst=(__m128i*)(dstv+dstc+runc);
+        _mm_storeu_si128(dst+0,_mm_unpacklo_epi16(v,zero));
+        _mm_storeu_si128(dst+1,_mm_unpackhi_epi16(v,zero));
+        runc+=8;
+      }
+    #endif
+    while (runc<unitc) {
+      const uint8_t *p=src+(runc<<1);
+      int u=be?((p[0]<<8)|p[1]):(p[0]|(p[1]<<8));
+      if (surrogates&&((u&0xf800)==0xd800)) break;
+      dstv[dstc+runc]=u;
+      runc++;
+    }
+    text_bulk_lens(lenv?lenv+dstc:0,runc,2);
+    dstc+=runc;
+    decoder->p+=runc<<1;
+    // Surrogate, or a stray odd byte at the end.
+    if ((decoder->p<decoder->c)&&(dstc<dsta)&&((runc<unitc)||(decoder->c-decoder->p<2))) {
+      dstc=text_bulk_one(dstv,lenv,dstc,decoder);
+    }
+  }
+  return dstc;
+}
+
+/* 32-bit units. No invalid values; only a short tail goes the slow way.
+ */
+
+static int text_bulk_32(int *dstv,int *lenv,int dsta,struct text_decoder *decoder,int be) {
+  const uint8_t *src=SRC+decoder->p;
+  int unitc=(decoder->c-decoder->p)>>2;
+  if (unitc>dsta) unitc=dsta;
+  int dstc=0;
+  #if defined(__SSE2__)
+    const __m128i kbyte=_mm_set1_epi32(0xff);
+    for (;dstc<=unitc-4;dstc+=4) {
+      __m128i v=_mm_loadu_si128((const __m128i*)(src+(dstc<<2)));
+      if (be) v=_mm_or_si128(
+        _mm_or_si128(_mm_srli_epi32(v,24),_mm_and_si128(_mm_srli_epi32(v,8),_mm_slli_epi32(kbyte,8))),
+        _mm_or_si128(_mm_and_si128(_mm_slli_epi32(v,8),_mm_slli_epi32(kbyte,16)),_mm_slli_epi32(v,24))
+      );
+      _mm_storeu_si128((__m128i*)(dstv+dstc),v);
+    }
+  #endif
+  for (;dstc<unitc;dstc++) {
+    const uint8_t *p=src+(dstc<<2);
+    dstv[dstc]=be?((p[0]<<24)|(p[1]<<16)|(p[2]<<8)|p[3]):(p[0]|(p[1]<<8)|(p[2]<<16)|(p[3]<<24));
+  }
+  text_bulk_lens(lenv,dstc,4);
+  decoder->p+=dstc<<2;
+  while ((dstc<dsta)&&(decoder->p<decoder->c)) dstc=text_bulk_one(dstv,lenv,dstc,decoder);
+  return dstc;
+}
+
+/* Read many, public entry point.
+ */
+
+int text_decoder_read_many(int *codepointv,int *lenv,int codepointa,struct text_decoder *decoder) {
+  if (!codepointv||(codepointa<1)||!decoder||!decoder->encoding) return 0;
+  if ((decoder->p<0)||(decoder->p>=decoder->c)) return 0;
+  const struct text_encoding *encoding=decoder->encoding;
+  if (encoding==&text_encoding_utf8) return text_bulk_bytes(codepointv,lenv,codepointa,decoder,0);
+  if (encoding==&text_encoding_iso88591) return text_bulk_bytes(codepointv,lenv,codepointa,decoder,1);
+  if (encoding==&text_encoding_utf16le) return text_bulk_16(codepointv,lenv,codepointa,decoder,0,1);
+  if (encoding==&text_encoding_utf16be) return text_bulk_16(codepointv,lenv,codepointa,decoder,1,1);
+  if (encoding==&text_encoding_ucs2le) return text_bulk_16(codepointv,lenv,codepointa,decoder,0,0);
+  if (encoding==&text_encoding_ucs2be) return text_bulk_16(codepointv,lenv,codepointa,decoder,1,0);
+  if (encoding==&text_encoding_ucs4le) return text_bulk_32(codepointv,lenv,codepointa,decoder,0);
+  if (encoding==&text_encoding_ucs4be) return text_bulk_32(codepointv,lenv,codepointa,decoder,1);
+  int dstc=0;
+  while ((dstc<codepointa)&&(decoder->p<decoder->c)) dstc=text_bulk_one(codepointv,lenv,dstc,decoder);
+  return dstc;
+}
+
+/* Printable G0 run.
+ */
+
+int text_g0_run(const char *src,int srcc) {
+  if (!src||(srcc<1)) return 0;
+  int runc=0;
+  #if defined(__SSE2__)
+    // As signed bytes, 0x80..0xff are negative, so (>0x1f) rejects them along with C0.
+    const __m128i klo=_mm_set1_epi8(0x1f),khi=_mm_set1_epi8(0x7f);
+    for (;runc<=srcc-16;runc+=16) {
+      __m128i v=_mm_loadu_si128((const __m128i*)(src+runc));
+      int mask=_mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(v,klo),_mm_cmplt_epi8(v,khi)));
+      if (mask!=0xffff) return runc+__builtin_ctz(~mask);
+    }
+  #endif
+  for (;runc<srcc;runc++) {
+    uint8_t ch=src[runc];
+    if ((ch<0x20)||(ch>0x7e)) break;
+  }
+  return runc;
+}
@@ -0,0 +1,236 @@
+/* text_undo.c
+ * Undo journal: Records of edits, oldest first, packed end to end in a list of chunks.
+ * Each record is a header, then the removed bytes, then the added bytes, padded to 8.
+ * Records never span chunks. To walk backward, each one knows where the previous one in its chunk starts.
+ * The cursor (chunk,recp) is the newest record that can be undone. Records after it are for redo, until the next push discards them.
+ */
+
+#include "text.h"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#define TEXT_UNDO_CHUNK_SIZE 65536
+#define TEXT_UNDO_CHUNK_MIN 256
+#define TEXT_UNDO_COALESCE_LIMIT 1024 /* Typing stops merging when the record gets this big. */
+
+struct text_undo_chunk {
+  struct text_undo_chunk *prev,*next;
+  int c,a; // Bytes of records, and available, after the header.
+  int lastp; // Offset of the last record.
+};
+
+struct text_undo_record {
+  int64_t p;
+  int rmc,addc;
+  int prev; // Offset of the previous record in this chunk, or -1.
+  int flags;
+};
+
+#define CHUNK_DATA(chunk) ((char*)(chunk)+sizeof(struct text_undo_chunk))
+#define RECORD(chunk,p) ((struct text_undo_record*)(CHUNK_DATA(chunk)+(p)))
+#define RECORD_RM(rec) ((char*)(rec)+sizeof(struct text_undo_record))
+#define RECORD_ADD(rec) (RECORD_RM(rec)+(rec)->rmc)
+
+static int text_undo_record_size(int64_t rmc,int64_t addc) {
+  int64_t size=(sizeof(struct text_undo_record)+rmc+addc+7)&~7;
+  if (size>INT_MAX) return -1;
+  return size;
+}
+
+static int64_t text_undo_limit(const struct text_undo *undo) {
+  return (undo->limit>0)?undo->limit:TEXT_UNDO_DEFAULT_LIMIT;
+}
+
+/* Drop chunks.
+ */
+
+static void text_undo_drop_after(struct text_undo *undo,struct text_undo_chunk *chunk) {
+  struct text_undo_chunk *victim=chunk?chunk->next:undo->first;
+  if (chunk) chunk->next=0;
+  else undo->first=0;
+  undo->last=chunk;
+  while (victim) {
+    struct text_undo_chunk *next=victim->next;
+    undo->size-=sizeof(struct text_undo_chunk)+victim->a;
+    free(victim);
+    victim=next;
+  }
+}
+
+static void text_undo_drop_first(struct text_undo *undo) {
+  struct text_undo_chunk *victim=undo->first;
+  if (!victim) return;
+  if (!(undo->first=victim->next)) undo->last=0;
+  else undo->first->prev=0;
+  if (undo->chunk==victim) undo->chunk=0;
+  undo->size-=sizeof(struct text_undo_chunk)+victim->a;
+  free(victim);
+}
+
+/* Cleanup.
+ */
+
+void text_undo_cleanup(struct text_undo *undo) {
+  if (!undo) return;
+  text_undo_drop_after(undo,0);
+  memset(undo,0,sizeof(struct text_undo));
+}
+
+void text_undo_clear(struct text_undo *undo) {
+  if (!undo) return;
+  text_undo_drop_after(undo,0);
+  undo->chunk=0;
+  undo->recp=0;
+  undo->sealed=0;
+  undo->size=0;
+}
+
+void text_undo_seal(struct text_undo *undo) {
+  if (!undo) return;
+  undo->sealed=1;
+}
+
+/* Merge typing into the newest record, if it fits there.
+ * Returns >0 if merged, and we're done.
+ */
+
+static int text_undo_coalesce(struct text_undo *undo,int64_t p,const void *rm,int rmc,const void *add,int addc) {
+  if (undo->sealed||!undo->chunk) return 0;
+  struct text_undo_record *rec=RECORD(undo->chunk,undo->recp);
+  if (!(rec->flags&TEXT_UNDO_TYPING)) return 0;
+  if (rec->rmc+rec->addc+rmc+addc>TEXT_UNDO_COALESCE_LIMIT) return 0;
+  if (undo->recp+text_undo_record_size(rec->rmc+rmc,rec->addc+addc)>undo->chunk->a) return 0;
+
+  // Inserting right after the last insert.
+  if (!rmc&&!rec->rmc&&(p==rec->p+rec->addc)) {
+    memcpy(RECORD_ADD(rec)+rec->addc,add,addc);
+    rec->addc+=addc;
+
+  // Deleting forward from the same spot.
+  } else if (!addc&&!rec->addc&&(p==rec->p)) {
+    memcpy(RECORD_RM(rec)+rec->rmc,rm,rmc);
+    rec->rmc+=rmc;
+
+  // Backspacing, this goes in front of what we already have.
+  } else if (!addc&&!rec->addc&&(p+rmc==rec->p)) {
+    memmove(RECORD_RM(rec)+rmc,RECORD_RM(rec),rec->rmc);
+    memcpy(RECORD_RM(rec),rm,rmc);
+    rec->rmc+=rmc;
+    rec->p=p;
+
+  } else return 0;
+  undo->chunk->c=undo->recp+text_undo_record_size(rec->rmc,rec->addc);
+  return 1;
+}
+
+/* Push.
+ */
+
+int text_undo_push(struct text_undo *undo,int64_t p,const void *rm,int rmc,const void *add,int addc,int flags) {
+  if (!undo||(p<0)||(rmc<0)||(addc<0)) return -1;
+  if (!rmc&&!addc) return 0;
+
+  // Anything after the cursor is redo, and it's now invalid.
+  if (undo->chunk) {
+    struct text_undo_record *rec=RECORD(undo->chunk,undo->recp);
+    undo->chunk->c=undo->recp+text_undo_record_size(rec->rmc,rec->addc);
+    undo->chunk->lastp=undo->recp;
+  }
+  text_undo_drop_after(undo,undo->chunk);
+
+  if ((flags&TEXT_UNDO_TYPING)&&(text_undo_coalesce(undo,p,rm,rmc,add,addc)>0)) return 0;
+
+  // A record too big for the whole journal means nothing before it can be undone either.
+  int64_t limit=text_undo_limit(undo);
+  int size=text_undo_record_size((int64_t)rmc,addc);
+  if ((size<0)||(size>limit)) {
+    text_undo_clear(undo);
+    return 0;
+  }
+
+  // New chunk if it doesn't fit in the last one.
+  struct text_undo_chunk *chunk=undo->last;
+  if (!chunk||(chunk->c>chunk->a-size)) {
+    int64_t a=limit>>3;
+    if (a>TEXT_UNDO_CHUNK_SIZE) a=TEXT_UNDO_CHUNK_SIZE;
+    else if (a<TEXT_UNDO_CHUNK_MIN) a=TEXT_UNDO_CHUNK_MIN;
+    if (a<size) a=size;
+    if (!(chunk=malloc(sizeof(struct text_undo_chunk)+a))) return -1;
+    chunk->prev=undo->last;
+    chunk->next=0;
+    chunk->c=0;
+    chunk->a=a;
+    chunk->lastp=-1;
+    if (undo->last) undo->last->next=chunk;
+    else undo->first=chunk;
+    undo->last=chunk;
+    undo->size+=sizeof(struct text_undo_chunk)+a;
+  }
+
+  struct text_undo_record *rec=RECORD(chunk,chunk->c);
+  rec->p=p;
+  rec->rmc=rmc;
+  rec->addc=addc;
+  rec->prev=chunk->lastp;
+  rec->flags=flags;
+  if (rmc) memcpy(RECORD_RM(rec),rm,rmc);
+  if (addc) memcpy(RECORD_ADD(rec),add,addc);
+  undo->chunk=chunk;
+  undo->recp=chunk->lastp=chunk->c;
+  chunk->c+=size;
+  undo->sealed=0;
+
+  // Make room by dropping the oldest. Never the one we just added.
+  while ((undo->size>limit)&&(undo->first!=chunk)) text_undo_drop_first(undo);
+  return 0;
+}
+
+/* Undo.
+ */
+
+int text_undo_undo(struct text_undo_edit *edit,struct text_undo *undo) {
+  if (!edit||!undo||!undo->chunk) return 0;
+  const struct text_undo_record *rec=RECORD(undo->chunk,undo->recp);
+  edit->p=rec->p;
+  edit->rmc=rec->addc;
+  edit->add=RECORD_RM(rec);
+  edit->addc=rec->rmc;
+  if (rec->prev>=0) {
+    undo->recp=rec->prev;
+  } else if ((undo->chunk=undo->chunk->prev)) {
+    undo->recp=undo->chunk->lastp;
+  } else {
+    undo->recp=0;
+  }
+  undo->sealed=1;
+  return 1;
+}
+
+/* Redo.
+ */
+
+int text_undo_redo(struct text_undo_edit *edit,struct text_undo *undo) {
+  if (!edit||!undo) return 0;
+  struct text_undo_chunk *chunk=undo->chunk;
+  int recp=0;
+  if (!chunk) {
+    if (!(chunk=undo->first)) return 0;
+  } else {
+    const struct text_undo_record *rec=RECORD(chunk,undo->recp);
+    recp=undo->recp+text_undo_record_size(rec->rmc,rec->addc);
+    if (recp>=chunk->c) {
+      if (!(chunk=chunk->next)) return 0;
+      recp=0;
+    }
+  }
+  const struct text_undo_record *rec=RECORD(chunk,recp);
+  edit->p=rec->p;
+  edit->rmc=rec->rmc;
+  edit->add=RECORD_ADD(rec);
+  edit->addc=rec->addc;
+  undo->chunk=chunk;
+  undo->recp=recp;
+  undo->sealed=1;
+  return 1;
+}
@@ -22,12 +22,18 @@ struct wm_delegate {
   void (*cb_mmotion)(int x,int y); // (x,y) in window client coords. May be OOB, or WM may never report OOBs.
   void (*cb_mbutton)(int btnid,int value); // (1,2,3)=(left,right,center)
   void (*cb_mwheel)(int dx,int dy); // One unit should be one click of the wheel.
+  void (*cb_visibility)(int visible); // Zero when minimized or fully covered, ie rendering would be wasted. Assume visible initially.
 };
 
 void wm_quit();
 int wm_init(const struct wm_delegate *delegate);
 int wm_update();
 
+/* A file descriptor that becomes readable when wm_update() would have something to do, if the WM has such a thing.
+ * <0 if not; then you have to poll wm_update() at whatever rate you can tolerate.
+ */
+int wm_get_event_fd();
+
 void wm_set_title(const char *src,int srcc);
 void wm_set_icon(const void *rgba,int w,int h); // Minimum stride.
 int wm_define_cursor(const void *rgba,int w,int h); // Minimum stride. Returns >0 cursorid.
@@ -6,6 +6,9 @@
 #include <string.h>
 #include <limits.h>
 #include <sys/stat.h>
+#if !USE_mswin
+  #include <sys/mman.h>
+#endif
 
 /* POSIX has a flag like this but MacOS doesn't respect it.
  * So we'll figure it out on our own. (TODO Figure it out on our own).
@@ -78,6 +81,89 @@ int file_write(const char *path,const void *src,int srcc) {
   return 0;
 }
 
+/* Map file, or read it all when we can't.
+ * The fallback reads to EOF rather than trusting the size, since things like pipes and /proc don't know theirs.
+ */
+
+static int file_map_read(struct file_map *map,int fd) {
+  char *dst=0;
+  int64_t dstc=0,dsta=0;
+  for (;;) {
+    if (dstc>=dsta) {
+      int64_t na=dsta?(dsta<<1):65536;
+      if ((na<dsta)||((uint64_t)na>SIZE_MAX)) {
+        if (dst) free(dst);
+        return -1;
+      }
+      void *nv=realloc(dst,na);
+      if (!nv) {
+        if (dst) free(dst);
+        return -1;
+      }
+      dst=nv;
+      dsta=na;
+    }
+    int64_t readc=dsta-dstc;
+    if (readc>0x40000000) readc=0x40000000;
+    ssize_t err=read(fd,dst+dstc,readc);
+    if (err<0) {
+      free(dst);
+      return -1;
+    }
+    if (!err) break;
+    dstc+=err;
+  }
+  map->v=dst;
+  map->c=dstc;
+  map->mapped=0;
+  return 0;
+}
+
+struct file_map *file_map(const char *path,int flags) {
+  if (!path) return 0;
+  int fd=open(path,O_RDONLY|O_BINARY);
+  if (fd<0) return 0;
+  struct file_map *map=calloc(1,sizeof(struct file_map));
+  if (!map) {
+    close(fd);
+    return 0;
+  }
+  #if !USE_mswin
+    struct stat st;
+    if (!fstat(fd,&st)&&S_ISREG(st.st_mode)&&(st.st_size>0)&&((uint64_t)st.st_size<=SIZE_MAX)) {
+      void *v=mmap(0,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+      if (v!=MAP_FAILED) {
+        if (flags&FILE_MAP_SEQUENTIAL) madvise(v,st.st_size,MADV_SEQUENTIAL);
+        else if (flags&FILE_MAP_RANDOM) madvise(v,st.st_size,MADV_RANDOM);
+        close(fd);
+        map->v=v;
+        map->c=st.st_size;
+        map->mapped=1;
+        return map;
+      }
+    }
+  #endif
+  if (file_map_read(map,fd)<0) {
+    close(fd);
+    free(map);
+    return 0;
+  }
+  close(fd);
+  return map;
+}
+
+void file_unmap(struct file_map *map) {
+  if (!map) return;
+  if (map->mapped) {
+    #if !USE_mswin
+      munmap((void*)map->v,map->c);
+    #endif
+  } else if (map->v) {
+    free((void*)map->v);
+  }
+  free(map);
+}
+
 /* Read from stdin.
  */
 
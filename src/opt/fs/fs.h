@@ -5,6 +5,8 @@
 #ifndef FS_H
 #define FS_H
 
+#include <stdint.h>
+
 /* Read a regular file in one shot.
  * On success, caller frees (*dstpp), even if reported length is zero.
  */
@@ -15,6 +17,24 @@ int file_read(void *dstpp,const char *path);
  */
 int file_write(const char *path,const void *src,int srcc);
 
+/* Read-only view of a whole file, mapped if we can.
+ * Mapping is lazy: Opening is quick no matter the size, and pages come and go as the OS sees fit,
+ * so a huge file costs address space, not resident memory. Lengths are 64-bit.
+ * If the file can't be mapped (pipes, some special filesystems, or a platform without mmap), we read it instead.
+ * Then (mapped) is zero and (v) is our own copy, still read-only to you. That fallback is limited by memory, of course.
+ * (flags) are FILE_MAP_* hints about how you'll read it, and only matter when mapped.
+ * (v) may be null if (c) is zero.
+ */
+struct file_map {
+  const void *v;
+  int64_t c;
+  int mapped;
+};
+#define FILE_MAP_SEQUENTIAL 0x01 /* Front to back, eg decoding. Read ahead aggressively. */
+#define FILE_MAP_RANDOM     0x02 /* Jumping around, eg a viewer. Don't bother reading ahead. */
+struct file_map *file_map(const char *path,int flags);
+void file_unmap(struct file_map *map);
+
 /* Equivalent to (file_read,file_write) but on stdin and stdout.
  * Writing does not close the stream.
  */
@@ -29,6 +29,10 @@ int wm_update() {
   return 0;
 }
 
+int wm_get_event_fd() {
+  return -1;
+}
+
 void wm_get_size(int *w,int *h) {
   *w=*h=1;
 }
@@ -58,6 +58,7 @@ extern struct wm_x11 {
   
   int w,h;
   int focus;
+  int mapped,obscured,visible; // (visible) is what we last reported: (mapped&&!obscured)
   
   struct wm_x11_cursor {
     int cursorid;
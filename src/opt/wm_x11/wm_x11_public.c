@@ -61,7 +61,7 @@ static int wm_x11_init() {
       KeyPressMask|KeyReleaseMask|
       PointerMotionMask|ButtonPressMask|ButtonReleaseMask|
       EnterWindowMask|LeaveWindowMask|
-      FocusChangeMask|ExposureMask|
+      FocusChangeMask|ExposureMask|VisibilityChangeMask|
       //TODO Is it possible to request motion events when outside our window? We'd rather get all of them.
     0,
   };
@@ -87,6 +87,8 @@ int wm_init(const struct wm_delegate *delegate) {
   if (wm_x11.init) return -1;
   wm_x11.init=1;
   wm_x11.delegate=*delegate;
+  wm_x11.mapped=1;
+  wm_x11.visible=1;
   if (wm_x11_init()<0) {
     wm_quit();
     return -1;
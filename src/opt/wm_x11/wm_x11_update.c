@@ -111,6 +111,30 @@ static int wm_x11_evt_focus(XFocusInEvent *evt,int value) {
   return 0;
 }
 
+/* Visibility.
+ * We only care about the extremes: Entirely hidden, or anything else.
+ */
+ 
+static int wm_x11_visibility_changed() {
+  int visible=(wm_x11.mapped&&!wm_x11.obscured)?1:0;
+  if (visible==wm_x11.visible) return 0;
+  wm_x11.visible=visible;
+  if (wm_x11.delegate.cb_visibility) {
+    wm_x11.delegate.cb_visibility(visible);
+  }
+  return 0;
+}
+ 
+static int wm_x11_evt_visibility(XVisibilityEvent *evt) {
+  wm_x11.obscured=(evt->state==VisibilityFullyObscured)?1:0;
+  return wm_x11_visibility_changed();
+}
+
+static int wm_x11_evt_map(int mapped) {
+  wm_x11.mapped=mapped;
+  return wm_x11_visibility_changed();
+}
+
 /* Exposure.
  */
  
@@ -147,6 +171,9 @@ static int wm_x11_receive_event(XEvent *evt) {
     case FocusOut: return wm_x11_evt_focus(&evt->xfocus,0);
     
     case Expose: return wm_x11_evt_expose(&evt->xexpose);
+    case VisibilityNotify: return wm_x11_evt_visibility(&evt->xvisibility);
+    case MapNotify: return wm_x11_evt_map(1);
+    case UnmapNotify: return wm_x11_evt_map(0);
     
     //default: fprintf(stderr,"X11 event type %d\n",evt->type);
   }
@@ -179,3 +206,11 @@ int wm_update() {
   }
   return 0;
 }
+
+/* Event fd.
+ */
+ 
+int wm_get_event_fd() {
+  if (!wm_x11.init||!wm_x11.dpy) return -1;
+  return ConnectionNumber(wm_x11.dpy);
+}
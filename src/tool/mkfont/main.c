@@ -0,0 +1,92 @@
+/* mkfont/main.c
+ * Build-time tool: Convert font images to A1 atlases, and emit them as C source.
+ * Usage: mkfont -oOUTPUT.c INPUT.png...
+ * The font is named for its file's basename, without extension.
+ * We go through font_new() so the conversion is exactly what you'd get loading at runtime.
+ */
+
+#include "lib/font/font_internal.h"
+#include "lib/serial/serial.h"
+#include "opt/fs/fs.h"
+
+/* Add one font to the output.
+ */
+ 
+static int mkfont_add(struct sr_encoder *body,struct sr_encoder *table,const char *path,int fontp) {
+  const char *base=path;
+  int i=0; for (;path[i];i++) if (path[i]=='/') base=path+i+1;
+  int basec=0; while (base[basec]&&(base[basec]!='.')) basec++;
+  if (!basec) {
+    fprintf(stderr,"%s: Can't derive a font name from this path.\n",path);
+    return -1;
+  }
+  
+  struct image *image=image_new_from_path(path);
+  if (!image) {
+    fprintf(stderr,"%s: Failed to read image.\n",path);
+    return -1;
+  }
+  struct font *font=font_new(image,&text_encoding_utf8);
+  image_del(image);
+  if (!font) {
+    fprintf(stderr,"%s: Failed to create font. Image must be 16x7 glyphs.\n",path);
+    return -1;
+  }
+  
+  sr_encode_fmt(body,"static const unsigned char mkfont_a1_%d[%d]={\n",fontp,font->imgstride*font->imgh);
+  const uint8_t *src=font->img;
+  int c=font->imgstride*font->imgh;
+  for (i=0;i<c;i++) {
+    sr_encode_fmt(body,"%d,",src[i]);
+    if ((i&31)==31) sr_encode_raw(body,"\n",1);
+  }
+  sr_encode_raw(body,"};\n",-1);
+  
+  sr_encode_fmt(table,"  {\"%.*s\",%d,%d,%d,mkfont_a1_%d},\n",basec,base,font->imgw,font->imgh,font->imgstride,fontp);
+  
+  font_del(font);
+  return 0;
+}
+
+/* Main.
+ */
+
+int main(int argc,char **argv) {
+  const char *dstpath=0;
+  struct sr_encoder body={0},table={0};
+  sr_encode_raw(&body,
+    "/* Generated by mkfont. Do not edit. */\n"
+    "#include \"lib/gui/gui_internal.h\"\n"
+  ,-1);
+  sr_encode_raw(&table,"const struct gui_embedded_font gui_embedded_fontv[]={\n",-1);
+  int fontc=0,argi=1;
+  for (;argi<argc;argi++) {
+    const char *arg=argv[argi];
+    if ((arg[0]=='-')&&(arg[1]=='o')) {
+      dstpath=arg+2;
+    } else if (arg[0]=='-') {
+      fprintf(stderr,"%s: Unexpected option '%s'\n",argv[0],arg);
+      return 1;
+    } else {
+      if (mkfont_add(&body,&table,arg,fontc)<0) return 1;
+      fontc++;
+    }
+  }
+  if (!dstpath) {
+    fprintf(stderr,"Usage: %s -oOUTPUT.c INPUT.png...\n",argv[0]);
+    return 1;
+  }
+  // An empty initializer list isn't legal C. Pad with a dummy entry, it doesn't count.
+  if (!fontc) sr_encode_raw(&table,"  {0},\n",-1);
+  sr_encode_raw(&table,"};\n",-1);
+  sr_encode_fmt(&table,"const int gui_embedded_fontc=%d;\n",fontc);
+  sr_encode_raw(&body,table.v,table.c);
+  if (sr_encoder_assert(&body)<0) return 1;
+  if (file_write(dstpath,body.v,body.c)<0) {
+    fprintf(stderr,"%s: Failed to write file.\n",dstpath);
+    return 1;
+  }
+  sr_encoder_cleanup(&body);
+  sr_encoder_cleanup(&table);
+  return 0;
+}